@@ -1,5 +1,7 @@
 #include "App.h"
 #include "Math.h"
+#include <cstdlib>
+#include <cstring>
 
 // CubeObject: derived from RenderableObject
 class RotatingObject : public RenderableObject {
@@ -35,6 +37,16 @@ public:
         }
     }
 
+    AsyncTask<void> PreloadAsync(Renderer* renderer) override
+    {
+        if (modelName_.empty()) {
+            co_await RenderableObject::PreloadAsync(renderer);
+            co_return;
+        }
+        co_await WhenAll(RenderableObject::PreloadAsync(renderer),
+                         renderer->GetMeshManager()->LoadAsync(modelName_, renderer, { true, false, 0 }));
+    }
+
     void Tick(float deltaTime) override {
         rotationY_ += angularSpeed_ * deltaTime;
         if (rotationY_ > XM_2PI) {
@@ -56,7 +68,7 @@ public:
 
     void UpdateUniforms(Renderer* renderer, const mat4& view, const mat4& proj) override
     {
-        UpdateUniform("world", modelMatrix_.xm());
+        UpdateUniform("world", renderModelMatrix_.xm());
         UpdateUniform("view", view.xm());
         UpdateUniform("proj", proj.xm());
 
@@ -182,7 +194,22 @@ void App::InitScene()
     renderer_.WaitForPreviousFrame();
 }
 
-void App::Run(HINSTANCE hInstance, int nCmdShow) {
+// Настройки развёртывания из командной строки (до создания устройства)
+static void ApplyCommandLine(Renderer& renderer, const char* cmdLine) {
+    if (cmdLine == nullptr) {
+        return;
+    }
+    constexpr const char* kFramesInFlight = "--frames-in-flight=";
+    if (const char* p = std::strstr(cmdLine, kFramesInFlight)) {
+        const unsigned long n = std::strtoul(p + std::strlen(kFramesInFlight), nullptr, 10);
+        if (n != 0) {
+            renderer.SetFramesInFlight(static_cast<UINT>(n));
+        }
+    }
+}
+
+void App::Run(HINSTANCE hInstance, int nCmdShow, const char* cmdLine) {
+    ApplyCommandLine(renderer_, cmdLine);
     InitWindow(hInstance, nCmdShow);
     TaskSystem::Get().Start(static_cast<unsigned int>(std::thread::hardware_concurrency() * 0.75f));
 
@@ -242,8 +269,7 @@ void App::Run(HINSTANCE hInstance, int nCmdShow) {
 		deltaTime = Math::Clamp(deltaTime, 1e-6f, 0.1f);
 
 		renderer_.Tick(deltaTime);
-        scene_.Tick(deltaTime);
-        scene_.Render(&renderer_);
+        scene_.RunFrame(&renderer_, deltaTime);
     }
 
     scene_.Clear();
@@ -27,7 +27,8 @@
 
 class App {
 public:
-    void Run(HINSTANCE hInstance, int nCmdShow);
+    // cmdLine: --frames-in-flight=N (1..4) — задержка против пропускной способности
+    void Run(HINSTANCE hInstance, int nCmdShow, const char* cmdLine = nullptr);
 
 private:
     Renderer renderer_;
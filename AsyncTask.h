@@ -0,0 +1,305 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "TaskSystem.h"
+
+// Корутины поверх TaskSystem.
+//   AsyncTask<T>  — ленивая задача: тело стартует на первом co_await (или в SyncWait/WhenAll),
+//                   по завершении продолжение возобновляется на том же потоке (symmetric transfer).
+//   ScheduleOn(p) — перескочить на воркер TaskSystem с приоритетом p (и сроком — для стриминга).
+//   WhenAll(...)  — запустить задачи параллельно и дождаться всех.
+//   SyncWait(t)   — заблокировать текущий (не рабочий!) поток до завершения t.
+// Типичный загрузчик: co_await ScheduleOn(Background); parse...; record upload; co_await fence;
+
+template<typename T = void>
+class AsyncTask;
+
+namespace AsyncDetail {
+
+    // Общая часть промисов: продолжение + исключение
+    struct PromiseBase_ {
+        struct FinalAwaiter_ {
+            bool await_ready() const noexcept { return false; }
+            template<typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+                std::coroutine_handle<> cont = h.promise().continuation;
+                return cont ? cont : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter_ final_suspend() const noexcept { return {}; }
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+        void Rethrow_() const {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr      exception;
+    };
+
+    template<typename T>
+    struct Promise_ : PromiseBase_ {
+        AsyncTask<T> get_return_object() noexcept;
+
+        template<typename U>
+        void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+        T Take_() {
+            Rethrow_();
+            return std::move(*value);
+        }
+
+        std::optional<T> value;
+    };
+
+    template<>
+    struct Promise_<void> : PromiseBase_ {
+        AsyncTask<void> get_return_object() noexcept;
+        void return_void() const noexcept {}
+        void Take_() const { Rethrow_(); }
+    };
+
+} // namespace AsyncDetail
+
+template<typename T>
+class AsyncTask {
+public:
+    using promise_type = AsyncDetail::Promise_<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    AsyncTask() noexcept = default;
+    explicit AsyncTask(Handle h) noexcept : h_(h) {}
+    AsyncTask(AsyncTask&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    AsyncTask& operator=(AsyncTask&& o) noexcept {
+        if (this != &o) {
+            Destroy_();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+    ~AsyncTask() { Destroy_(); }
+
+    bool IsValid() const noexcept { return static_cast<bool>(h_); }
+    bool IsDone() const noexcept { return !h_ || h_.done(); }
+
+    // co_await task — запускает тело и возвращает результат (или пробрасывает исключение)
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            Handle h;
+            bool await_ready() const noexcept { return !h || h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) noexcept {
+                h.promise().continuation = cont;
+                return h;
+            }
+            T await_resume() { return h.promise().Take_(); }
+        };
+        return Awaiter{ h_ };
+    }
+
+    // Ожидание завершения без забора результата (для WhenAll/SyncWait)
+    auto WhenReady_() noexcept {
+        struct Awaiter {
+            Handle h;
+            bool await_ready() const noexcept { return !h || h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) noexcept {
+                h.promise().continuation = cont;
+                return h;
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ h_ };
+    }
+
+    // Результат уже завершённой задачи
+    T TakeResult_() { return h_.promise().Take_(); }
+
+private:
+    void Destroy_() noexcept {
+        if (h_) {
+            h_.destroy();
+            h_ = {};
+        }
+    }
+
+    Handle h_;
+};
+
+namespace AsyncDetail {
+
+    template<typename T>
+    AsyncTask<T> Promise_<T>::get_return_object() noexcept {
+        return AsyncTask<T>(std::coroutine_handle<Promise_<T>>::from_promise(*this));
+    }
+
+    inline AsyncTask<void> Promise_<void>::get_return_object() noexcept {
+        return AsyncTask<void>(std::coroutine_handle<Promise_<void>>::from_promise(*this));
+    }
+
+    // Служебная корутина без результата: стартует явно, в конце зовёт onDone.
+    // Кадр уничтожает владелец (после того, как onDone отработал).
+    struct Detached_ {
+        struct promise_type {
+            struct FinalAwaiter_ {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    return h.promise().onDone(h.promise().ctx);
+                }
+                void await_resume() const noexcept {}
+            };
+
+            Detached_ get_return_object() noexcept {
+                return Detached_{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter_ final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+
+            std::coroutine_handle<> (*onDone)(void* ctx) noexcept = nullptr;
+            void* ctx = nullptr;
+        };
+
+        std::coroutine_handle<promise_type> h;
+    };
+
+    template<typename T>
+    Detached_ AwaitReady_(AsyncTask<T>& t) {
+        co_await t.WhenReady_();
+    }
+
+    struct SyncWaitEvent_ {
+        static std::coroutine_handle<> OnDone(void* ctx) noexcept {
+            auto* self = static_cast<SyncWaitEvent_*>(ctx);
+            // notify под локом: ждущий не разрушит событие, пока мы внутри
+            std::lock_guard<std::mutex> lk(self->mtx);
+            self->done = true;
+            self->cv.notify_all();
+            return std::noop_coroutine();
+        }
+
+        void Wait() {
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait(lk, [this] { return done; });
+        }
+
+        std::mutex              mtx;
+        std::condition_variable cv;
+        bool                    done = false;
+    };
+
+    // Счётчик WhenAll: +1 за самого родителя, чтобы последний ребёнок не возобновил его раньше,
+    // чем родитель раздал все задачи.
+    struct WhenAllLatch_ {
+        static std::coroutine_handle<> OnDone(void* ctx) noexcept {
+            auto* self = static_cast<WhenAllLatch_*>(ctx);
+            if (self->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return self->parent;
+            }
+            return std::noop_coroutine();
+        }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            parent = h;
+            for (Detached_& c : children) {
+                c.h.resume();
+            }
+            return remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+        void await_resume() const noexcept {}
+
+        std::atomic<size_t>     remaining{ 1 };
+        std::coroutine_handle<> parent;
+        std::vector<Detached_>  children;
+    };
+
+    template<typename T>
+    AsyncTask<void> Discard_(AsyncTask<T> t) {
+        (void)co_await std::move(t);
+    }
+
+} // namespace AsyncDetail
+
+// Перескок на воркер TaskSystem. Срок упорядочивает фоновую очередь.
+// Токен отмены сюда не передаётся: выброшенное продолжение оставило бы корутину висеть —
+// корутина проверяет свой токен сама после перескока.
+struct ScheduleOn {
+    explicit ScheduleOn(TaskPriority p = TaskPriority::Normal,
+                        TaskSystem::Clock::time_point deadline = TaskSystem::kNoDeadline)
+        : priority(p), deadline(deadline) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const {
+        TaskSystem::TaskOptions opt;
+        opt.priority = priority;
+        opt.deadline = deadline;
+        TaskSystem::Get().Submit([h] { h.resume(); }, opt);
+    }
+    void await_resume() const noexcept {}
+
+    TaskPriority                  priority;
+    TaskSystem::Clock::time_point deadline;
+};
+
+// Запустить все задачи и дождаться их. Результаты отбрасываются (задачи пишут их сами),
+// первое исключение пробрасывается после завершения всех.
+template<typename T>
+AsyncTask<void> WhenAll(std::vector<AsyncTask<T>> tasks)
+{
+    AsyncDetail::WhenAllLatch_ latch;
+    latch.remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+    latch.children.reserve(tasks.size());
+    for (AsyncTask<T>& t : tasks) {
+        AsyncDetail::Detached_ c = AsyncDetail::AwaitReady_(t);
+        c.h.promise().onDone = &AsyncDetail::WhenAllLatch_::OnDone;
+        c.h.promise().ctx = &latch;
+        latch.children.push_back(c);
+    }
+
+    co_await latch;
+
+    for (AsyncDetail::Detached_& c : latch.children) {
+        c.h.destroy();
+    }
+    for (AsyncTask<T>& t : tasks) {
+        (void)t.TakeResult_();
+    }
+}
+
+template<typename... Ts>
+AsyncTask<void> WhenAll(AsyncTask<Ts>... tasks)
+{
+    std::vector<AsyncTask<void>> all;
+    all.reserve(sizeof...(Ts));
+    (all.push_back(AsyncDetail::Discard_(std::move(tasks))), ...);
+    co_await WhenAll(std::move(all));
+}
+
+// Блокирующее ожидание. Только вне воркеров TaskSystem: поток спит, а не помогает.
+template<typename T>
+T SyncWait(AsyncTask<T> task)
+{
+    AsyncDetail::SyncWaitEvent_ ev;
+    AsyncDetail::Detached_ c = AsyncDetail::AwaitReady_(task);
+    c.h.promise().onDone = &AsyncDetail::SyncWaitEvent_::OnDone;
+    c.h.promise().ctx = &ev;
+    c.h.resume();
+    ev.Wait();
+    c.h.destroy();
+    return task.TakeResult_();
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <d3d12.h>
+#include <cstdint>
+#include <cstring>
+
+// Состояние одного CL/бандла на CPU: Set* уходит в CL, только если значение поменялось.
+// Соседние объекты в куске RenderObjectBatch обычно делят PSO, RS, таблицу сэмплеров и
+// часто меш — их повторная установка отсекается здесь. Кэш живёт, пока пишется CL
+// (в RenderObjectBatch — на стеке куска); кто пишет в CL в обход него, зовёт Invalidate().
+class BindStateCache {
+public:
+    static constexpr uint32_t kMaxRootParams = 16;      // индексы дальше — всегда Set
+    static constexpr uint32_t kMaxCachedConstants = 16; // DWORD'ов root-констант на параметр
+
+    void Invalidate() {
+        rootSig_ = nullptr;
+        pso_ = nullptr;
+        rootValid_ = 0;
+        vbValid_ = ibValid_ = topologyValid_ = false;
+    }
+
+    void SetRootSignature(ID3D12GraphicsCommandList* cl, ID3D12RootSignature* rs, bool compute) {
+        if (rootSig_ == rs && rootSigCompute_ == compute) {
+            ++skipped_;
+            return;
+        }
+        if (compute) { cl->SetComputeRootSignature(rs); }
+        else { cl->SetGraphicsRootSignature(rs); }
+        rootSig_ = rs;
+        rootSigCompute_ = compute;
+        rootValid_ = 0; // смена RS сбрасывает все root-аргументы
+        ++issued_;
+    }
+
+    void SetPipelineState(ID3D12GraphicsCommandList* cl, ID3D12PipelineState* pso) {
+        if (pso_ == pso) {
+            ++skipped_;
+            return;
+        }
+        cl->SetPipelineState(pso);
+        pso_ = pso;
+        ++issued_;
+    }
+
+    void SetRootCBV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (Cached_(index, Kind_::CBV, va)) {
+            return;
+        }
+        if (compute) { cl->SetComputeRootConstantBufferView(index, va); }
+        else { cl->SetGraphicsRootConstantBufferView(index, va); }
+    }
+
+    void SetRootSRV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (Cached_(index, Kind_::SRV, va)) {
+            return;
+        }
+        if (compute) { cl->SetComputeRootShaderResourceView(index, va); }
+        else { cl->SetGraphicsRootShaderResourceView(index, va); }
+    }
+
+    void SetRootUAV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (Cached_(index, Kind_::UAV, va)) {
+            return;
+        }
+        if (compute) { cl->SetComputeRootUnorderedAccessView(index, va); }
+        else { cl->SetGraphicsRootUnorderedAccessView(index, va); }
+    }
+
+    void SetRootTable(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_DESCRIPTOR_HANDLE h) {
+        if (Cached_(index, Kind_::Table, h.ptr)) {
+            return;
+        }
+        if (compute) { cl->SetComputeRootDescriptorTable(index, h); }
+        else { cl->SetGraphicsRootDescriptorTable(index, h); }
+    }
+
+    void SetRootConstants(ID3D12GraphicsCommandList* cl, bool compute, UINT index, UINT count, const uint32_t* data) {
+        const bool cacheable = index < kMaxRootParams && count <= kMaxCachedConstants;
+        if (cacheable && (rootValid_ & (1u << index)) && slots_[index].kind == Kind_::Constants &&
+            slots_[index].value == count && std::memcmp(constants_[index], data, count * sizeof(uint32_t)) == 0) {
+            ++skipped_;
+            return;
+        }
+        if (compute) { cl->SetComputeRoot32BitConstants(index, count, data, 0); }
+        else { cl->SetGraphicsRoot32BitConstants(index, count, data, 0); }
+        if (cacheable) {
+            slots_[index] = { count, Kind_::Constants };
+            std::memcpy(constants_[index], data, count * sizeof(uint32_t));
+            rootValid_ |= 1u << index;
+        }
+        else if (index < kMaxRootParams) {
+            rootValid_ &= ~(1u << index);
+        }
+        ++issued_;
+    }
+
+    // IA: слот 0 — других в проекте нет
+    void SetVertexBuffer(ID3D12GraphicsCommandList* cl, const D3D12_VERTEX_BUFFER_VIEW& vbv) {
+        if (vbValid_ && vb_.BufferLocation == vbv.BufferLocation && vb_.SizeInBytes == vbv.SizeInBytes &&
+            vb_.StrideInBytes == vbv.StrideInBytes) {
+            ++skipped_;
+            return;
+        }
+        cl->IASetVertexBuffers(0, 1, &vbv);
+        vb_ = vbv;
+        vbValid_ = true;
+        ++issued_;
+    }
+
+    void SetIndexBuffer(ID3D12GraphicsCommandList* cl, const D3D12_INDEX_BUFFER_VIEW& ibv) {
+        if (ibValid_ && ib_.BufferLocation == ibv.BufferLocation && ib_.SizeInBytes == ibv.SizeInBytes &&
+            ib_.Format == ibv.Format) {
+            ++skipped_;
+            return;
+        }
+        cl->IASetIndexBuffer(&ibv);
+        ib_ = ibv;
+        ibValid_ = true;
+        ++issued_;
+    }
+
+    void SetPrimitiveTopology(ID3D12GraphicsCommandList* cl, D3D12_PRIMITIVE_TOPOLOGY topology) {
+        if (topologyValid_ && topology_ == topology) {
+            ++skipped_;
+            return;
+        }
+        cl->IASetPrimitiveTopology(topology);
+        topology_ = topology;
+        topologyValid_ = true;
+        ++issued_;
+    }
+
+    // Set* ушедших в CL / отсечённых за время жизни кэша
+    uint64_t Issued() const { return issued_; }
+    uint64_t Skipped() const { return skipped_; }
+
+private:
+    enum class Kind_ : uint8_t { CBV, SRV, UAV, Table, Constants };
+    struct Slot_ {
+        uint64_t value = 0; // адрес / ptr таблицы / число констант
+        Kind_ kind = Kind_::CBV;
+    };
+
+    // true — значение уже стоит (Set не нужен); иначе запоминаем новое
+    bool Cached_(UINT index, Kind_ kind, uint64_t value) {
+        if (index >= kMaxRootParams) {
+            ++issued_;
+            return false;
+        }
+        const uint32_t bit = 1u << index;
+        if ((rootValid_ & bit) && slots_[index].kind == kind && slots_[index].value == value) {
+            ++skipped_;
+            return true;
+        }
+        slots_[index] = { value, kind };
+        rootValid_ |= bit;
+        ++issued_;
+        return false;
+    }
+
+    ID3D12RootSignature* rootSig_ = nullptr;
+    bool                 rootSigCompute_ = false;
+    ID3D12PipelineState* pso_ = nullptr;
+
+    uint32_t rootValid_ = 0; // бит на root-параметр: slots_[i] актуален
+    Slot_    slots_[kMaxRootParams];
+    uint32_t constants_[kMaxRootParams][kMaxCachedConstants]; // читаются только при валидном бите
+
+    D3D12_VERTEX_BUFFER_VIEW vb_{};
+    D3D12_INDEX_BUFFER_VIEW  ib_{};
+    D3D12_PRIMITIVE_TOPOLOGY topology_ = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    bool vbValid_ = false, ibValid_ = false, topologyValid_ = false;
+
+    uint64_t issued_ = 0, skipped_ = 0;
+};
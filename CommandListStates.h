@@ -0,0 +1,58 @@
+#pragma once
+#include <d3d12.h>
+#include <span>
+#include <vector>
+
+// Состояния ресурсов в пределах одного CL. Пишущий поток не знает, в каком состоянии
+// ресурс придёт к началу его CL (это решает порядок сабмита, а не порядок записи),
+// поэтому запоминаем только ожидаемое состояние на первом использовании и итоговое.
+// Переходы внутри CL — обычные барьеры между известными состояниями; вход в CL
+// Renderer сверяет с глобальными состояниями при сабмите и при нужде вставляет fix-up.
+class CommandListStates {
+public:
+    struct Entry {
+        ID3D12Resource* res = nullptr;
+        D3D12_RESOURCE_STATES first = D3D12_RESOURCE_STATE_COMMON; // нужно к началу CL
+        D3D12_RESOURCE_STATES last = D3D12_RESOURCE_STATE_COMMON;  // после CL
+    };
+
+    void Reset() { entries_.clear(); }
+
+    // Состояния, в которые/из которых переводит COMPUTE-CL (COMMON тоже)
+    static bool IsComputeState(D3D12_RESOURCE_STATES s) {
+        constexpr D3D12_RESOURCE_STATES kCompute =
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+            D3D12_RESOURCE_STATE_COPY_SOURCE | D3D12_RESOURCE_STATE_COPY_DEST |
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+        return (s & ~kCompute) == 0;
+    }
+
+    // Перевести res в after. true — переход внутри CL, барьер в out нужно записать;
+    // false — барьер не нужен (уже в after или первое использование: его закроет сабмит)
+    bool Transition(ID3D12Resource* res, D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER& out) {
+        // Линейно: в одном CL — единицы ресурсов
+        for (Entry& e : entries_) {
+            if (e.res != res) {
+                continue;
+            }
+            if (e.last == after) {
+                return false;
+            }
+            out = {};
+            out.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            out.Transition.pResource = res;
+            out.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            out.Transition.StateBefore = e.last;
+            out.Transition.StateAfter = after;
+            e.last = after;
+            return true;
+        }
+        entries_.push_back({ res, after, after });
+        return false;
+    }
+
+    std::span<const Entry> Entries() const { return entries_; }
+
+private:
+    std::vector<Entry> entries_; // ёмкость переживает кадр (пул в FrameResource)
+};
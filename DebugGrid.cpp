@@ -75,14 +75,14 @@ public:
 
     void UpdateUniforms(Renderer* /*renderer*/, const mat4& view, const mat4& proj) override
     {
-        mat4 mvp = (GetModelMatrix() * view * proj);
+        mat4 mvp = (GetRenderModelMatrix() * view * proj);
         UpdateUniform("modelViewProj", mvp.xm());
     }
 
-    void IssueDraw(Renderer* /*renderer*/, ID3D12GraphicsCommandList* cl) override
+    void IssueDraw(Renderer* /*renderer*/, ID3D12GraphicsCommandList* cl, BindStateCache& cache) override
     {
-        cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-        cl->IASetVertexBuffers(0, 1, &vbv_);
+        cache.SetPrimitiveTopology(cl, D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+        cache.SetVertexBuffer(cl, vbv_);
         if (vertexCount_ > 0u) {
             cl->DrawInstanced(vertexCount_, 1, 0, 0);
         }
@@ -182,7 +182,7 @@ public:
 
     void UpdateUniforms(Renderer* r, const mat4& view, const mat4& proj) override
     {
-        mat4 mvp = (GetModelMatrix() * view * proj);
+        mat4 mvp = (GetRenderModelMatrix() * view * proj);
         UpdateUniform("modelViewProj", mvp.xm());
 
         const UINT w = r->GetWidth();
@@ -190,10 +190,10 @@ public:
         UpdateUniform("viewportThickness", XMFLOAT4(float(w), float(h), thicknessPx_, 0.0f));
     }
 
-    void IssueDraw(Renderer* /*renderer*/, ID3D12GraphicsCommandList* cl) override
+    void IssueDraw(Renderer* /*renderer*/, ID3D12GraphicsCommandList* cl, BindStateCache& cache) override
     {
-        cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        cl->IASetVertexBuffers(0, 1, &vbv_);
+        cache.SetPrimitiveTopology(cl, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        cache.SetVertexBuffer(cl, vbv_);
         if (vertexCount_ > 0u) {
             cl->DrawInstanced(vertexCount_, 1, 0, 0);
         }
@@ -279,15 +279,22 @@ void DebugGrid::Tick(float dt)
     (void)dt; // сейчас нечего анимировать, но оставим хук
 }
 
+void DebugGrid::PublishRenderState()
+{
+    grid_->PublishRenderState();
+    axes_->PublishRenderState();
+}
+
 void DebugGrid::Render(Renderer* renderer,
     ID3D12GraphicsCommandList* cl,
     const mat4& view,
-    const mat4& proj)
+    const mat4& proj,
+    BindStateCache& cache)
 {
     if (grid_) {
-        grid_->Render(renderer, cl, view, proj);
+        grid_->Render(renderer, cl, view, proj, cache);
     }
     if (axes_) {
-        axes_->Render(renderer, cl, view, proj);
+        axes_->Render(renderer, cl, view, proj, cache);
     }
 }
\ No newline at end of file
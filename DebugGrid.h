@@ -23,11 +23,13 @@ public:
         std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive) override;
 
     void Tick(float dt) override;
+    void PublishRenderState() override;
 
     void Render(Renderer* renderer,
         ID3D12GraphicsCommandList* cl,
         const mat4& view,
-        const mat4& proj) override;
+        const mat4& proj,
+        BindStateCache& cache) override;
 
     bool IsTransparent() const override { return true; }
     bool IsSimpleRender() const override { return true; }
@@ -5,9 +5,11 @@
 #include <cstdint>
 #include <stdexcept>
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include "DescriptorAllocator.h"
+#include "CommandListStates.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -37,13 +39,31 @@ public:
         return commandAllocPools_.Acquire(dev, type);
     }
 
-    void ResetCommandListsUsage() { clPools_.ResetUsage(); }
+    void ResetCommandListsUsage() {
+        clPools_.ResetUsage();
+        clStatesUsed_.store(0u, std::memory_order_release);
+    }
     ID3D12GraphicsCommandList* AcquireCommandList(ID3D12Device* dev,
         D3D12_COMMAND_LIST_TYPE type,
         ID3D12CommandAllocator* alloc,
         ID3D12PipelineState* pso = nullptr) {
         return clPools_.Acquire(dev, type, alloc, pso);
     }
+    // Локальные состояния ресурсов для CL (пустые); живут до ResetCommandListsUsage.
+    // Берутся лениво, на первом Renderer::Transition — редкость, поэтому просто под локом
+    CommandListStates* AcquireCommandListStates() {
+        const UINT index = clStatesUsed_.fetch_add(1u, std::memory_order_acq_rel);
+        CommandListStates* states = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(clStatesMtx_);
+            while (index >= clStates_.size()) {
+                clStates_.push_back(std::make_unique<CommandListStates>());
+            }
+            states = clStates_[index].get();
+        }
+        states->Reset();
+        return states;
+    }
 
     DescriptorAllocator& GetDescAlloc() { return descAlloc_; }
     DescriptorAllocator& GetSamplerAlloc() { return samplerAlloc_; }
@@ -148,6 +168,10 @@ private:
     CommandAllocPools_ commandAllocPools_;
     CommandListPools_ clPools_;
 
+    std::vector<std::unique_ptr<CommandListStates>> clStates_;
+    std::atomic<UINT> clStatesUsed_{ 0 };
+    std::mutex clStatesMtx_;
+
     // ==== Upload ring data ====
     Microsoft::WRL::ComPtr<ID3D12Resource> upload_;
     void* uploadCPU_ = nullptr;
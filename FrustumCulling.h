@@ -0,0 +1,136 @@
+#pragma once
+#include <DirectXMath.h>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "TaskSystem.h"
+
+// Отсечение по пирамиде видимости. Мировые AABB объектов лежат в SoA (центр и полуразмер
+// по осям), тест AABB-против-плоскости идёт по 4 бокса за раз на векторах DirectXMath
+// (SSE/NEON), группы по 4 — кусками ParallelForRange. Бокс снаружи, если для какой-то
+// плоскости n·c + |n|·e < 0. Консервативно: бокс у угла пирамиды может остаться видимым.
+
+struct Frustum {
+    DirectX::XMFLOAT4 planes[6]; // (n, d), нормали внутрь: n·p + d >= 0 — по эту сторону
+
+    // Строки-векторы (p * view * proj), глубина D3D [0, w]
+    static Frustum FromViewProj(const Math::mat4& viewProj) {
+        const DirectX::XMFLOAT4X4& m = viewProj.m;
+        const float c[4][4] = {
+            { m._11, m._21, m._31, m._41 },
+            { m._12, m._22, m._32, m._42 },
+            { m._13, m._23, m._33, m._43 },
+            { m._14, m._24, m._34, m._44 },
+        };
+        Frustum f{};
+        auto set = [&](int i, float s0, int a, float s1, int b) {
+            float p[4];
+            for (int k = 0; k < 4; ++k) {
+                p[k] = s0 * c[a][k] + s1 * c[b][k];
+            }
+            const float len = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+            const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            f.planes[i] = { p[0] * inv, p[1] * inv, p[2] * inv, p[3] * inv };
+        };
+        set(0, 1.0f, 3,  1.0f, 0); // left:   w + x
+        set(1, 1.0f, 3, -1.0f, 0); // right:  w - x
+        set(2, 1.0f, 3,  1.0f, 1); // bottom: w + y
+        set(3, 1.0f, 3, -1.0f, 1); // top:    w - y
+        set(4, 0.0f, 3,  1.0f, 2); // near:   z
+        set(5, 1.0f, 3, -1.0f, 2); // far:    w - z
+        return f;
+    }
+};
+
+class FrustumCuller {
+public:
+    struct Stats {
+        size_t drawn = 0;
+        size_t culled = 0;
+    };
+
+    // n объектов; ёмкость SoA переживает кадры (дополнено до кратного 4)
+    void Resize(size_t n) {
+        count_ = n;
+        const size_t padded = (n + 3) & ~size_t(3);
+        for (std::vector<float>* v : { &cx_, &cy_, &cz_, &ex_, &ey_, &ez_ }) {
+            v->resize(padded);
+        }
+        unbounded_.resize(padded);
+        visible_.resize(padded);
+    }
+
+    // Из разных потоков — по разным i
+    void SetBounds(size_t i, const Math::AABB& b) {
+        const Math::float3 c = b.Center();
+        const Math::float3 e = b.Extents();
+        cx_[i] = c.x; cy_[i] = c.y; cz_[i] = c.z;
+        ex_[i] = e.x; ey_[i] = e.y; ez_[i] = e.z;
+        unbounded_[i] = 0;
+    }
+    // Без границ (инстансы на GPU, сетка и т.п.) — виден всегда
+    void SetUnbounded(size_t i) {
+        cx_[i] = cy_[i] = cz_[i] = 0.0f;
+        ex_[i] = ey_[i] = ez_[i] = 0.0f;
+        unbounded_[i] = 1;
+    }
+
+    Stats Cull(const Frustum& f, ParallelForTuner* tuner = nullptr) {
+        using namespace DirectX;
+        const size_t groups = (count_ + 3) / 4;
+        std::atomic<size_t> drawn{ 0 };
+
+        TaskSystem::Get().ParallelForRange(0, groups, [this, &f, &drawn](size_t begin, size_t end) {
+            size_t localDrawn = 0;
+            for (size_t g = begin; g < end; ++g) {
+                const size_t i = g * 4;
+                const XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&cx_[i]));
+                const XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&cy_[i]));
+                const XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&cz_[i]));
+                const XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ex_[i]));
+                const XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ey_[i]));
+                const XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&ez_[i]));
+
+                XMVECTOR inside = XMVectorTrueInt();
+                for (const XMFLOAT4& p : f.planes) {
+                    // n·c + d + |n|·e по четырём боксам сразу
+                    XMVECTOR d = XMVectorReplicate(p.w);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(p.x), cx, d);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(p.y), cy, d);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(p.z), cz, d);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(std::fabs(p.x)), ex, d);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(std::fabs(p.y)), ey, d);
+                    d = XMVectorMultiplyAdd(XMVectorReplicate(std::fabs(p.z)), ez, d);
+                    inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(d, XMVectorZero()));
+                }
+
+                XMUINT4 mask;
+                XMStoreUInt4(&mask, inside);
+                const uint32_t bits[4] = { mask.x, mask.y, mask.z, mask.w };
+                for (size_t k = 0; k < 4 && i + k < count_; ++k) {
+                    const bool v = bits[k] != 0 || unbounded_[i + k] != 0;
+                    visible_[i + k] = v ? 1 : 0;
+                    localDrawn += v ? 1 : 0;
+                }
+            }
+            drawn.fetch_add(localDrawn, std::memory_order_relaxed);
+        }, TaskSystem::kAutoGrain, tuner);
+
+        Stats s;
+        s.drawn = drawn.load(std::memory_order_relaxed);
+        s.culled = count_ - s.drawn;
+        return s;
+    }
+
+    bool IsVisible(size_t i) const { return visible_[i] != 0; }
+
+private:
+    std::vector<float> cx_, cy_, cz_; // центры
+    std::vector<float> ex_, ey_, ez_; // полуразмеры
+    std::vector<uint8_t> unbounded_;
+    std::vector<uint8_t> visible_;
+    size_t count_ = 0;
+};
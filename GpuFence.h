@@ -0,0 +1,67 @@
+#pragma once
+#include <windows.h>
+#include <d3d12.h>
+#include <atomic>
+#include <coroutine>
+
+#include "Helpers.h"
+#include "TaskSystem.h"
+
+// co_await GpuFence{ fence, value } — продолжить корутину, когда GPU дойдёт до value.
+// Ожидание не держит ни одного потока: событие фенса ждёт системный thread pool,
+// а продолжение уходит в TaskSystem с заданным приоритетом.
+class GpuFence {
+public:
+    GpuFence(ID3D12Fence* fence, UINT64 value, TaskPriority priority = TaskPriority::Normal)
+        : fence_(fence), value_(value), priority_(priority) {}
+
+    GpuFence(const GpuFence&) = delete;
+    GpuFence& operator=(const GpuFence&) = delete;
+
+    bool IsCompleted() const { return !fence_ || fence_->GetCompletedValue() >= value_; }
+    UINT64 Value() const { return value_; }
+
+    bool await_ready() const { return IsCompleted(); }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+        event_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        ThrowIfFailed(fence_->SetEventOnCompletion(value_, event_));
+        if (!RegisterWaitForSingleObject(&wait_, event_, &OnSignaled_, this, INFINITE, WT_EXECUTEONLYONCE)) {
+            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        }
+        // Колбэк мог сработать раньше, чем wait_ записан: возобновляет тот, кто пришёл вторым
+        Arrive_();
+    }
+
+    void await_resume() {
+        if (wait_) {
+            UnregisterWaitEx(wait_, INVALID_HANDLE_VALUE); // дождаться выхода из колбэка
+            wait_ = nullptr;
+        }
+        if (event_) {
+            CloseHandle(event_);
+            event_ = nullptr;
+        }
+    }
+
+private:
+    static void CALLBACK OnSignaled_(void* ctx, BOOLEAN /*timedOut*/) {
+        static_cast<GpuFence*>(ctx)->Arrive_();
+    }
+
+    void Arrive_() {
+        if (arrivals_.fetch_add(1, std::memory_order_acq_rel) == 1) {
+            std::coroutine_handle<> h = handle_;
+            TaskSystem::Get().Submit([h] { h.resume(); }, priority_);
+        }
+    }
+
+    ID3D12Fence*        fence_ = nullptr;
+    UINT64              value_ = 0;
+    TaskPriority        priority_ = TaskPriority::Normal;
+    std::coroutine_handle<> handle_;
+    HANDLE              event_ = nullptr;
+    HANDLE              wait_ = nullptr;
+    std::atomic<int>    arrivals_{ 0 };
+};
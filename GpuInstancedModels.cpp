@@ -25,6 +25,12 @@ GpuInstancedModels::GpuInstancedModels(
 {
 }
 
+AsyncTask<void> GpuInstancedModels::PreloadAsync(Renderer* renderer)
+{
+    co_await WhenAll(RenderableObject::PreloadAsync(renderer),
+                     renderer->GetMeshManager()->LoadAsync(modelName_, renderer, { true, false, 0 }));
+}
+
 void GpuInstancedModels::Init(Renderer* renderer,
     ID3D12GraphicsCommandList* uploadCmdList,
     std::vector<ComPtr<ID3D12Resource>>* uploadKeepAlive)
@@ -55,14 +61,12 @@ void GpuInstancedModels::Init(Renderer* renderer,
     modelMatrix_ = mat4::Translation({0.0f, 5.0f, 0.0f});
 }
 
-void GpuInstancedModels::RecordCompute(Renderer* renderer, ID3D12GraphicsCommandList* cl)
+// COMPUTE-CL на асинхронной очереди; UAV на входе и SRV для GBuffer выставляет граф
+void GpuInstancedModels::RecordAsyncCompute(Renderer* renderer, ID3D12GraphicsCommandList* cl)
 {
-    // Переход в UAV (если нужно)
-    renderer->Transition(cl, instanceBuffer_.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
     // constants(b0) для CS
     uint32_t dtBits = 0, angBits = 0;
-    memcpy(&dtBits, &deltaTime_, sizeof(float));
+    memcpy(&dtBits, &renderDeltaTime_, sizeof(float));
     memcpy(&angBits, &angularSpeed_, sizeof(float));
     computeCtx_.constants[0] = { dtBits, angBits, instanceCount_ };
 
@@ -71,12 +75,10 @@ void GpuInstancedModels::RecordCompute(Renderer* renderer, ID3D12GraphicsCommand
     computeCtx_.table[0] = uavTbl.gpu;
 
     // Запуск CS
-    computeMaterial_->Bind(cl, computeCtx_);
+    renderer->AddBindStats(computeMaterial_->Bind(cl, computeCtx_), 0);
     constexpr UINT THREADS_PER_GROUP = 64;
     const UINT groups = (instanceCount_ + THREADS_PER_GROUP - 1u) / THREADS_PER_GROUP;
     cl->Dispatch(groups, 1, 1);
-
-    renderer->UAVBarrier(cl, instanceBuffer_.GetResource());
 }
 
 void GpuInstancedModels::PopulateContext(Renderer* renderer, ID3D12GraphicsCommandList* cl)
@@ -93,32 +95,35 @@ void GpuInstancedModels::PopulateContext(Renderer* renderer, ID3D12GraphicsComma
     graphicsCtx_.samplerTable[0] = renderer->GetSamplerManager()->Get(renderer, aniso);
 }
 
-void GpuInstancedModels::RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl)
+void GpuInstancedModels::RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache)
 {
-    const D3D12_RESOURCE_STATES kSRV =
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-    renderer->Transition(cl, instanceBuffer_.GetResource(), kSRV);
-
-	RenderableObject::RecordGraphics(renderer, cl);
+    // instanceBuffer_ уже в SRV: GBuffer объявляет его чтение после compute-пасса
+	RenderableObject::RecordGraphics(renderer, cl, cache);
 }
 
 void GpuInstancedModels::UpdateUniforms(Renderer* renderer, const mat4& view, const mat4& proj)
 {
-    UpdateUniform("world", modelMatrix_.xm());
+    UpdateUniform("world", renderModelMatrix_.xm());
     UpdateUniform("view", view.xm());
     UpdateUniform("proj", proj.xm());
 
     ApplyMaterialParamsToCB();
 }
 
-void GpuInstancedModels::IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl)
+void GpuInstancedModels::IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache)
 {
     if (!renderer) { return; }
 	if (!cl) { return; }
-    mesh_->DrawInstanced(cl, instanceCount_);
+    mesh_->DrawInstanced(cl, instanceCount_, &cache);
 }
 
 void GpuInstancedModels::Tick(float deltaTime)
 {
     deltaTime_ = deltaTime;
+}
+
+void GpuInstancedModels::PublishRenderState()
+{
+    RenderableObject::PublishRenderState();
+    renderDeltaTime_ = deltaTime_;
 }
\ No newline at end of file
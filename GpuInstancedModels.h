@@ -21,22 +21,29 @@ public:
     void Init(Renderer* renderer,
         ID3D12GraphicsCommandList* uploadCmdList,
         std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive) override;
+    AsyncTask<void> PreloadAsync(Renderer* renderer) override;
 
     void Tick(float deltaTime) override;
+    void PublishRenderState() override;
     bool IsSimpleRender() const {return false;}
+    // Инстансы раскладывает compute на GPU — границ на CPU нет, не отсекаем
+    bool GetWorldBounds(Math::AABB& /*out*/) const override { return false; }
+
+    ID3D12Resource* GetAsyncComputeOutput() const override { return instanceBuffer_.GetResource(); }
+    void RecordAsyncCompute(Renderer* renderer, ID3D12GraphicsCommandList* cl) override;
 
 protected:
-    void RecordCompute(Renderer* renderer, ID3D12GraphicsCommandList* cl) override;
-    void RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl) override;
+    void RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache) override;
     void PopulateContext(Renderer* renderer, ID3D12GraphicsCommandList* cl) override;
     void UpdateUniforms(Renderer* renderer, const mat4& view, const mat4& proj) override;
-    void IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl) override;
+    void IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache) override;
 
 private:
     // данные инстансинга
     InstanceBuffer instanceBuffer_;
     UINT instanceCount_ = 0;
     float deltaTime_ = 0.0f;
+    float renderDeltaTime_ = 0.0f; // опубликованный dt для CS кадра
     float angularSpeed_ = DirectX::XM_PIDIV2;
 
     // compute
@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Счётчик "не влезло в буфер" — общий для всех инстансов шаблона (для бенчмарков/статистики)
+struct InlineFunctionStats {
+    static inline std::atomic<uint64_t> heapFallbacks{ 0 };
+};
+
+template<typename Sig, std::size_t Capacity = 64>
+class InlineFunction;
+
+// Замена std::function с буфером на Capacity байт прямо в объекте: вызываемое размером
+// до Capacity не трогает кучу вообще. Большее уходит в кучу (и считается в InlineFunctionStats).
+// Как и std::function, требует копируемого вызываемого.
+template<typename R, typename... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+public:
+    // 16 — чтобы XMVECTOR/XMMATRIX в захвате тоже влезали inline
+    static constexpr std::size_t kAlign = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16;
+
+    InlineFunction() noexcept = default;
+    InlineFunction(std::nullptr_t) noexcept {}
+
+    template<typename F,
+        typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction> &&
+                                    std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+    InlineFunction(F&& f) {
+        Emplace_<std::decay_t<F>>(std::forward<F>(f));
+    }
+
+    InlineFunction(const InlineFunction& o) {
+        if (o.ops_) {
+            o.ops_->copy(storage_, o.storage_);
+            ops_ = o.ops_;
+        }
+    }
+
+    InlineFunction(InlineFunction&& o) noexcept {
+        if (o.ops_) {
+            o.ops_->move(storage_, o.storage_);
+            ops_ = o.ops_;
+            o.ops_ = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(const InlineFunction& o) {
+        if (this != &o) {
+            InlineFunction tmp(o);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(InlineFunction&& o) noexcept {
+        if (this != &o) {
+            Reset();
+            if (o.ops_) {
+                o.ops_->move(storage_, o.storage_);
+                ops_ = o.ops_;
+                o.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    ~InlineFunction() { Reset(); }
+
+    void Reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    R operator()(Args... args) const {
+        return ops_->invoke(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+    }
+
+    template<typename F>
+    static constexpr bool FitsInline() {
+        return sizeof(F) <= Capacity && alignof(F) <= kAlign &&
+               std::is_nothrow_move_constructible_v<F>;
+    }
+
+private:
+    struct Ops_ {
+        R    (*invoke)(void* self, Args&&... args);
+        void (*copy)(void* dst, const void* src);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* self) noexcept;
+    };
+
+    template<typename F>
+    struct InlineOps_ {
+        static F* Get(void* p) { return std::launder(reinterpret_cast<F*>(p)); }
+        static R Invoke(void* p, Args&&... args) { return (*Get(p))(std::forward<Args>(args)...); }
+        static void Copy(void* dst, const void* src) { ::new (dst) F(*Get(const_cast<void*>(src))); }
+        static void Move(void* dst, void* src) noexcept {
+            ::new (dst) F(std::move(*Get(src)));
+            Get(src)->~F();
+        }
+        static void Destroy(void* p) noexcept { Get(p)->~F(); }
+        static constexpr Ops_ kOps{ &Invoke, &Copy, &Move, &Destroy };
+    };
+
+    template<typename F>
+    struct HeapOps_ {
+        static F*& Get(void* p) { return *std::launder(reinterpret_cast<F**>(p)); }
+        static R Invoke(void* p, Args&&... args) { return (*Get(p))(std::forward<Args>(args)...); }
+        static void Copy(void* dst, const void* src) {
+            InlineFunctionStats::heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+            ::new (dst) F*(new F(*Get(const_cast<void*>(src))));
+        }
+        static void Move(void* dst, void* src) noexcept {
+            ::new (dst) F*(Get(src));
+            Get(src) = nullptr;
+        }
+        static void Destroy(void* p) noexcept { delete Get(p); }
+        static constexpr Ops_ kOps{ &Invoke, &Copy, &Move, &Destroy };
+    };
+
+    template<typename F, typename Arg>
+    void Emplace_(Arg&& f) {
+        if constexpr (FitsInline<F>()) {
+            ::new (storage_) F(std::forward<Arg>(f));
+            ops_ = &InlineOps_<F>::kOps;
+        }
+        else {
+            InlineFunctionStats::heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+            ::new (storage_) F*(new F(std::forward<Arg>(f)));
+            ops_ = &HeapOps_<F>::kOps;
+        }
+    }
+
+private:
+    alignas(kAlign) unsigned char storage_[Capacity < sizeof(void*) ? sizeof(void*) : Capacity];
+    const Ops_* ops_ = nullptr;
+};
@@ -397,6 +397,7 @@ void Material::CreateGraphics(Renderer* r, const GraphicsDesc& gd)
     }
 
     rootParams_ = std::move(params);
+    BuildBindSlots_();
 
     {
         std::lock_guard<std::mutex> lk(watchMtx_);
@@ -423,6 +424,7 @@ void Material::CreateCompute(Renderer* r, const ComputeDesc& cd)
     rootSignature_ = rs;
     pipelineState_ = pso;
     rootParams_ = std::move(params);
+    BuildBindSlots_();
 
     {
         std::lock_guard<std::mutex> lk(watchMtx_);
@@ -461,6 +463,7 @@ bool Material::HotReloadIfPending(Renderer* r, uint64_t frameNumber, uint64_t ke
     pipelineStateWire_ = newPSOWire;
     rootSignature_ = newRS;
     rootParams_ = std::move(newParams);
+    BuildBindSlots_();
 
     {
         std::lock_guard<std::mutex> lk(watchMtx_);
@@ -485,77 +488,126 @@ void Material::CollectRetired(uint64_t frameNumber, uint64_t keepAliveFrames)
     }
 }
 
-void Material::Bind(ID3D12GraphicsCommandList* cmdList, const RenderContext& ctx, bool wireframe) const
+namespace {
+// Set* без кэша — тот же интерфейс, что у BindStateCache, только счёт ушедших в CL
+struct DirectBinds {
+    uint32_t issued = 0;
+
+    void SetRootSignature(ID3D12GraphicsCommandList* cl, ID3D12RootSignature* rs, bool compute) {
+        if (compute) { cl->SetComputeRootSignature(rs); }
+        else { cl->SetGraphicsRootSignature(rs); }
+        ++issued;
+    }
+    void SetPipelineState(ID3D12GraphicsCommandList* cl, ID3D12PipelineState* pso) {
+        cl->SetPipelineState(pso);
+        ++issued;
+    }
+    void SetRootCBV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (compute) { cl->SetComputeRootConstantBufferView(index, va); }
+        else { cl->SetGraphicsRootConstantBufferView(index, va); }
+        ++issued;
+    }
+    void SetRootSRV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (compute) { cl->SetComputeRootShaderResourceView(index, va); }
+        else { cl->SetGraphicsRootShaderResourceView(index, va); }
+        ++issued;
+    }
+    void SetRootUAV(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_VIRTUAL_ADDRESS va) {
+        if (compute) { cl->SetComputeRootUnorderedAccessView(index, va); }
+        else { cl->SetGraphicsRootUnorderedAccessView(index, va); }
+        ++issued;
+    }
+    void SetRootTable(ID3D12GraphicsCommandList* cl, bool compute, UINT index, D3D12_GPU_DESCRIPTOR_HANDLE h) {
+        if (compute) { cl->SetComputeRootDescriptorTable(index, h); }
+        else { cl->SetGraphicsRootDescriptorTable(index, h); }
+        ++issued;
+    }
+    void SetRootConstants(ID3D12GraphicsCommandList* cl, bool compute, UINT index, UINT count, const uint32_t* data) {
+        if (compute) { cl->SetComputeRoot32BitConstants(index, count, data, 0); }
+        else { cl->SetGraphicsRoot32BitConstants(index, count, data, 0); }
+        ++issued;
+    }
+};
+}
+
+uint32_t Material::Bind(ID3D12GraphicsCommandList* cmdList, const RenderContext& ctx, bool wireframe,
+    BindStateCache* cache) const
+{
+    if (cache != nullptr) {
+        Bind_(*cache, cmdList, ctx, wireframe);
+        return 0;
+    }
+    DirectBinds direct;
+    Bind_(direct, cmdList, ctx, wireframe);
+    return direct.issued;
+}
+
+template<typename Sink>
+void Material::Bind_(Sink& c, ID3D12GraphicsCommandList* cmdList, const RenderContext& ctx, bool wireframe) const
 {
-    if (isCompute_) { cmdList->SetComputeRootSignature(rootSignature_.Get()); }
-    else { cmdList->SetGraphicsRootSignature(rootSignature_.Get()); }
+    c.SetRootSignature(cmdList, rootSignature_.Get(), isCompute_);
 
     if (wireframe && pipelineStateWire_)
     {
-        cmdList->SetPipelineState(pipelineStateWire_.Get());
+        c.SetPipelineState(cmdList, pipelineStateWire_.Get());
     }else
     {
-	    cmdList->SetPipelineState(pipelineState_.Get());
+	    c.SetPipelineState(cmdList, pipelineState_.Get());
     }
 
-    for (const auto& p : rootParams_) {
-        uint32_t reg = p.bindingRegister;
-        switch (p.type) {
+    for (const BindSlot_& s : bindSlots_) {
+        switch (s.type) {
         case RootParameterInfo::Constants:
-        {
-            auto it = ctx.constants.find(reg);
-            if (it != ctx.constants.end() && !it->second.empty()) {
-                if (isCompute_) { cmdList->SetComputeRoot32BitConstants(p.rootIndex, (UINT)it->second.size(), it->second.data(), 0); }
-                else { cmdList->SetGraphicsRoot32BitConstants(p.rootIndex, (UINT)it->second.size(), it->second.data(), 0); }
+            if (ctx.constants.Has(s.reg)) {
+                const RenderContext::RootConstants& k = ctx.constants.Get(s.reg);
+                if (k.count != 0) {
+                    c.SetRootConstants(cmdList, isCompute_, s.rootIndex, k.count, k.data);
+                }
             }
             break;
-        }
         case RootParameterInfo::CBV:
-        {
-            auto it = ctx.cbv.find(reg);
-            if (it != ctx.cbv.end()) {
-                if (isCompute_) { cmdList->SetComputeRootConstantBufferView(p.rootIndex, it->second); }
-                else { cmdList->SetGraphicsRootConstantBufferView(p.rootIndex, it->second); }
+            if (ctx.cbv.Has(s.reg)) {
+                c.SetRootCBV(cmdList, isCompute_, s.rootIndex, ctx.cbv.Get(s.reg));
             }
             break;
-        }
         case RootParameterInfo::SRV:
-        {
-            auto it = ctx.srv.find(reg);
-            if (it != ctx.srv.end()) {
-                if (isCompute_) { cmdList->SetComputeRootShaderResourceView(p.rootIndex, it->second); }
-                else { cmdList->SetGraphicsRootShaderResourceView(p.rootIndex, it->second); }
+            if (ctx.srv.Has(s.reg)) {
+                c.SetRootSRV(cmdList, isCompute_, s.rootIndex, ctx.srv.Get(s.reg));
             }
             break;
-        }
         case RootParameterInfo::UAV:
-        {
-            auto it = ctx.uav.find(reg);
-            if (it != ctx.uav.end()) {
-                if (isCompute_) { cmdList->SetComputeRootUnorderedAccessView(p.rootIndex, it->second); }
-                else { cmdList->SetGraphicsRootUnorderedAccessView(p.rootIndex, it->second); }
+            if (ctx.uav.Has(s.reg)) {
+                c.SetRootUAV(cmdList, isCompute_, s.rootIndex, ctx.uav.Get(s.reg));
             }
             break;
-        }
         case RootParameterInfo::Table:
-        {
-            auto it = ctx.table.find(reg);
-            if (it != ctx.table.end()) {
-                if (isCompute_) { cmdList->SetComputeRootDescriptorTable(p.rootIndex, it->second); }
-                else { cmdList->SetGraphicsRootDescriptorTable(p.rootIndex, it->second); }
+            if (ctx.table.Has(s.reg)) {
+                c.SetRootTable(cmdList, isCompute_, s.rootIndex, ctx.table.Get(s.reg));
             }
             break;
-        }
         case RootParameterInfo::TableSampler:
-        {
-            auto it = ctx.samplerTable.find(reg);
-            if (it != ctx.samplerTable.end()) {
-                if (isCompute_) { cmdList->SetComputeRootDescriptorTable(p.rootIndex, it->second); }
-                else { cmdList->SetGraphicsRootDescriptorTable(p.rootIndex, it->second); }
+            if (ctx.samplerTable.Has(s.reg)) {
+                c.SetRootTable(cmdList, isCompute_, s.rootIndex, ctx.samplerTable.Get(s.reg));
             }
             break;
         }
+    }
+}
+
+void Material::BuildBindSlots_()
+{
+    bindSlots_.clear();
+    bindSlots_.reserve(rootParams_.size());
+    for (const auto& p : rootParams_) {
+        if (p.bindingRegister >= RenderContext::kMaxRegisters) {
+            OutputDebugStringA("[Material] root parameter register exceeds RenderContext::kMaxRegisters, skipped\n");
+            continue;
         }
+        BindSlot_ s;
+        s.rootIndex = static_cast<uint16_t>(p.rootIndex);
+        s.type = static_cast<uint8_t>(p.type);
+        s.reg = static_cast<uint8_t>(p.bindingRegister);
+        bindSlots_.push_back(s);
     }
 }
 
@@ -770,6 +822,7 @@ bool MaterialManager::RequestFSProbeAsync()
         return false;
     }
 
+    // Фоновый класс: обход ФС может быть долгим, кадр его ждать не должен
     TaskSystem::Get().Submit([this]() {
         for (auto& kv : materials_) {
             auto& mat = kv.second;
@@ -778,7 +831,7 @@ bool MaterialManager::RequestFSProbeAsync()
             }
         }
         fsProbeInFlight_.store(false, std::memory_order_release);
-        });
+        }, TaskPriority::Background);
 
     return true;
 }
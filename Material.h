@@ -11,6 +11,7 @@
 #include <d3d12shader.h>
 
 #include "RenderContext.h"
+#include "BindStateCache.h"
 #include <cassert>
 
 using namespace Microsoft::WRL;
@@ -109,7 +110,11 @@ public:
     ID3D12RootSignature* GetRootSignature() const { return rootSignature_.Get(); }
     ID3D12PipelineState* GetPipelineState() const { return pipelineState_.Get(); }
 
-    void Bind(ID3D12GraphicsCommandList* cmdList, const RenderContext& ctx, bool wireframe = false) const;
+    // cache — состояние CL: уже стоящие RS/PSO/root-аргументы не переустанавливаются.
+    // Без кэша (одиночный Bind на CL) — Set* напрямую; возвращает их число для
+    // Renderer::AddBindStats, с кэшем — 0 (счёт ведёт кэш)
+    uint32_t Bind(ID3D12GraphicsCommandList* cmdList, const RenderContext& ctx, bool wireframe = false,
+        BindStateCache* cache = nullptr) const;
 
     // Хот-релоад
     bool FSProbeAndFlagPending();
@@ -181,6 +186,16 @@ private:
     ComPtr<ID3D12PipelineState> pipelineStateWire_;
     bool isCompute_ = false;
     std::vector<RootParameterInfo> rootParams_;
+    // Root-параметр -> слот RenderContext, посчитано при сборке: Bind идёт по нему подряд
+    struct BindSlot_ {
+        uint16_t rootIndex = 0;
+        uint8_t  type = 0; // RootParameterInfo::Type
+        uint8_t  reg = 0;  // < RenderContext::kMaxRegisters
+    };
+    std::vector<BindSlot_> bindSlots_;
+    void BuildBindSlots_();
+    template<typename Sink> void Bind_(Sink& sink, ID3D12GraphicsCommandList* cmdList,
+        const RenderContext& ctx, bool wireframe) const;
 
     // кэш для пересборки
     GraphicsDesc cachedGfxDesc_{};
@@ -36,6 +36,34 @@ bool MaterialData::LoadNormal(Renderer* r, ID3D12GraphicsCommandList* upload, co
     return false;
 }
 
+AsyncTask<bool> MaterialData::LoadAlbedoAsync(Renderer* r, std::wstring path)
+{
+    Texture2D::CreateDesc d{};
+    d.path  = std::move(path);
+    d.usage = Texture2D::Usage::AlbedoSRGB;
+    hasAlbedo = co_await albedo.CreateFromFileAsync(r, std::move(d));
+    co_return hasAlbedo;
+}
+
+AsyncTask<bool> MaterialData::LoadMRAsync(Renderer* r, std::wstring path)
+{
+    Texture2D::CreateDesc d{};
+    d.path  = std::move(path);
+    d.usage = Texture2D::Usage::MetalRough;
+    hasMR = co_await mr.CreateFromFileAsync(r, std::move(d));
+    co_return hasMR;
+}
+
+AsyncTask<bool> MaterialData::LoadNormalAsync(Renderer* r, std::wstring path)
+{
+    Texture2D::CreateDesc d{};
+    d.path       = std::move(path);
+    d.usage      = Texture2D::Usage::NormalMap;
+    d.normalIsRG = normalIsRG;
+    hasNormal = co_await normal.CreateFromFileAsync(r, std::move(d));
+    co_return hasNormal;
+}
+
 void MaterialData::ConfigureDefinesForGBuffer(Material::GraphicsDesc& gd) const
 {
     auto& defs = gd.defines;
@@ -60,7 +88,7 @@ void MaterialData::AppendGBufferSRVs(std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>& d
 void MaterialData::StageGBufferBindings(Renderer* r, RenderContext& ctx,
                                         UINT srvTableRegister, UINT samplerTableRegister)
 {
-    const UINT fi = r->GetCurrentFrameIndex();
+    const uint64_t fi = r->GetFrameNumber();
     std::lock_guard lck(cacheMtx_);
     if (gbufferSrvCache_.frame == fi && gbufferSrvCache_.gpu.ptr != 0) {
         ctx.table[srvTableRegister] = gbufferSrvCache_.gpu;
@@ -55,6 +55,11 @@ public:
     bool LoadNormal(Renderer* r, ID3D12GraphicsCommandList* upload, const std::wstring& path,
                     std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* keepAlive);
 
+    // асинхронная загрузка (см. Texture2D::CreateFromFileAsync); объект должен жить до завершения
+    AsyncTask<bool> LoadAlbedoAsync(Renderer* r, std::wstring path);
+    AsyncTask<bool> LoadMRAsync    (Renderer* r, std::wstring path);
+    AsyncTask<bool> LoadNormalAsync(Renderer* r, std::wstring path);
+
     // сконфигурировать defines для GBuffer-варианта (NORMALMAP_IS_RG / USE_TBN)
     void ConfigureDefinesForGBuffer(Material::GraphicsDesc& gd) const;
 
@@ -68,7 +73,7 @@ public:
 
 private:
     struct SrvCache {
-        UINT frame = UINT_MAX;
+        uint64_t frame = UINT64_MAX; // Renderer::GetFrameNumber()
         D3D12_GPU_DESCRIPTOR_HANDLE gpu{};
     } gbufferSrvCache_;
     std::mutex cacheMtx_;
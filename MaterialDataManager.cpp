@@ -5,16 +5,19 @@ using Microsoft::WRL::ComPtr;
 
 void MaterialDataManager::RegisterPreset(const std::string& name, const MaterialPreset& preset)
 {
+    std::lock_guard<std::mutex> lk(mtx_);
     presets_[name] = preset;
 }
 
 bool MaterialDataManager::HasPreset(const std::string& name) const
 {
+    std::lock_guard<std::mutex> lk(mtx_);
     return presets_.find(name) != presets_.end();
 }
 
 std::shared_ptr<MaterialData> MaterialDataManager::FindLoaded(const std::string& name) const
 {
+    std::lock_guard<std::mutex> lk(mtx_);
     auto it = cache_.find(name);
     if (it != cache_.end()) {
         return it->second;
@@ -27,18 +30,23 @@ std::shared_ptr<MaterialData> MaterialDataManager::GetOrCreate(Renderer* rendere
                                                                std::vector<ComPtr<ID3D12Resource>>* uploadKeepAlive,
                                                                const std::string& name)
 {
-    // уже есть в кэше?
-    if (auto it = cache_.find(name); it != cache_.end()) {
-        return it->second;
-    }
+    MaterialPreset p;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+
+        // уже есть в кэше?
+        if (auto it = cache_.find(name); it != cache_.end()) {
+            return it->second;
+        }
 
-    // есть пресет?
-    auto pit = presets_.find(name);
-    if (pit == presets_.end()) {
-        return {};
+        // есть пресет?
+        auto pit = presets_.find(name);
+        if (pit == presets_.end()) {
+            return {};
+        }
+        p = pit->second;
     }
 
-    const MaterialPreset& p = pit->second;
     auto md = std::make_shared<MaterialData>();
     md->normalIsRG = p.normalIsRG;
     md->useTBN     = p.useTBN;
@@ -47,17 +55,53 @@ std::shared_ptr<MaterialData> MaterialDataManager::GetOrCreate(Renderer* rendere
     if (!p.mrPath.empty())     { (void)md->LoadMR    (renderer, uploadCmdList, p.mrPath,     uploadKeepAlive); }
     if (!p.normalPath.empty()) { (void)md->LoadNormal(renderer, uploadCmdList, p.normalPath, uploadKeepAlive); }
 
-    cache_[name] = md;
-    return md;
+    return Publish_(name, md);
+}
+
+AsyncTask<std::shared_ptr<MaterialData>> MaterialDataManager::GetOrCreateAsync(Renderer* renderer, std::string name)
+{
+    MaterialPreset p;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (auto it = cache_.find(name); it != cache_.end()) {
+            co_return it->second;
+        }
+        auto pit = presets_.find(name);
+        if (pit == presets_.end()) {
+            co_return std::shared_ptr<MaterialData>();
+        }
+        p = pit->second;
+    }
+
+    auto md = std::make_shared<MaterialData>();
+    md->normalIsRG = p.normalIsRG;
+    md->useTBN     = p.useTBN;
+
+    std::vector<AsyncTask<bool>> loads;
+    if (!p.albedoPath.empty()) { loads.push_back(md->LoadAlbedoAsync(renderer, p.albedoPath)); }
+    if (!p.mrPath.empty())     { loads.push_back(md->LoadMRAsync    (renderer, p.mrPath)); }
+    if (!p.normalPath.empty()) { loads.push_back(md->LoadNormalAsync(renderer, p.normalPath)); }
+    co_await WhenAll(std::move(loads));
+
+    co_return Publish_(name, md);
+}
+
+std::shared_ptr<MaterialData> MaterialDataManager::Publish_(const std::string& name, const std::shared_ptr<MaterialData>& md)
+{
+    // параллельная загрузка того же пресета могла успеть раньше — отдаём её данные
+    std::lock_guard<std::mutex> lk(mtx_);
+    return cache_.try_emplace(name, md).first->second;
 }
 
 void MaterialDataManager::ClearCache()
 {
+    std::lock_guard<std::mutex> lk(mtx_);
     cache_.clear();
 }
 
 void MaterialDataManager::ClearAll()
 {
+    std::lock_guard<std::mutex> lk(mtx_);
     cache_.clear();
     presets_.clear();
-}
\ No newline at end of file
+}
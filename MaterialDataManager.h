@@ -2,6 +2,7 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <wrl/client.h>
 
@@ -34,6 +35,9 @@ public:
                                               std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive,
                                               const std::string& name);
 
+    // То же асинхронно: три текстуры грузятся параллельно, результат — после фенса аплоада
+    AsyncTask<std::shared_ptr<MaterialData>> GetOrCreateAsync(Renderer* renderer, std::string name);
+
     // Прямой доступ к уже загруженному (или nullptr)
     std::shared_ptr<MaterialData> FindLoaded(const std::string& name) const;
 
@@ -44,6 +48,9 @@ public:
     void ClearAll();
 
 private:
+    std::shared_ptr<MaterialData> Publish_(const std::string& name, const std::shared_ptr<MaterialData>& md);
+
+    mutable std::mutex mtx_; // пресеты/кэш читают корутины-загрузчики с воркеров
     std::unordered_map<std::string, MaterialPreset> presets_;
     std::unordered_map<std::string, std::shared_ptr<MaterialData>> cache_;
 };
\ No newline at end of file
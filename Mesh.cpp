@@ -58,17 +58,21 @@ void Mesh::CreateGPU_PNTUV(ID3D12Device* device,
         indices, indexCount, DXGI_FORMAT_R32_UINT);
 }
 
-void Mesh::Draw(ID3D12GraphicsCommandList* cmdList) const {
-    cmdList->IASetVertexBuffers(0, 1, &vertexBufferView_);
-    cmdList->IASetIndexBuffer(&indexBufferView_);
-    cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    cmdList->DrawIndexedInstanced(indexCount_, 1, 0, 0, 0);
+void Mesh::Draw(ID3D12GraphicsCommandList* cmdList, BindStateCache* cache) const {
+    DrawInstanced(cmdList, 1, cache);
 }
 
-void Mesh::DrawInstanced(ID3D12GraphicsCommandList* cmdList, UINT instanceCount) const {
-    cmdList->IASetVertexBuffers(0, 1, &vertexBufferView_);
-    cmdList->IASetIndexBuffer(&indexBufferView_);
-    cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void Mesh::DrawInstanced(ID3D12GraphicsCommandList* cmdList, UINT instanceCount, BindStateCache* cache) const {
+    if (cache != nullptr) {
+        cache->SetVertexBuffer(cmdList, vertexBufferView_);
+        cache->SetIndexBuffer(cmdList, indexBufferView_);
+        cache->SetPrimitiveTopology(cmdList, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    }
+    else {
+        cmdList->IASetVertexBuffers(0, 1, &vertexBufferView_);
+        cmdList->IASetIndexBuffer(&indexBufferView_);
+        cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    }
     cmdList->DrawIndexedInstanced(indexCount_, instanceCount, 0, 0, 0);
 }
 
@@ -6,6 +6,9 @@
 #include <vector>
 #include <cstdint>
 
+#include "BindStateCache.h"
+#include "Math.h"
+
 using namespace Microsoft::WRL;
 
 // СТАРЫЙ формат (совместимость)
@@ -45,8 +48,9 @@ public:
         bool generateTangentSpace = true);
 
     // Рендер
-    void Draw(ID3D12GraphicsCommandList* cmdList) const;
-    void DrawInstanced(ID3D12GraphicsCommandList* cmdList, UINT instanceCount) const;
+    // cache — пропустить IA, если буферы/топология в CL уже те же
+    void Draw(ID3D12GraphicsCommandList* cmdList, BindStateCache* cache = nullptr) const;
+    void DrawInstanced(ID3D12GraphicsCommandList* cmdList, UINT instanceCount, BindStateCache* cache = nullptr) const;
 
     UINT GetIndexCount() const { return indexCount_; }
 
@@ -56,6 +60,11 @@ public:
     UINT GetVertexStride() const { return vertexStride_; }
     DXGI_FORMAT GetIndexFormat() const { return indexFormat_; }
 
+    // Локальный AABB; считает MeshManager при загрузке. Нет — объект не отсекается
+    void SetLocalBounds(const Math::AABB& b) { localBounds_ = b; hasBounds_ = true; }
+    bool HasLocalBounds() const { return hasBounds_; }
+    const Math::AABB& GetLocalBounds() const { return localBounds_; }
+
 private:
     // Генерация нормалей/тангентов (простая: на треугольниках, с усреднением по вершинам)
     static void GenerateNormalsTangents(std::vector<VertexPNTUV>& verts,
@@ -69,4 +78,6 @@ private:
     UINT  vertexStride_ = sizeof(Vertex);      // по умолчанию старый формат
     DXGI_FORMAT indexFormat_ = DXGI_FORMAT_R16_UINT;
     UINT  indexCount_ = 0;
+    Math::AABB localBounds_ = Math::AABB::Empty();
+    bool  hasBounds_ = false;
 };
\ No newline at end of file
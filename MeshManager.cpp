@@ -13,6 +13,15 @@ using namespace DirectX;
 
 using Microsoft::WRL::ComPtr;
 
+// Локальный AABB по позициям — для отсечения по пирамиде (Scene)
+static Math::AABB computeBounds(const std::vector<VertexPNTUV>& verts) {
+    Math::AABB b = Math::AABB::Empty();
+    for (const VertexPNTUV& v : verts) {
+        b.Expand(Math::float3(v.position));
+    }
+    return b;
+}
+
 static inline void trim(std::string& s) {
     struct {
         static bool ns(int ch) { return !std::isspace(static_cast<unsigned char>(ch)); }
@@ -60,9 +69,8 @@ std::shared_ptr<Mesh> MeshManager::LoadText(const std::string& path,
     std::vector<ComPtr<ID3D12Resource>>* uploadKeepAlive,
     const MeshLoadOptions& opt)
 {
-    std::unordered_map<std::string, std::shared_ptr<Mesh>>::iterator it = cache_.find(path);
-    if (it != cache_.end()) {
-        return it->second;
+    if (std::shared_ptr<Mesh> cached = Get(path)) {
+        return cached;
     }
 
     std::vector<VertexPNTUV> verts;
@@ -74,8 +82,8 @@ std::shared_ptr<Mesh> MeshManager::LoadText(const std::string& path,
     std::shared_ptr<Mesh> m = std::make_shared<Mesh>();
     m->CreateGPU_PNTUV(renderer->GetDevice(), uploadCmdList, uploadKeepAlive,
         verts, inds.data(), (UINT)inds.size(), opt.generateTangentSpace);
-    cache_[path] = m;
-    return m;
+    m->SetLocalBounds(computeBounds(verts));
+    return Publish_(path, m);
 }
 
 std::shared_ptr<Mesh> MeshManager::LoadOBJ(const std::string& path,
@@ -84,9 +92,8 @@ std::shared_ptr<Mesh> MeshManager::LoadOBJ(const std::string& path,
     std::vector<ComPtr<ID3D12Resource>>* uploadKeepAlive,
     const MeshLoadOptions& opt)
 {
-    std::unordered_map<std::string, std::shared_ptr<Mesh>>::iterator it = cache_.find(path);
-    if (it != cache_.end()) {
-        return it->second;
+    if (std::shared_ptr<Mesh> cached = Get(path)) {
+        return cached;
     }
 
     std::vector<VertexPNTUV> verts;
@@ -98,8 +105,8 @@ std::shared_ptr<Mesh> MeshManager::LoadOBJ(const std::string& path,
     std::shared_ptr<Mesh> m = std::make_shared<Mesh>();
     m->CreateGPU_PNTUV(renderer->GetDevice(), uploadCmdList, uploadKeepAlive,
         verts, inds.data(), (UINT)inds.size(), opt.generateTangentSpace);
-    cache_[path] = m;
-    return m;
+    m->SetLocalBounds(computeBounds(verts));
+    return Publish_(path, m);
 }
 
 std::shared_ptr<Mesh> MeshManager::CreateFromMemory(const std::string& key,
@@ -110,20 +117,20 @@ std::shared_ptr<Mesh> MeshManager::CreateFromMemory(const std::string& key,
     std::vector<ComPtr<ID3D12Resource>>* uploadKeepAlive,
     bool generateTangentSpace)
 {
-    std::unordered_map<std::string, std::shared_ptr<Mesh>>::iterator it = cache_.find(key);
-    if (it != cache_.end()) {
-        return it->second;
+    if (std::shared_ptr<Mesh> cached = Get(key)) {
+        return cached;
     }
 
     std::shared_ptr<Mesh> m = std::make_shared<Mesh>();
     std::vector<VertexPNTUV> verts = vertsIn; // CreateGPU_PNTUV может модифицировать
     m->CreateGPU_PNTUV(renderer->GetDevice(), uploadCmdList, uploadKeepAlive,
         verts, indices.data(), (UINT)indices.size(), generateTangentSpace);
-    cache_[key] = m;
-    return m;
+    m->SetLocalBounds(computeBounds(verts));
+    return Publish_(key, m);
 }
 
 std::shared_ptr<Mesh> MeshManager::Get(const std::string& key) const {
+    std::lock_guard<std::mutex> lk(cacheMtx_);
     std::unordered_map<std::string, std::shared_ptr<Mesh>>::const_iterator it = cache_.find(key);
     if (it != cache_.end()) {
         return it->second;
@@ -134,9 +141,52 @@ std::shared_ptr<Mesh> MeshManager::Get(const std::string& key) const {
 }
 
 void MeshManager::Clear() {
+    std::lock_guard<std::mutex> lk(cacheMtx_);
     cache_.clear();
 }
 
+std::shared_ptr<Mesh> MeshManager::Publish_(const std::string& key, const std::shared_ptr<Mesh>& m)
+{
+    // Параллельная загрузка того же пути могла успеть раньше — отдаём её меш
+    std::lock_guard<std::mutex> lk(cacheMtx_);
+    return cache_.try_emplace(key, m).first->second;
+}
+
+AsyncTask<std::shared_ptr<Mesh>> MeshManager::LoadAsync(std::string path,
+    Renderer* renderer,
+    MeshLoadOptions opt,
+    CancellationToken cancel,
+    TaskSystem::Clock::time_point deadline)
+{
+    if (std::shared_ptr<Mesh> cached = Get(path)) {
+        co_return cached;
+    }
+
+    // Парсинг и генерация TBN — на фоновом воркере
+    co_await ScheduleOn(TaskPriority::Background, deadline);
+    if (cancel.IsCancelled()) {
+        co_return std::shared_ptr<Mesh>();
+    }
+
+    std::vector<VertexPNTUV> verts;
+    std::vector<uint32_t>    inds;
+    std::string low = tolower_str(path);
+    const bool isObj = low.size() >= 4 && low.substr(low.size() - 4) == ".obj";
+    const bool ok = isObj ? ParseOBJFile(path, verts, inds, opt) : ParseTextFile(path, verts, inds, opt);
+    if (!ok || cancel.IsCancelled()) {
+        co_return std::shared_ptr<Mesh>();
+    }
+
+    Renderer::UploadBatch upload = renderer->BeginUpload();
+    std::shared_ptr<Mesh> m = std::make_shared<Mesh>();
+    m->CreateGPU_PNTUV(renderer->GetDevice(), upload.cl.Get(), &upload.keepAlive,
+        verts, inds.data(), (UINT)inds.size(), opt.generateTangentSpace);
+    m->SetLocalBounds(computeBounds(verts));
+    co_await renderer->SubmitUpload(upload);
+
+    co_return Publish_(path, m);
+}
+
 // ---------- Parsers ----------
 
 static void addTri(std::vector<uint32_t>& I, uint32_t a, uint32_t b, uint32_t c, bool wantCW)
@@ -1,10 +1,12 @@
 #pragma once
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <wrl.h>
 #include "Mesh.h"
+#include "AsyncTask.h"
 
 class Renderer;
 
@@ -45,6 +47,16 @@ public:
                                            std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive,
                                            bool generateTangentSpace = true);
 
+    // Асинхронно: парсинг на фоновом воркере, аплоад своим CL, возврат после фенса.
+    // Параметры по значению — корутина переживает вызывающего.
+    // Стриминг: deadline — место в фоновой очереди, отменённая загрузка возвращает nullptr
+    // (проверка до парсинга и до аплоада).
+    AsyncTask<std::shared_ptr<Mesh>> LoadAsync(std::string path,
+                                               Renderer* renderer,
+                                               MeshLoadOptions opt = {},
+                                               CancellationToken cancel = {},
+                                               TaskSystem::Clock::time_point deadline = TaskSystem::kNoDeadline);
+
     std::shared_ptr<Mesh> Get(const std::string& key) const;
     void Clear();
 
@@ -60,6 +72,9 @@ private:
                       std::vector<uint32_t>& outIndices,
                       const MeshLoadOptions& opt);
 
+    std::shared_ptr<Mesh> Publish_(const std::string& key, const std::shared_ptr<Mesh>& m);
+
 private:
+    mutable std::mutex cacheMtx_; // кэш трогают и корутины-загрузчики с воркеров
     std::unordered_map<std::string, std::shared_ptr<Mesh>> cache_;
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Пул узлов фиксированного типа с потоковыми кэшами: в установившемся режиме Acquire/Release
+// не трогают кучу и не берут локов. Узел освобождается в кэш того потока, который его отпустил;
+// излишки пачками уходят в общий список (так поток-производитель подбирает узлы,
+// отпущенные воркерами). Блоки живут до разрушения пула.
+// T — default-constructible, с полем `T* next` (свободно, пока узел в пуле).
+// Кэш потока один на тип T, поэтому на тип — один экземпляр пула.
+template<typename T, std::size_t BlockSize = 64, std::size_t Batch = 32>
+class NodePool {
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    T* Acquire() {
+        Cache_& c = LocalCache_();
+        if (!c.head) {
+            Refill_(c);
+        }
+        T* n = c.head;
+        c.head = n->next;
+        --c.count;
+        n->next = nullptr;
+        return n;
+    }
+
+    void Release(T* n) {
+        Cache_& c = LocalCache_();
+        n->next = c.head;
+        c.head = n;
+        if (++c.count >= 2 * Batch) {
+            Spill_(c);
+        }
+    }
+
+    // Сколько блоков выделено за всё время (должно перестать расти после прогрева)
+    uint64_t BlocksAllocated() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return blocks_.size();
+    }
+
+private:
+    struct Cache_ {
+        T*          head = nullptr;
+        std::size_t count = 0;
+    };
+
+    static Cache_& LocalCache_() {
+        static thread_local Cache_ cache;
+        return cache;
+    }
+
+    void Refill_(Cache_& c) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!shared_) {
+            auto block = std::make_unique<T[]>(BlockSize);
+            for (std::size_t i = 0; i < BlockSize; ++i) {
+                block[i].next = shared_;
+                shared_ = &block[i];
+            }
+            sharedCount_ += BlockSize;
+            blocks_.push_back(std::move(block));
+        }
+        for (std::size_t i = 0; i < Batch && shared_; ++i) {
+            T* n = shared_;
+            shared_ = n->next;
+            --sharedCount_;
+            n->next = c.head;
+            c.head = n;
+            ++c.count;
+        }
+    }
+
+    void Spill_(Cache_& c) {
+        // Отрезаем Batch узлов с головы кэша и одним локом отдаём в общий список
+        T* first = c.head;
+        T* last = first;
+        for (std::size_t i = 1; i < Batch; ++i) {
+            last = last->next;
+        }
+        c.head = last->next;
+        c.count -= Batch;
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        last->next = shared_;
+        shared_ = first;
+        sharedCount_ += Batch;
+    }
+
+private:
+    mutable std::mutex                mtx_;
+    T*                                shared_ = nullptr;
+    std::size_t                       sharedCount_ = 0;
+    std::vector<std::unique_ptr<T[]>> blocks_;
+};
@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "TaskSystem.h"
+
+// Data-parallel примитивы поверх TaskSystem: свёртка, префиксная сумма, разбиение, radix sort.
+// Все блокирующие (вызывающий поток работает вместе с пулом), порядок результата
+// детерминирован и не зависит от числа воркеров. Ниже порога — обычный последовательный путь.
+// Операции свёртки/скана должны быть ассоциативны (коммутативность не нужна).
+
+namespace ParallelDetail {
+
+    // Ниже этого размера накладные на задачи дороже самой работы
+    constexpr std::size_t kSerialThreshold = 16 * 1024;
+    // Минимальный блок: чтобы на блок приходилось хотя бы несколько микросекунд
+    constexpr std::size_t kMinBlock = 8 * 1024;
+
+    // Число блоков: не мельче kMinBlock и не больше ~4 на поток (хватает на балансировку)
+    inline std::size_t BlockCount(std::size_t n, std::size_t serialThreshold) {
+        if (n < serialThreshold || n < 2 * kMinBlock) {
+            return 1;
+        }
+        const std::size_t threads = TaskSystem::Get().WorkerCount() + 1;
+        return std::clamp<std::size_t>(n / kMinBlock, 1, threads * 4);
+    }
+
+    inline std::size_t BlockBegin(std::size_t n, std::size_t blocks, std::size_t b) {
+        return n * b / blocks;
+    }
+
+    // Один блок — прямо на вызывающем потоке, без задач
+    template<typename Fn>
+    void ForEachBlock(std::size_t blocks, Fn&& fn) {
+        if (blocks == 1) {
+            fn(std::size_t(0));
+            return;
+        }
+        TaskSystem::Get().ParallelFor(0, blocks, [&fn](std::size_t b) { fn(b); }, 1);
+    }
+
+    template<typename K>
+    constexpr bool IsRadixKey = std::is_same_v<K, uint32_t> || std::is_same_v<K, uint64_t>;
+
+    // Пустой payload для сортировки одних ключей
+    struct NoPayload {};
+
+} // namespace ParallelDetail
+
+// ---------------------------------------------------------------------------------------------
+// Свёртка: op(...op(op(init, map(0)), map(1))..., map(count-1)), блоки сворачиваются по порядку.
+// identity — нейтральный элемент op (с него начинается каждый блок).
+template<typename T, typename Op, typename Map>
+T ParallelTransformReduce(std::size_t count, T init, T identity, Op op, Map map,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    const std::size_t blocks = ParallelDetail::BlockCount(count, serialThreshold);
+    if (blocks == 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            init = op(std::move(init), map(i));
+        }
+        return init;
+    }
+
+    std::vector<T> partial(blocks, identity);
+    ParallelDetail::ForEachBlock(blocks, [&](std::size_t b) {
+        const std::size_t lo = ParallelDetail::BlockBegin(count, blocks, b);
+        const std::size_t hi = ParallelDetail::BlockBegin(count, blocks, b + 1);
+        T acc = identity;
+        for (std::size_t i = lo; i < hi; ++i) {
+            acc = op(std::move(acc), map(i));
+        }
+        partial[b] = std::move(acc);
+    });
+
+    for (T& p : partial) {
+        init = op(std::move(init), std::move(p));
+    }
+    return init;
+}
+
+template<typename T, typename Op>
+T ParallelReduce(std::span<const T> data, T init, T identity, Op op,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    const T* p = data.data();
+    return ParallelTransformReduce(data.size(), std::move(init), std::move(identity), op,
+        [p](std::size_t i) -> const T& { return p[i]; }, serialThreshold);
+}
+
+// Сумма (identity = T{})
+template<typename T>
+T ParallelReduce(std::span<const T> data, T init = T{})
+{
+    return ParallelReduce(data, std::move(init), T{}, [](const T& a, const T& b) { return a + b; });
+}
+
+// ---------------------------------------------------------------------------------------------
+// Исключающий префикс: out[i] = op(init, in[0], ..., in[i-1]). in и out могут совпадать.
+// Три фазы: суммы блоков -> последовательный скан сумм -> скан внутри блоков со смещением.
+template<typename T, typename Op>
+void ParallelExclusiveScan(std::span<const T> in, std::span<T> out, T init, Op op,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    const std::size_t n = std::min(in.size(), out.size());
+    const std::size_t blocks = ParallelDetail::BlockCount(n, serialThreshold);
+
+    auto scanBlock = [&in, &out, &op](std::size_t lo, std::size_t hi, T acc) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            T v = in[i]; // копия до записи: in и out могут совпадать
+            out[i] = acc;
+            acc = op(std::move(acc), std::move(v));
+        }
+    };
+
+    if (blocks == 1) {
+        scanBlock(0, n, std::move(init));
+        return;
+    }
+
+    // 1) Суммы блоков (кроме последнего — его сумма никому не нужна)
+    std::vector<T> offsets(blocks);
+    ParallelDetail::ForEachBlock(blocks - 1, [&](std::size_t b) {
+        const std::size_t lo = ParallelDetail::BlockBegin(n, blocks, b);
+        const std::size_t hi = ParallelDetail::BlockBegin(n, blocks, b + 1);
+        T acc = in[lo];
+        for (std::size_t i = lo + 1; i < hi; ++i) {
+            acc = op(std::move(acc), in[i]);
+        }
+        offsets[b + 1] = std::move(acc);
+    });
+
+    // 2) Смещения блоков
+    offsets[0] = std::move(init);
+    for (std::size_t b = 1; b < blocks; ++b) {
+        offsets[b] = op(offsets[b - 1], offsets[b]);
+    }
+
+    // 3) Скан внутри блоков
+    ParallelDetail::ForEachBlock(blocks, [&](std::size_t b) {
+        scanBlock(ParallelDetail::BlockBegin(n, blocks, b), ParallelDetail::BlockBegin(n, blocks, b + 1), offsets[b]);
+    });
+}
+
+template<typename T>
+void ParallelExclusiveScan(std::span<const T> in, std::span<T> out, T init = T{})
+{
+    ParallelExclusiveScan(in, out, std::move(init), [](const T& a, const T& b) { return a + b; });
+}
+
+// ---------------------------------------------------------------------------------------------
+// Стабильное разбиение: элементы с pred == true — в начало (в исходном порядке), остальные — за ними.
+// Возвращает число "true". Нужен временный буфер размера data (T — перемещаемый).
+// Типичное применение — компакция видимых после куллинга.
+template<typename T, typename Pred>
+std::size_t ParallelPartition(std::span<T> data, Pred pred,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    const std::size_t n = data.size();
+    const std::size_t blocks = ParallelDetail::BlockCount(n, serialThreshold);
+    if (blocks == 1) {
+        return static_cast<std::size_t>(std::stable_partition(data.begin(), data.end(), pred) - data.begin());
+    }
+
+    // 1) Сколько "true" в каждом блоке (предикат зовём один раз на элемент)
+    std::vector<uint8_t> flags(n);
+    std::vector<std::size_t> trueBefore(blocks + 1, 0);
+    ParallelDetail::ForEachBlock(blocks, [&](std::size_t b) {
+        const std::size_t lo = ParallelDetail::BlockBegin(n, blocks, b);
+        const std::size_t hi = ParallelDetail::BlockBegin(n, blocks, b + 1);
+        std::size_t c = 0;
+        for (std::size_t i = lo; i < hi; ++i) {
+            const bool f = pred(static_cast<const T&>(data[i]));
+            flags[i] = f ? 1 : 0;
+            c += f ? 1 : 0;
+        }
+        trueBefore[b + 1] = c;
+    });
+    for (std::size_t b = 0; b < blocks; ++b) {
+        trueBefore[b + 1] += trueBefore[b];
+    }
+    const std::size_t totalTrue = trueBefore[blocks];
+
+    // 2) Раскладка в буфер: "true" блока b начинаются с trueBefore[b],
+    //    "false" — с totalTrue + (сколько false во всех предыдущих блоках)
+    std::vector<T> tmp(n);
+    ParallelDetail::ForEachBlock(blocks, [&](std::size_t b) {
+        const std::size_t lo = ParallelDetail::BlockBegin(n, blocks, b);
+        const std::size_t hi = ParallelDetail::BlockBegin(n, blocks, b + 1);
+        std::size_t t = trueBefore[b];
+        std::size_t f = totalTrue + (lo - trueBefore[b]);
+        for (std::size_t i = lo; i < hi; ++i) {
+            tmp[flags[i] ? t++ : f++] = std::move(data[i]);
+        }
+    });
+
+    // 3) Обратно
+    ParallelDetail::ForEachBlock(blocks, [&](std::size_t b) {
+        const std::size_t lo = ParallelDetail::BlockBegin(n, blocks, b);
+        const std::size_t hi = ParallelDetail::BlockBegin(n, blocks, b + 1);
+        std::move(tmp.begin() + lo, tmp.begin() + hi, data.begin() + lo);
+    });
+    return totalTrue;
+}
+
+// ---------------------------------------------------------------------------------------------
+// LSD radix sort по 8 бит (стабильный) для uint32_t/uint64_t ключей с необязательным payload.
+// Проход: гистограммы цифры по блокам -> смещения (цифра-major, блок-minor: стабильность) ->
+// раскладка. Проходы, где у всех ключей одна и та же цифра, пропускаются (типично для
+// старших байт draw-key). Буферы ping-pong выделяются на вызов.
+namespace ParallelDetail {
+
+    template<typename K, typename V>
+    void RadixSort(K* keys, V* values, std::size_t n, std::size_t serialThreshold) {
+        static_assert(IsRadixKey<K>, "ParallelRadixSort: ключи uint32_t или uint64_t");
+        constexpr bool kHasPayload = !std::is_same_v<V, NoPayload>;
+        constexpr unsigned kBits = 8;
+        constexpr std::size_t kBuckets = std::size_t(1) << kBits;
+        constexpr unsigned kPasses = sizeof(K) * 8 / kBits;
+
+        if (n < 2) {
+            return;
+        }
+
+        const std::size_t blocks = BlockCount(n, serialThreshold);
+        std::vector<K> keyTmp(n);
+        std::vector<V> valTmp(kHasPayload ? n : 0);
+        // hist[b * kBuckets + d] — сколько ключей с цифрой d в блоке b; потом — куда писать
+        std::vector<std::size_t> hist(blocks * kBuckets);
+
+        K* srcK = keys;
+        K* dstK = keyTmp.data();
+        V* srcV = values;
+        V* dstV = valTmp.data();
+
+        for (unsigned pass = 0; pass < kPasses; ++pass) {
+            const unsigned shift = pass * kBits;
+
+            ForEachBlock(blocks, [&](std::size_t b) {
+                std::size_t* h = &hist[b * kBuckets];
+                std::fill(h, h + kBuckets, std::size_t(0));
+                const std::size_t hi = BlockBegin(n, blocks, b + 1);
+                for (std::size_t i = BlockBegin(n, blocks, b); i < hi; ++i) {
+                    ++h[(srcK[i] >> shift) & (kBuckets - 1)];
+                }
+            });
+
+            // Все ключи с одной цифрой — проход ничего не меняет
+            const std::size_t firstDigit = (srcK[0] >> shift) & (kBuckets - 1);
+            std::size_t sameDigit = 0;
+            for (std::size_t b = 0; b < blocks; ++b) {
+                sameDigit += hist[b * kBuckets + firstDigit];
+            }
+            if (sameDigit == n) {
+                continue;
+            }
+
+            std::size_t sum = 0;
+            for (std::size_t d = 0; d < kBuckets; ++d) {
+                for (std::size_t b = 0; b < blocks; ++b) {
+                    const std::size_t c = hist[b * kBuckets + d];
+                    hist[b * kBuckets + d] = sum;
+                    sum += c;
+                }
+            }
+
+            ForEachBlock(blocks, [&](std::size_t b) {
+                std::size_t* h = &hist[b * kBuckets];
+                const std::size_t hi = BlockBegin(n, blocks, b + 1);
+                for (std::size_t i = BlockBegin(n, blocks, b); i < hi; ++i) {
+                    const std::size_t dst = h[(srcK[i] >> shift) & (kBuckets - 1)]++;
+                    dstK[dst] = srcK[i];
+                    if constexpr (kHasPayload) {
+                        dstV[dst] = srcV[i];
+                    }
+                }
+            });
+
+            std::swap(srcK, dstK);
+            if constexpr (kHasPayload) {
+                std::swap(srcV, dstV);
+            }
+        }
+
+        // Нечётное число выполненных проходов — результат во временном буфере
+        if (srcK != keys) {
+            ForEachBlock(blocks, [&](std::size_t b) {
+                const std::size_t lo = BlockBegin(n, blocks, b);
+                const std::size_t hi = BlockBegin(n, blocks, b + 1);
+                std::memcpy(keys + lo, srcK + lo, (hi - lo) * sizeof(K));
+                if constexpr (kHasPayload) {
+                    std::copy(srcV + lo, srcV + hi, values + lo);
+                }
+            });
+        }
+    }
+
+} // namespace ParallelDetail
+
+// Сортировка ключей с payload (values[i] едет вместе с keys[i]); V — копируемый, лучше тривиальный
+template<typename K, typename V>
+void ParallelRadixSort(std::span<K> keys, std::span<V> values,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    ParallelDetail::RadixSort(keys.data(), values.data(), std::min(keys.size(), values.size()), serialThreshold);
+}
+
+template<typename K>
+void ParallelRadixSort(std::span<K> keys,
+    std::size_t serialThreshold = ParallelDetail::kSerialThreshold)
+{
+    ParallelDetail::RadixSort<K, ParallelDetail::NoPayload>(keys.data(), nullptr, keys.size(), serialThreshold);
+}
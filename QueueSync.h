@@ -0,0 +1,130 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Расстановка межочередных фенсов по бакетам сабмита. Чистый CPU, без D3D: на вход —
+// очередь каждого бакета (в порядке сабмита) и бакеты, которых он ждёт; на выход —
+// сегменты (подряд идущие бакеты одной очереди = один ExecuteCommandLists), перед
+// сегментом — Wait'ы, после — Signal. Ждём только то, что ещё не известно очереди:
+// и напрямую, и транзитивно (очередь A ждала B, B до этого ждала C — C для A уже готова).
+// В конце все очереди сходятся в joinQueue — её фенс кадра покрывает всю работу кадра.
+
+struct QueueSyncBatch {
+    uint8_t queue = 0;
+    std::span<const uint32_t> waitsOn; // индексы более ранних бакетов
+};
+
+struct QueueSyncWait {
+    uint8_t  queue = 0;   // чей фенс ждём
+    uint64_t value = 0;
+};
+
+struct QueueSyncSegment {
+    uint8_t  queue = 0;
+    uint32_t firstBatch = 0, endBatch = 0; // [first, end); у хвоста join'а может быть пустым
+    uint32_t waitBegin = 0, waitCount = 0; // в QueueSyncPlan::waits
+    uint64_t value = 0;                    // значение фенса очереди после сегмента
+    bool     signal = false;               // кто-то его ждёт — Signal обязателен
+};
+
+class QueueSyncPlan {
+public:
+    static constexpr size_t kMaxQueues = 3; // direct, compute, copy
+
+    std::vector<QueueSyncSegment> segments;
+    std::vector<QueueSyncWait>    waits;
+
+    // nextValue — следующий свободный номер фенса на очередь, сдвигается на использованные.
+    // Номера выдаются каждому сегменту по порядку сабмита (монотонно), Signal — только нужным.
+    void Build(std::span<const QueueSyncBatch> batches, std::span<uint64_t> nextValue, uint8_t joinQueue = 0) {
+        segments.clear();
+        waits.clear();
+        segKnown_.clear();
+        batchSeg_.assign(batches.size(), 0);
+        for (Known_& k : known_) {
+            k.fill(0);
+        }
+
+        for (uint32_t i = 0; i < batches.size(); ++i) {
+            const QueueSyncBatch& b = batches[i];
+            const uint8_t q = b.queue;
+
+            // Нужные Wait'ы: сегменты других очередей, ещё не известные q
+            pending_.clear();
+            for (uint32_t p : b.waitsOn) {
+                const uint32_t s = batchSeg_[p];
+                const QueueSyncSegment& src = segments[s];
+                if (src.queue != q && known_[q][src.queue] < src.value) {
+                    pending_.push_back(s);
+                }
+            }
+
+            if (segments.empty() || segments.back().queue != q || !pending_.empty()) {
+                OpenSegment_(q, i, nextValue);
+                WaitFor_(q, pending_);
+            }
+            segments.back().endBatch = i + 1;
+            batchSeg_[i] = static_cast<uint32_t>(segments.size() - 1);
+        }
+
+        // Схождение: хвост на joinQueue ждёт последние сегменты остальных очередей
+        pending_.clear();
+        for (size_t s = segments.size(); s-- > 0;) {
+            const QueueSyncSegment& seg = segments[s];
+            if (seg.queue != joinQueue && known_[joinQueue][seg.queue] < seg.value &&
+                std::none_of(pending_.begin(), pending_.end(), [&](uint32_t o) { return segments[o].queue == seg.queue; })) {
+                pending_.push_back(static_cast<uint32_t>(s));
+            }
+        }
+        if (segments.empty() || segments.back().queue != joinQueue || !pending_.empty()) {
+            const uint32_t end = static_cast<uint32_t>(batches.size());
+            OpenSegment_(joinQueue, end, nextValue);
+            segments.back().endBatch = end;
+            WaitFor_(joinQueue, pending_);
+        }
+    }
+
+private:
+    using Known_ = std::array<uint64_t, kMaxQueues>;
+
+    void OpenSegment_(uint8_t q, uint32_t first, std::span<uint64_t> nextValue) {
+        QueueSyncSegment seg;
+        seg.queue = q;
+        seg.firstBatch = first;
+        seg.endBatch = first;
+        seg.waitBegin = static_cast<uint32_t>(waits.size());
+        seg.value = nextValue[q]++;
+        segments.push_back(seg);
+        // после сегмента очередь знает о себе всё до его значения
+        known_[q][q] = seg.value;
+        segKnown_.push_back(known_[q]);
+    }
+
+    // Wait'ы нового сегмента: от самых поздних — то, что они уже покрывают, не ждём повторно
+    void WaitFor_(uint8_t q, std::vector<uint32_t>& sources) {
+        std::sort(sources.begin(), sources.end(), [](uint32_t a, uint32_t b) { return a > b; });
+        QueueSyncSegment& seg = segments.back();
+        for (uint32_t s : sources) {
+            QueueSyncSegment& src = segments[s];
+            if (known_[q][src.queue] >= src.value) {
+                continue;
+            }
+            src.signal = true;
+            waits.push_back({ src.queue, src.value });
+            for (size_t k = 0; k < kMaxQueues; ++k) {
+                known_[q][k] = std::max(known_[q][k], segKnown_[s][k]);
+            }
+        }
+        known_[q][q] = seg.value;
+        seg.waitCount = static_cast<uint32_t>(waits.size()) - seg.waitBegin;
+        segKnown_.back() = known_[q];
+    }
+
+    std::array<Known_, kMaxQueues> known_{}; // known_[q][p]: до какого значения p готова для q
+    std::vector<Known_>   segKnown_;         // то же на конец каждого сегмента
+    std::vector<uint32_t> batchSeg_;
+    std::vector<uint32_t> pending_;
+};
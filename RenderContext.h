@@ -1,15 +1,62 @@
 #pragma once
+#include <windows.h>
 #include <d3d12.h>
-#include <unordered_map>
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <span>
 
-// CBV, SRV, UAV по ключу (например, "viewProj", "instanceBuffer" и т.д.)
+// Аргументы root-параметров по регистру (b0/t0/u0/первый регистр таблицы).
+// Плоские массивы фиксированной ёмкости + маска выставленных: без хешей и аллокаций,
+// Material::Bind идёт по заранее посчитанному списку (root-параметр -> регистр) и читает по индексу.
 struct RenderContext {
-    std::unordered_map<uint32_t, D3D12_GPU_VIRTUAL_ADDRESS> cbv;
-    std::unordered_map<uint32_t, std::vector<uint32_t>> constants;
-    std::unordered_map<uint32_t, D3D12_GPU_VIRTUAL_ADDRESS> srv;
-    std::unordered_map<uint32_t, D3D12_GPU_VIRTUAL_ADDRESS> uav;
-    std::unordered_map<uint32_t, D3D12_GPU_DESCRIPTOR_HANDLE> table;
-    std::unordered_map<uint32_t, D3D12_GPU_DESCRIPTOR_HANDLE> samplerTable;
-};
\ No newline at end of file
+    static constexpr uint32_t kMaxRegisters = 8;      // на каждый вид; регистры дальше Material отбросит при сборке
+    static constexpr uint32_t kMaxRootConstants = 16; // DWORD'ов в одном root-параметре констант
+
+    struct RootConstants {
+        uint32_t count = 0;
+        uint32_t data[kMaxRootConstants];
+
+        // Больше kMaxRootConstants — запись отбрасывается целиком (обрезанные константы хуже пропущенных)
+        RootConstants& operator=(std::span<const uint32_t> v) {
+            if (v.size() > kMaxRootConstants) {
+                OutputDebugStringA("[RenderContext] root constants exceed kMaxRootConstants, ignored\n");
+                return *this;
+            }
+            count = static_cast<uint32_t>(v.size());
+            std::memcpy(data, v.data(), count * sizeof(uint32_t));
+            return *this;
+        }
+        RootConstants& operator=(std::initializer_list<uint32_t> v) {
+            return *this = std::span<const uint32_t>(v.begin(), v.size());
+        }
+    };
+
+    // Запись через [] помечает слот выставленным; Clear — снять все.
+    // Регистр за kMaxRegisters Material всё равно не биндит — запись уходит в discard_
+    template<typename T>
+    struct Slots {
+        uint32_t mask = 0;
+        T values[kMaxRegisters]{};
+        T discard_{};
+
+        T& operator[](uint32_t reg) {
+            if (reg >= kMaxRegisters) {
+                OutputDebugStringA("[RenderContext] register exceeds kMaxRegisters, write ignored\n");
+                return discard_;
+            }
+            mask |= 1u << reg;
+            return values[reg];
+        }
+        bool Has(uint32_t reg) const { return reg < kMaxRegisters && ((mask >> reg) & 1u); }
+        const T& Get(uint32_t reg) const { return values[reg]; }
+        void Clear() { mask = 0; }
+    };
+
+    Slots<D3D12_GPU_VIRTUAL_ADDRESS>   cbv;
+    Slots<RootConstants>               constants;
+    Slots<D3D12_GPU_VIRTUAL_ADDRESS>   srv;
+    Slots<D3D12_GPU_VIRTUAL_ADDRESS>   uav;
+    Slots<D3D12_GPU_DESCRIPTOR_HANDLE> table;
+    Slots<D3D12_GPU_DESCRIPTOR_HANDLE> samplerTable;
+};
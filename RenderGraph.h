@@ -1,22 +1,94 @@
 #pragma once
-#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <queue>
 #include <cassert>
-#include <unordered_set>
+#include <span>
 #include "Renderer.h"
+#include "TaskSystem.h"
+#include "InlineFunction.h"
+#include "TransientAliasing.h"
 
 
+// Граф живёт между кадрами. Каждый кадр: BeginFrame(), затем те же ImportResource/AddPass
+// в том же порядке, затем Execute. Совпала декларация пасса (имя, явные prereqs, доступы) —
+// перепривязывается только колбэк, а топология, порядок и времена жизни берутся из кэша;
+// план барьеров переиспользуется, пока совпадают входные состояния и раскладка транзиентов.
+// Расхождение — перекомпиляция в Execute. В установившемся режиме граф кучу не трогает.
+// При компиляции пассы, чьи записи никто из живых не читает, отсекаются: выключенная фича
+// (не объявлено чтение её результата) не стоит ни CPU, ни GPU.
+// Переходы, между которыми есть чужие графические пассы, делятся на BEGIN_ONLY (сразу после
+// прошлого пользователя) и END_ONLY (перед следующим) — GPU перекрывает их с работой между ними.
+// Дешёвые соседние пассы (AllowMerge) склеиваются в один CL и бакет; бакет закрывается, как
+// только его пасс дописан, — Renderer сразу сабмитит готовый префикс кадра.
 class RenderGraph {
 public:
     struct PassContext {
         Renderer* renderer = nullptr;
         size_t    batchIndex = (size_t)-1;
-        std::string passName;
+        std::string_view passName; // живёт, пока жив граф
+        Renderer::ThreadCL* mergedCL = nullptr; // пасс склеен с соседями: CL общий на цепочку
+
+        // DIRECT-CL пасса: свой или общий для склейки (его откроет первый, закроет граф)
+        Renderer::ThreadCL BeginCommandList() const {
+            if (mergedCL == nullptr) {
+                return renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
+            }
+            if (mergedCL->cl == nullptr) {
+                *mergedCL = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
+            }
+            return *mergedCL;
+        }
+        void EndCommandList(Renderer::ThreadCL& t) const {
+            if (mergedCL == nullptr) {
+                renderer->EndThreadCommandList(t, batchIndex);
+            }
+            t = {};
+        }
+    };
+
+    // Колбэк с inline-буфером: перепривязка каждый кадр без аллокаций
+    using ExecFn = InlineFunction<void(PassContext), 128>;
+
+    // Ресурс графа: индекс в таблице импортированных ресурсов
+    using ResourceId = uint32_t;
+
+    // Как пасс использует ресурс. Состояние и барьеры выводит граф — пассы Transition не зовут
+    enum class Access : uint8_t {
+        SRV,      // чтение в шейдере (pixel + non-pixel)
+        RTV,      // запись как render target
+        DSVWrite, // depth test + запись
+        DSVRead,  // depth test без записи (можно вместе с SRV)
+        UAV,      // чтение/запись из шейдера
+        CopySrc,
+        CopyDst,
+    };
+
+    struct ResourceAccess {
+        ResourceId res = 0;
+        Access     access = Access::SRV;
+
+        bool operator==(const ResourceAccess&) const = default;
     };
 
-    using ExecFn = std::function<void(PassContext)>;
+    static ResourceAccess SRV(ResourceId r)      { return { r, Access::SRV }; }
+    static ResourceAccess RTV(ResourceId r)      { return { r, Access::RTV }; }
+    static ResourceAccess DSVWrite(ResourceId r) { return { r, Access::DSVWrite }; }
+    static ResourceAccess DSVRead(ResourceId r)  { return { r, Access::DSVRead }; }
+    static ResourceAccess UAV(ResourceId r)      { return { r, Access::UAV }; }
+    static ResourceAccess CopySrc(ResourceId r)  { return { r, Access::CopySrc }; }
+    static ResourceAccess CopyDst(ResourceId r)  { return { r, Access::CopyDst }; }
+
+    // Очередь пасса. Compute-пасс пишется в COMPUTE-CL и уходит на асинхронную очередь;
+    // фенсы между очередями Renderer ставит по рёбрам графа (QueueSync.h)
+    enum class Queue : uint8_t {
+        Graphics,
+        Compute,
+    };
 
     RenderGraph(size_t submitBatchIndex = (size_t)-1)
 		: submitBatchIndex_(submitBatchIndex) {
@@ -25,89 +97,841 @@ public:
     struct Pass {
         std::string name;
         std::vector<size_t> prereqs; // индексы пассов, которые должны быть ДО этого
+        std::vector<ResourceAccess> accesses;
         ExecFn exec;
+        Queue queue = Queue::Graphics;
+        bool mergeable = false;      // AllowMerge в этом кадре
+        std::vector<size_t> deps;    // prereqs + рёбра по ресурсам (считает компиляция)
     };
 
+    // Начать декларацию кадра. Вложенный граф получает бакет родителя здесь же.
+    void BeginFrame(size_t submitBatchIndex = (size_t)-1) {
+        submitBatchIndex_ = submitBatchIndex;
+        passCursor_ = 0;
+        resourceCursor_ = 0;
+    }
+
+    // Импортировать ресурс (внешний, живёт дольше графа). Начальное состояние граф берёт
+    // у Renderer, финальное — возвращает ему же. Указатель можно менять каждый кадр
+    // (цели кадра в полёте) — это не перекомпиляция.
+    ResourceId ImportResource(std::string_view name, ID3D12Resource* res) {
+        const ResourceId id = resourceCursor_++;
+        if (id < resources_.size() && resources_[id].name == name) {
+            resources_[id].res = res;
+            return id;
+        }
+        resources_.resize(id);
+        resources_.push_back(Resource_{ std::string(name), res });
+        dirty_ = true;
+        return id;
+    }
+
     // Добавить пасс, вернуть его индекс — используйте для зависимостей следующих пассов.
-    size_t AddPass(const std::string& name,
-        const std::vector<size_t>& prereqs,
+    size_t AddPass(std::string_view name,
+        std::initializer_list<size_t> prereqs,
         ExecFn fn) {
-        passes_.push_back(Pass{ name, prereqs, std::move(fn) });
-        return passes_.size() - 1;
+        return AddPass_(name, prereqs, {}, std::move(fn), Queue::Graphics);
     }
 
-    // Выполнить: топологическая сортировка (Kahn), без внутренних вейтов.
-    void Execute(Renderer* renderer) {
+    // Пасс с объявленными доступами. К явным prereqs добавляются рёбра по ресурсам
+    // (чтение после записи, запись после чтения/записи — относительно ранее добавленных пассов),
+    // так что параллельная запись CL не нарушит порядок, в котором граф считал барьеры.
+    // Доступы — только у графа верхнего уровня (вложенный делит бакет родителя).
+    size_t AddPass(std::string_view name,
+        std::initializer_list<size_t> prereqs,
+        std::initializer_list<ResourceAccess> accesses,
+        ExecFn fn) {
+        return AddPass_(name, prereqs, std::span<const ResourceAccess>(accesses.begin(), accesses.size()), std::move(fn), Queue::Graphics);
+    }
+
+    // То же со списком доступов, собранным в рантайме (число объектов меняется)
+    size_t AddPass(std::string_view name,
+        std::initializer_list<size_t> prereqs,
+        std::span<const ResourceAccess> accesses,
+        ExecFn fn) {
+        return AddPass_(name, prereqs, accesses, std::move(fn), Queue::Graphics);
+    }
+
+    // Compute-пасс на асинхронной очереди: exec пишет CL типа COMPUTE в ctx.batchIndex.
+    // SRV здесь — только NON_PIXEL; переходы из графических состояний (RT, PS-ресурс)
+    // compute-очередь делать не может — их граф переносит в короткий бакет на графике перед пассом.
+    size_t AddComputePass(std::string_view name,
+        std::initializer_list<size_t> prereqs,
+        std::span<const ResourceAccess> accesses,
+        ExecFn fn) {
+        assert(submitBatchIndex_ == (size_t)-1 && "nested RenderGraph cannot schedule compute passes");
+        return AddPass_(name, prereqs, accesses, std::move(fn), Queue::Compute);
+    }
+
+    // Пасс пишет ровно один DIRECT-CL через ctx.BeginCommandList/EndCommandList — его можно
+    // склеить с соседом. Клеятся подряд идущие в порядке сабмита, если второй зависит от
+    // первого напрямую, своих барьеров не имеет, а запись обоих вместе дешевле kMergeCostUs:
+    // тогда свой CL и лишний вход в ExecuteCommandLists стоят сравнимо с самой работой.
+    // Объявляется каждый кадр, как и сам пасс; перекомпиляции не вызывает.
+    static constexpr float kMergeCostUs = 50.0f;
+    void AllowMerge(size_t pass) {
+        assert(pass < passCursor_ && passes_[pass].queue == Queue::Graphics);
+        passes_[pass].mergeable = true;
+    }
+
+    // Запустить: топологический порядок (Kahn) считается при компиляции, в нём же
+    // резервируются бакеты сабмита (BeginSubmitBatch), так что порядок на GPU от
+    // расписания не зависит. Каждый пасс уходит задачей в group и стартует, как только
+    // отработали exec его пререквизитов; пассы без ребра между собой пишутся параллельно.
+    // Барьеры по объявленным доступам уходят в бакет пасса одним ResourceBarrier
+    // (его пишет Renderer перед CL'ками бакета). Времена жизни ресурсов отдаются
+    // Renderer'у — по ним он раскладывает цели в общей куче.
+    // Неблокирующий: граф должен жить до group.Wait().
+    void Execute(Renderer* renderer, TaskGroup& group) {
         if (renderer == nullptr) {
             return;
         }
+        // В этом кадре объявлено меньше, чем в прошлом, — хвост выкидываем
+        if (passes_.size() != passCursor_ || resources_.size() != resourceCursor_) {
+            passes_.resize(passCursor_);
+            resources_.resize(resourceCursor_);
+            dirty_ = true;
+        }
         const size_t N = passes_.size();
         if (N == 0u) {
             return;
         }
+        if (dirty_) {
+            Compile_();
+        }
+
+        // план барьеров — до бакетов: от него зависит, нужен ли compute-пассу бакет передачи
+        if (!resources_.empty()) {
+            PrepareBarriers_(renderer);
+        }
+
+        if (submitBatchIndex_ == (size_t)-1) {
+            MergeCheapPasses_();
+        }
+
+        // регистрируем бакеты строго в топологическом порядке — до запуска первой задачи
+        for (size_t u : order_) {
+            const Pass& pass = passes_[u];
+            if (submitBatchIndex_ != (size_t)-1) {
+                batches_[u] = submitBatchIndex_;
+                continue;
+            }
+            if (mergeHead_[u] != u) {
+                batches_[u] = batches_[mergeHead_[u]];
+                continue;
+            }
+            if (pass.queue == Queue::Compute && !resources_.empty() && plan_[u].handoffCount != 0u) {
+                handoffBatches_[u] = renderer->BeginSubmitBatch(pass.name, D3D12_COMMAND_LIST_TYPE_DIRECT);
+            }
+            batches_[u] = renderer->BeginSubmitBatch(pass.name,
+                pass.queue == Queue::Compute ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT);
+        }
+
+        if (!resources_.empty()) {
+            EmitBarriers_(renderer);
+        }
+
+        // Межочередные рёбра (после редукции их хватает: ожидания на GPU транзитивны,
+        // а внутри очереди порядок даёт сабмит) — Renderer превратит их в Wait/Signal
+        if (hasCompute_) {
+            for (size_t u : order_) {
+                for (size_t d : passes_[u].deps) {
+                    if (passes_[d].queue != passes_[u].queue) {
+                        renderer->AddBatchWait(batches_[u], batches_[d]);
+                    }
+                }
+                if (handoffBatches_[u] != (size_t)-1) {
+                    renderer->AddBatchWait(batches_[u], handoffBatches_[u]);
+                }
+            }
+            // бакет передачи — только барьеры, писать в него нечего. Закрываем после всех
+            // AddBatchWait: первое закрытие фиксирует план фенсов кадра
+            for (size_t u : order_) {
+                if (handoffBatches_[u] != (size_t)-1) {
+                    renderer->CloseSubmitBatch(handoffBatches_[u]);
+                    handoffBatches_[u] = (size_t)-1;
+                }
+            }
+        }
+
+        // в порядке Kahn у каждого пасса handle'ы пререквизитов уже есть
+        handles_.resize(N);
+        for (size_t u : order_) {
+            depHandles_.clear();
+            for (size_t d : passes_[u].deps) {
+                depHandles_.push_back(handles_[d]);
+            }
+            handles_[u] = TaskSystem::Get().Submit(group, [this, renderer, u]() {
+                RunPass_(renderer, u);
+                }, std::span<const TaskHandle>(depHandles_));
+        }
+        // handle'ы держат задачи в пуле — отпускаем сразу, ёмкость остаётся
+        depHandles_.clear();
+        handles_.clear();
+    }
+
+    // Блокирующий вариант (вложенные графы внутри пасса): ждёт exec всех своих пассов,
+    // помогая пулу. Задачи, которые пассы сами запустили в чужие группы, не ждёт.
+    void Execute(Renderer* renderer) {
+        TaskGroup group(TaskPriority::FrameCritical);
+        Execute(renderer, group);
+        group.Wait();
+    }
+
+    void Clear() {
+        passes_.clear();
+        resources_.clear();
+        passCursor_ = 0;
+        resourceCursor_ = 0;
+        dirty_ = true;
+    }
+
+    // Сколько раз граф перекомпилировал топологию / план барьеров (для отладки)
+    uint64_t GetCompileCount() const { return compileCount_; }
+    uint64_t GetBarrierPlanCount() const { return barrierPlanCount_; }
+
+    // Пассы последней компиляции: объявлено / отсечено (их exec не зовётся, бакета нет)
+    size_t GetPassCount() const { return passes_.size(); }
+    size_t GetCulledPassCount() const { return culledCount_; }
+    // Переходов текущего плана, разделённых на BEGIN_ONLY/END_ONLY
+    size_t GetSplitBarrierCount() const { return splitBarrierCount_; }
+    // Пассов, склеенных в этом кадре с предыдущим (без своего CL и бакета)
+    size_t GetMergedPassCount() const { return mergedPassCount_; }
+
+    static D3D12_RESOURCE_STATES StateFor(Access a, Queue q = Queue::Graphics) {
+        switch (a) {
+        case Access::SRV:
+            return q == Queue::Compute ? D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+                : D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+        case Access::RTV:      return D3D12_RESOURCE_STATE_RENDER_TARGET;
+        case Access::DSVWrite: return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        case Access::DSVRead:  return D3D12_RESOURCE_STATE_DEPTH_READ;
+        case Access::UAV:      return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        case Access::CopySrc:  return D3D12_RESOURCE_STATE_COPY_SOURCE;
+        case Access::CopyDst:  return D3D12_RESOURCE_STATE_COPY_DEST;
+        }
+        return D3D12_RESOURCE_STATE_COMMON;
+    }
+
+private:
+    static constexpr ResourceId kNoResource = UINT32_MAX;
+
+    struct Resource_ {
+        std::string     name;
+        ID3D12Resource* res = nullptr;
+    };
+
+    // Барьер плана: ресурсы по id, указатели подставляются каждый кадр
+    struct BarrierOp_ {
+        D3D12_RESOURCE_BARRIER_TYPE type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        ResourceId            res = kNoResource;
+        ResourceId            aliasBefore = kNoResource;
+        D3D12_RESOURCE_STATES before = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES after = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        uint32_t pos = 0; // позиция пасса в order_, в чьём бакете стоит барьер
+    };
+    struct PassPlan_ {
+        uint32_t barrierBegin = 0, barrierCount = 0;
+        uint32_t discardBegin = 0, discardCount = 0;
+        uint32_t handoffBegin = 0, handoffCount = 0; // compute-пасс: переходы на графике перед ним
+    };
+
+    static bool IsWrite_(Access a) {
+        return a == Access::RTV || a == Access::DSVWrite || a == Access::UAV || a == Access::CopyDst;
+    }
+
+    // Состояния, в которые/из которых переводит COMPUTE-CL
+    static bool IsComputeState_(D3D12_RESOURCE_STATES s) {
+        constexpr D3D12_RESOURCE_STATES kCompute =
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+            D3D12_RESOURCE_STATE_COPY_SOURCE | D3D12_RESOURCE_STATE_COPY_DEST |
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+        return (s & ~kCompute) == 0; // COMMON тоже
+    }
+
+    // [offset, offset + size) двух размещений в одной куче
+    static bool MemoryOverlaps_(uint64_t aOffset, uint64_t aSize, uint64_t bOffset, uint64_t bSize) {
+        return aOffset < bOffset + bSize && bOffset < aOffset + aSize;
+    }
+
+    static bool IsReadOnlyState_(D3D12_RESOURCE_STATES s) {
+        constexpr D3D12_RESOURCE_STATES kRead =
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE |
+            D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_COPY_SOURCE |
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER |
+            D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+        return s != D3D12_RESOURCE_STATE_COMMON && (s & ~kRead) == 0;
+    }
+
+    size_t AddPass_(std::string_view name,
+        std::initializer_list<size_t> prereqs,
+        std::span<const ResourceAccess> accesses,
+        ExecFn fn,
+        Queue queue) {
+        assert((submitBatchIndex_ == (size_t)-1 || accesses.empty()) && "nested RenderGraph cannot declare resources");
+        const size_t index = passCursor_++;
+        if (index < passes_.size()) {
+            Pass& p = passes_[index];
+            if (p.name == name && p.queue == queue &&
+                std::equal(p.prereqs.begin(), p.prereqs.end(), prereqs.begin(), prereqs.end()) &&
+                std::equal(p.accesses.begin(), p.accesses.end(), accesses.begin(), accesses.end())) {
+                p.exec = std::move(fn);
+                p.mergeable = false;
+                return index;
+            }
+            passes_.resize(index); // расхождение: всё дальше объявляется заново
+        }
+        for (size_t d : prereqs) {
+            assert(d < index && "prereq must be added before the pass");
+            (void)d;
+        }
+        for (const ResourceAccess& a : accesses) {
+            assert(a.res < resourceCursor_);
+            (void)a;
+        }
+        Pass pass{ std::string(name), prereqs, { accesses.begin(), accesses.end() }, std::move(fn) };
+        pass.queue = queue;
+        passes_.push_back(std::move(pass));
+        dirty_ = true;
+        return index;
+    }
+
+    // Топология: рёбра по ресурсам, порядок Kahn, времена жизни. Только при смене декларации
+    void Compile_() {
+        const size_t N = passes_.size();
+        const size_t R = resources_.size();
+        ++compileCount_;
+        dirty_ = false;
+        planValid_ = false;
+
+        // Отсечение по потоку данных. Корни — пассы, не пишущие ни в один ресурс графа
+        // (пишут наружу: backbuffer, оверлей, вложенные графы). Живой пасс оживляет последнего
+        // до него писателя каждого ресурса, к которому обращается; запись тоже считается
+        // обращением — RTV без очистки рисует поверх. Явные prereqs — только порядок, не данные:
+        // пасс, чей результат никто живой не читает (SSR при выключенных отражениях), выпадает.
+        std::vector<size_t> lastWriter(R, (size_t)-1);
+        std::vector<std::vector<size_t>> producers(N);
+        for (size_t i = 0; i < N; ++i) {
+            for (const ResourceAccess& a : passes_[i].accesses) {
+                if (lastWriter[a.res] != (size_t)-1 && lastWriter[a.res] != i) {
+                    producers[i].push_back(lastWriter[a.res]);
+                }
+            }
+            for (const ResourceAccess& a : passes_[i].accesses) {
+                if (IsWrite_(a.access)) {
+                    lastWriter[a.res] = i;
+                }
+            }
+        }
+        live_.assign(N, 0);
+        for (size_t i = N; i-- > 0;) {
+            const auto& acc = passes_[i].accesses;
+            if (std::none_of(acc.begin(), acc.end(), [](const ResourceAccess& a) { return IsWrite_(a.access); })) {
+                live_[i] = 1;
+            }
+            if (live_[i]) {
+                for (size_t p : producers[i]) {
+                    live_[p] = 1;
+                }
+            }
+        }
+        culledCount_ = static_cast<size_t>(std::count(live_.begin(), live_.end(), uint8_t(0)));
+
+        // рёбра по ресурсам — в порядке объявления, только между живыми пассами
+        std::fill(lastWriter.begin(), lastWriter.end(), (size_t)-1);
+        std::vector<std::vector<size_t>> readersSinceWrite(R);
+        for (size_t i = 0; i < N; ++i) {
+            Pass& p = passes_[i];
+            p.deps.clear();
+            // prereq на отсечённый пасс переходит на его собственные deps (они уже живые)
+            for (size_t d : p.prereqs) {
+                if (live_[d]) {
+                    p.deps.push_back(d);
+                }
+                else {
+                    p.deps.insert(p.deps.end(), passes_[d].deps.begin(), passes_[d].deps.end());
+                }
+            }
+            for (const ResourceAccess& a : p.accesses) {
+                if (IsWrite_(a.access)) {
+                    // WAR/WAW: после всех читателей с прошлой записи (и самой записи)
+                    if (lastWriter[a.res] != (size_t)-1) {
+                        p.deps.push_back(lastWriter[a.res]);
+                    }
+                    p.deps.insert(p.deps.end(), readersSinceWrite[a.res].begin(), readersSinceWrite[a.res].end());
+                }
+                else if (lastWriter[a.res] != (size_t)-1) {
+                    p.deps.push_back(lastWriter[a.res]); // RAW
+                }
+            }
+            if (live_[i]) {
+                for (const ResourceAccess& a : p.accesses) {
+                    if (IsWrite_(a.access)) {
+                        lastWriter[a.res] = i;
+                        readersSinceWrite[a.res].clear();
+                    }
+                    else {
+                        readersSinceWrite[a.res].push_back(i);
+                    }
+                }
+            }
+            std::erase(p.deps, i); // чтение+запись одного ресурса в самом пассе
+            std::sort(p.deps.begin(), p.deps.end());
+            p.deps.erase(std::unique(p.deps.begin(), p.deps.end()), p.deps.end());
+        }
+
+        // Транзитивная редукция: ребро, которое и так следует через другой dep, лишнее —
+        // меньше продолжений у задач (Compose иначе ждал бы полграфа напрямую)
+        std::vector<std::vector<bool>> reach(N, std::vector<bool>(N, false));
+        for (size_t i = 0; i < N; ++i) {
+            Pass& p = passes_[i];
+            for (size_t d : p.deps) {
+                reach[i][d] = true;
+                for (size_t k = 0; k < d; ++k) {
+                    if (reach[d][k]) {
+                        reach[i][k] = true;
+                    }
+                }
+            }
+            std::erase_if(p.deps, [&](size_t d) {
+                for (size_t e : p.deps) {
+                    if (e != d && reach[e][d]) {
+                        return true;
+                    }
+                }
+                return false;
+            });
+        }
 
         // посчитаем входящие рёбра
         std::vector<size_t> indeg(N, 0);
         std::vector<std::vector<size_t>> out(N);
         for (size_t i = 0; i < N; ++i) {
-            for (size_t d : passes_[i].prereqs) {
-                if (d < N) {
-                    ++indeg[i];
-                    out[d].push_back(i);
-                }
+            if (!live_[i]) {
+                continue;
+            }
+            for (size_t d : passes_[i].deps) {
+                ++indeg[i];
+                out[d].push_back(i);
             }
         }
 
         // очередь «готовых» (in-degree == 0) — стабильно по порядку добавления
         std::queue<size_t> q;
         for (size_t i = 0; i < N; ++i) {
-            if (indeg[i] == 0u) {
+            if (live_[i] && indeg[i] == 0u) {
                 q.push(i);
             }
         }
 
-        size_t done = 0;
+        order_.clear();
+        order_.reserve(N);
         while (!q.empty()) {
             const size_t u = q.front();
             q.pop();
+            order_.push_back(u);
+
+            // раскрываем зависящие
+            for (size_t v : out[u]) {
+                if (--indeg[v] == 0u) {
+                    q.push(v);
+                }
+            }
+        }
+        // рёбра идут только к ранее добавленным пассам — цикла не бывает
+        assert(order_.size() == N - culledCount_ && "RenderGraph has a cycle!");
+        batches_.assign(N, (size_t)-1);
+        handoffBatches_.assign(N, (size_t)-1);
+        mergeHead_.assign(N, (size_t)-1);
+        mergeTail_.assign(N, (size_t)-1);
+        mergedCL_.assign(N, Renderer::ThreadCL{});
+        recordCostUs_.assign(N, -1.0f);
+        hasCompute_ = std::any_of(order_.begin(), order_.end(), [this](size_t u) { return passes_[u].queue == Queue::Compute; });
+
+        // Времена жизни: позиции первого/последнего пасса в порядке сабмита. Транзиентный —
+        // только тот, кого первым делом пишут (RTV/DSV/UAV): его можно Discard'нуть и делить память.
+        // Остальные (читаются с прошлого кадра, не используются или только отсечёнными) — на весь кадр.
+        firstUse_.assign(R, UINT32_MAX);
+        lastUse_.assign(R, 0);
+        transient_.assign(R, 0);
+        for (uint32_t k = 0; k < order_.size(); ++k) {
+            for (const ResourceAccess& a : passes_[order_[k]].accesses) {
+                if (firstUse_[a.res] == UINT32_MAX) {
+                    firstUse_[a.res] = k;
+                    transient_[a.res] = IsWrite_(a.access) && a.access != Access::CopyDst;
+                }
+                lastUse_[a.res] = k;
+            }
+        }
+        for (size_t i = 0; i < R; ++i) {
+            if (!transient_[i]) {
+                firstUse_[i] = 0;
+                lastUse_[i] = UINT32_MAX;
+            }
+        }
+    }
+
+    // Каждый кадр: входные состояния и раскладка те же — план из кэша, иначе пересчёт.
+    // Состояния читаются у Renderer и возвращаются ему одним локом на кадр (в EmitBarriers_)
+    void PrepareBarriers_(Renderer* renderer) {
+        const size_t R = resources_.size();
+        res_.resize(R);
+        for (size_t i = 0; i < R; ++i) {
+            res_[i] = resources_[i].res;
+        }
+        entryStates_.resize(R);
+        renderer->GetResourceStates(res_, entryStates_);
+        renderer->SetTransientLifetimes(res_, firstUse_, lastUse_);
 
-            // регистрируем бакет под этот пасс
-            const size_t batch = submitBatchIndex_ == (size_t)-1 ? renderer->BeginSubmitBatch(passes_[u].name) : submitBatchIndex_;
+        placement_.assign(R, { UINT64_MAX, 0 });
+        for (const Renderer::TransientPlacement& p : renderer->GetTransientPlacements()) {
+            for (size_t i = 0; i < R; ++i) {
+                if (res_[i] != nullptr && res_[i] == p.res) {
+                    placement_[i] = { p.offset, p.size };
+                }
+            }
+        }
 
-            // исполняем лямбду
-            if (passes_[u].exec) {
-                PassContext ctx;
-                ctx.renderer = renderer;
-                ctx.batchIndex = batch;
-                ctx.passName = passes_[u].name;
-                passes_[u].exec(ctx);
+        if (!planValid_ || entryStates_ != planEntryStates_ || placement_ != planPlacement_) {
+            BuildBarrierPlan_();
+        }
+    }
+
+    // Подставить указатели кадра в план и раздать барьеры по бакетам
+    void EmitBarriers_(Renderer* renderer) {
+        for (size_t u : order_) {
+            const PassPlan_& pp = plan_[u];
+            if (pp.handoffCount != 0u) {
+                barrierScratch_.clear();
+                for (uint32_t k = 0; k < pp.handoffCount; ++k) {
+                    barrierScratch_.push_back(MakeBarrier_(planHandoffOps_[pp.handoffBegin + k]));
+                }
+                renderer->SetBatchBarriers(handoffBatches_[u], barrierScratch_);
             }
-            ++done;
+            if (pp.barrierCount == 0u) {
+                continue;
+            }
+            barrierScratch_.clear();
+            for (uint32_t k = 0; k < pp.barrierCount; ++k) {
+                barrierScratch_.push_back(MakeBarrier_(planOps_[pp.barrierBegin + k]));
+            }
+            discardScratch_.clear();
+            for (uint32_t k = 0; k < pp.discardCount; ++k) {
+                discardScratch_.push_back(res_[planDiscards_[pp.discardBegin + k]]);
+            }
+            renderer->SetBatchBarriers(batches_[u], barrierScratch_, discardScratch_);
+        }
 
-            // раскрываем зависящие
-            for (size_t v : out[u]) {
-                if (v < N) {
-                    if (indeg[v] > 0u) {
-                        --indeg[v];
+        renderer->SetResourceStates(res_, planExitStates_);
+    }
+
+    D3D12_RESOURCE_BARRIER MakeBarrier_(const BarrierOp_& op) const {
+        D3D12_RESOURCE_BARRIER b{};
+        b.Type = op.type;
+        b.Flags = op.flags;
+        switch (op.type) {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+            b.Transition.pResource = res_[op.res];
+            b.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            b.Transition.StateBefore = op.before;
+            b.Transition.StateAfter = op.after;
+            break;
+        case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+            b.Aliasing.pResourceBefore = op.aliasBefore != kNoResource ? res_[op.aliasBefore] : nullptr;
+            b.Aliasing.pResourceAfter = res_[op.res];
+            break;
+        default:
+            b.UAV.pResource = res_[op.res];
+            break;
+        }
+        return b;
+    }
+
+    // Проход по пассам в порядке сабмита: текущее состояние каждого ресурса -> нужное пассу
+    void BuildBarrierPlan_() {
+        const size_t R = resources_.size();
+        ++barrierPlanCount_;
+        planValid_ = true;
+        planEntryStates_ = entryStates_;
+        planPlacement_ = placement_;
+        planOps_.clear();
+        planHandoffOps_.clear();
+        planDiscards_.clear();
+        plan_.assign(passes_.size(), PassPlan_{});
+
+        // Кто с кем делит память в текущей раскладке. Если раскладка считана по другим временам
+        // жизни (граф поменялся) и пересечение есть и по времени — Renderer уже пометил её
+        // к пересборке; этот кадр алиасинг-барьеры для такой пары не ставим.
+        std::vector<ResourceId> aliasBefore(R, kNoResource);
+        std::vector<uint8_t> aliased(R, 0);
+        for (size_t i = 0; i < R; ++i) {
+            if (!transient_[i] || placement_[i].first == UINT64_MAX) {
+                continue;
+            }
+            // Предыдущий владелец памяти: последний закончившийся до нас, иначе —
+            // последний в кадре (он владел ею в конце прошлого кадра на этой куче)
+            size_t prevInFrame = (size_t)-1, prevWrapped = (size_t)-1;
+            for (size_t j = 0; j < R; ++j) {
+                if (j == i || !transient_[j] || placement_[j].first == UINT64_MAX ||
+                    !MemoryOverlaps_(placement_[i].first, placement_[i].second, placement_[j].first, placement_[j].second)) {
+                    continue;
+                }
+                if (lastUse_[j] < firstUse_[i]) {
+                    aliased[i] = 1;
+                    if (prevInFrame == (size_t)-1 || lastUse_[j] > lastUse_[prevInFrame]) {
+                        prevInFrame = j;
                     }
-                    if (indeg[v] == 0u) {
-                        q.push(v);
+                }
+                else if (firstUse_[j] > lastUse_[i]) {
+                    aliased[i] = 1;
+                    if (prevWrapped == (size_t)-1 || lastUse_[j] > lastUse_[prevWrapped]) {
+                        prevWrapped = j;
                     }
                 }
             }
+            const size_t prev = prevInFrame != (size_t)-1 ? prevInFrame : prevWrapped;
+            aliasBefore[i] = prev != (size_t)-1 ? static_cast<ResourceId>(prev) : kNoResource;
         }
 
-        // если цикл — лучше упасть ассершкой (в дебаге)
-        if (done != N) {
-            assert(false && "RenderGraph has a cycle!");
+        std::vector<D3D12_RESOURCE_STATES> state = entryStates_;
+        std::vector<size_t> lastUavWriter(R, (size_t)-1);
+        std::vector<uint32_t> lastAccess(R, UINT32_MAX); // позиция последнего пасса, трогавшего ресурс
+        std::vector<D3D12_RESOURCE_STATES> want(R);
+        std::vector<uint8_t> touched(R, 0);
+        splitBarrierCount_ = 0;
+        for (uint32_t k = 0; k < order_.size(); ++k) {
+            const size_t u = order_[k];
+            const Pass& pass = passes_[u];
+            if (pass.accesses.empty()) {
+                continue;
+            }
+            PassPlan_& pp = plan_[u];
+            pp.discardBegin = static_cast<uint32_t>(planDiscards_.size());
+            pp.handoffBegin = static_cast<uint32_t>(planHandoffOps_.size());
+            const bool compute = pass.queue == Queue::Compute;
+
+            // Ресурсы, занимающие общую память с этого пасса: aliasing-барьер до переходов,
+            // Discard — после (RT/DS в памяти с мусором должны начинаться с Clear/Discard)
+            for (const ResourceAccess& a : pass.accesses) {
+                if (aliased[a.res] && firstUse_[a.res] == k &&
+                    std::find(planDiscards_.begin() + pp.discardBegin, planDiscards_.end(), a.res) == planDiscards_.end()) {
+                    BarrierOp_ op;
+                    op.type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+                    op.res = a.res;
+                    op.aliasBefore = aliasBefore[a.res];
+                    op.pos = k;
+                    planOps_.push_back(op);
+                    planDiscards_.push_back(a.res);
+                }
+            }
+
+            // Несколько чтений одного ресурса в пассе — объединяем состояния (DSVRead + SRV)
+            for (const ResourceAccess& a : pass.accesses) {
+                const D3D12_RESOURCE_STATES s = StateFor(a.access, pass.queue);
+                if (!touched[a.res]) {
+                    touched[a.res] = 1;
+                    want[a.res] = s;
+                }
+                else {
+                    assert(!IsWrite_(a.access) && IsReadOnlyState_(want[a.res]) && "conflicting accesses in one pass");
+                    want[a.res] |= s;
+                }
+            }
+
+            for (const ResourceAccess& a : pass.accesses) {
+                if (!touched[a.res]) {
+                    continue; // этот ресурс уже обработан в этом пассе
+                }
+                touched[a.res] = 0;
+                const D3D12_RESOURCE_STATES before = state[a.res];
+                const D3D12_RESOURCE_STATES after = want[a.res];
+                if (before == after) {
+                    // UAV -> UAV между разными пассами: нужен UAV-барьер
+                    if (after == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && lastUavWriter[a.res] != (size_t)-1) {
+                        BarrierOp_ op;
+                        op.type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+                        op.res = a.res;
+                        op.pos = k;
+                        planOps_.push_back(op);
+                    }
+                }
+                else if (compute && !IsComputeState_(before)) {
+                    // Из графического состояния compute-очередь не выводит: переход — на графике
+                    // в бакете передачи, compute-пасс ждёт его фенс
+                    BarrierOp_ op;
+                    op.type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                    op.res = a.res;
+                    op.before = before;
+                    op.after = after;
+                    planHandoffOps_.push_back(op);
+                    state[a.res] = after;
+                }
+                else if (!(IsReadOnlyState_(before) && IsReadOnlyState_(after) && (before & after) == after)) {
+                    BarrierOp_ op;
+                    op.type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                    op.res = a.res;
+                    op.before = before;
+                    op.after = after;
+                    op.pos = k;
+                    const uint32_t beginPos = compute ? UINT32_MAX : SplitBeginPos_(a.res, k, lastAccess[a.res], aliased[a.res] != 0);
+                    if (beginPos != UINT32_MAX) {
+                        BarrierOp_ begin = op;
+                        begin.flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+                        begin.pos = beginPos;
+                        planOps_.push_back(begin);
+                        op.flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+                        ++splitBarrierCount_;
+                    }
+                    planOps_.push_back(op);
+                    state[a.res] = after;
+                }
+                lastUavWriter[a.res] = after == D3D12_RESOURCE_STATE_UNORDERED_ACCESS ? u : (size_t)-1;
+            }
+            for (const ResourceAccess& a : pass.accesses) {
+                lastAccess[a.res] = k;
+            }
+            pp.discardCount = static_cast<uint32_t>(planDiscards_.size()) - pp.discardBegin;
+            pp.handoffCount = static_cast<uint32_t>(planHandoffOps_.size()) - pp.handoffBegin;
+        }
+        planExitStates_ = std::move(state);
+
+        // Начала split-барьеров легли в бакеты более ранних пассов — раскладываем по позициям
+        // (стабильно: внутри бакета aliasing раньше переходов, как их записали)
+        std::stable_sort(planOps_.begin(), planOps_.end(), [](const BarrierOp_& a, const BarrierOp_& b) { return a.pos < b.pos; });
+        for (uint32_t i = 0; i < planOps_.size();) {
+            const uint32_t k = planOps_[i].pos;
+            PassPlan_& pp = plan_[order_[k]];
+            pp.barrierBegin = i;
+            while (i < planOps_.size() && planOps_[i].pos == k) {
+                ++i;
+            }
+            pp.barrierCount = i - pp.barrierBegin;
         }
     }
 
-    void Clear() {
-        passes_.clear();
+    // Куда поставить BEGIN_ONLY перехода, который нужен пассу на позиции k: в бакет первого
+    // графического пасса после последнего, кто трогал ресурс (или с начала кадра), — тогда
+    // переход идёт на GPU, пока работают пассы между ними, а END_ONLY перед k только дожидается.
+    // Не делим: соседние пассы (нечего перекрывать), предыдущий пользователь на compute
+    // (графика не упорядочена с ним до k), первое использование алиаса (память ещё чужая).
+    uint32_t SplitBeginPos_(ResourceId res, uint32_t k, uint32_t lastAccess, bool aliased) const {
+        if (aliased && firstUse_[res] == k) {
+            return UINT32_MAX;
+        }
+        if (lastAccess != UINT32_MAX && passes_[order_[lastAccess]].queue != Queue::Graphics) {
+            return UINT32_MAX;
+        }
+        for (uint32_t p = lastAccess == UINT32_MAX ? 0u : lastAccess + 1u; p < k; ++p) {
+            if (passes_[order_[p]].queue == Queue::Graphics) {
+                return p;
+            }
+        }
+        return UINT32_MAX;
     }
 
-private:
+    // Цепочки склейки на этот кадр: mergeHead_ — первый пасс цепочки (его бакет и CL),
+    // mergeTail_[head] — последний (после него граф закрывает CL и бакет). Стоимость записи
+    // меряется каждый кадр, пока её нет (первый кадр после компиляции) — не клеим.
+    void MergeCheapPasses_() {
+        mergedPassCount_ = 0;
+        float chainCost = 0.0f;
+        for (size_t k = 0; k < order_.size(); ++k) {
+            const size_t u = order_[k];
+            const Pass& pass = passes_[u];
+            mergeHead_[u] = u;
+            mergeTail_[u] = u;
+            const float cost = pass.mergeable ? recordCostUs_[u] : -1.0f;
+            if (k > 0u && cost >= 0.0f) {
+                const size_t prev = order_[k - 1];
+                const size_t head = mergeHead_[prev];
+                const bool ownBarriers = !resources_.empty() &&
+                    (plan_[u].barrierCount != 0u || plan_[u].discardCount != 0u);
+                if (passes_[prev].mergeable && recordCostUs_[prev] >= 0.0f && !ownBarriers &&
+                    std::find(pass.deps.begin(), pass.deps.end(), prev) != pass.deps.end() &&
+                    chainCost + cost <= kMergeCostUs) {
+                    mergeHead_[u] = head;
+                    mergeTail_[head] = u;
+                    chainCost += cost;
+                    ++mergedPassCount_;
+                    continue;
+                }
+            }
+            chainCost = cost >= 0.0f ? cost : kMergeCostUs;
+        }
+    }
+
+    void RunPass_(Renderer* renderer, size_t u) {
+        Pass& pass = passes_[u];
+        const bool root = submitBatchIndex_ == (size_t)-1;
+        const size_t head = root ? mergeHead_[u] : u;
+        const bool merged = root && mergeTail_[head] != head;
+        const auto t0 = std::chrono::steady_clock::now();
+        if (pass.exec) {
+            PassContext ctx;
+            ctx.renderer = renderer;
+            ctx.batchIndex = batches_[u];
+            ctx.passName = pass.name;
+            ctx.mergedCL = merged ? &mergedCL_[head] : nullptr;
+            pass.exec(ctx);
+        }
+        if (!root) {
+            return;
+        }
+        // EMA: один дорогой кадр (первая сборка текста, компиляция PSO) склейку не ломает надолго
+        const float us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t0).count();
+        float& cost = recordCostUs_[u];
+        cost = cost < 0.0f ? us : cost + (us - cost) * 0.1f;
+        if (mergeTail_[head] != u) {
+            return; // цепочку дописывает следующий
+        }
+        if (mergedCL_[head].cl != nullptr) {
+            renderer->EndThreadCommandList(mergedCL_[head], batches_[u]);
+        }
+        // все CL бакета сданы (вложенные графы и ParallelFor пассов — блокирующие)
+        renderer->CloseSubmitBatch(batches_[u]);
+    }
+
+    // декларация (переживает кадры)
     std::vector<Pass> passes_;
+    std::vector<Resource_> resources_;
+    size_t passCursor_ = 0;
+    ResourceId resourceCursor_ = 0;
+    bool dirty_ = true;
 	size_t submitBatchIndex_ = (size_t)-1;
+
+    // компиляция
+    std::vector<size_t> order_;   // только живые пассы
+    std::vector<uint8_t> live_;
+    size_t culledCount_ = 0;
+    std::vector<size_t> batches_; // бакет сабмита на пасс (заполняет Execute)
+    std::vector<size_t> handoffBatches_; // compute-пасс: бакет переходов на графике, на кадр
+    std::vector<size_t> mergeHead_, mergeTail_; // склейка (на кадр, MergeCheapPasses_)
+    std::vector<Renderer::ThreadCL> mergedCL_;  // общий CL цепочки, по голове
+    std::vector<float> recordCostUs_;           // EMA времени записи пасса; < 0 — ещё не мерили
+    size_t mergedPassCount_ = 0;
+    bool hasCompute_ = false;
+    std::vector<uint32_t> firstUse_, lastUse_;
+    std::vector<uint8_t> transient_;
+    uint64_t compileCount_ = 0;
+
+    // план барьеров и ключ, при котором он верен
+    bool planValid_ = false;
+    std::vector<BarrierOp_> planOps_;
+    std::vector<BarrierOp_> planHandoffOps_;
+    std::vector<ResourceId> planDiscards_;
+    std::vector<PassPlan_> plan_;
+    std::vector<D3D12_RESOURCE_STATES> planEntryStates_, planExitStates_;
+    std::vector<std::pair<uint64_t, uint64_t>> planPlacement_;
+    uint64_t barrierPlanCount_ = 0;
+    size_t splitBarrierCount_ = 0;
+
+    // scratch кадра (ёмкость переживает кадры)
+    std::vector<ID3D12Resource*> res_;
+    std::vector<D3D12_RESOURCE_STATES> entryStates_;
+    std::vector<std::pair<uint64_t, uint64_t>> placement_;
+    std::vector<D3D12_RESOURCE_BARRIER> barrierScratch_;
+    std::vector<ID3D12Resource*> discardScratch_;
+    std::vector<TaskHandle> handles_;
+    std::vector<TaskHandle> depHandles_;
 };
@@ -50,23 +50,31 @@ void RenderableObject::Init(Renderer* renderer,
     graphicsMaterial_ = renderer->GetMaterialManager()->GetOrCreateGraphics(renderer, graphicsDesc_);
 }
 
-void RenderableObject::IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl)
+AsyncTask<void> RenderableObject::PreloadAsync(Renderer* renderer)
+{
+    if (!matData_ && !matPreset_.empty()) {
+        (void)co_await renderer->GetMaterialDataManager()->GetOrCreateAsync(renderer, matPreset_);
+    }
+}
+
+void RenderableObject::IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache)
 {
     if (!renderer) { return; }
     if (!GetMesh()) { return; }
     if (cl == nullptr) { return; }
-    GetMesh()->Draw(cl);
+    GetMesh()->Draw(cl, &cache);
 }
 
-void RenderableObject::RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl)
+void RenderableObject::RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache)
 {
     if (!renderer) { return; }
     if (cl == nullptr) { return; }
     // Установить графический материал
-    graphicsMaterial_->Bind(cl, graphicsCtx_, renderer->GetWireframeMode() && allowWireframe_);
+    graphicsMaterial_->Bind(cl, graphicsCtx_, renderer->GetWireframeMode() && allowWireframe_, &cache);
 }
 
-void RenderableObject::Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj)
+void RenderableObject::Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj,
+    BindStateCache& cache)
 {
     if (!renderer) { return; }
     if (cl == nullptr) { return; }
@@ -96,14 +104,39 @@ void RenderableObject::Render(Renderer* renderer, ID3D12GraphicsCommandList* cl,
     RecordCompute(renderer, cl);
     UpdateUniforms(renderer, view, proj);
     PopulateContext(renderer, cl);
-    RecordGraphics(renderer, cl);
+    RecordGraphics(renderer, cl, cache);
     
-    IssueDraw(renderer, cl);
+    IssueDraw(renderer, cl, cache);
+}
+
+bool RenderableObject::GetWorldBounds(Math::AABB& out) const
+{
+    const Mesh* mesh = GetMesh();
+    if (mesh == nullptr || !mesh->HasLocalBounds()) {
+        return false;
+    }
+    // Центр — как точка; полуразмер — через |M| (строки-векторы: e' = |r0|*ex + |r1|*ey + |r2|*ez)
+    const Math::AABB& lb = mesh->GetLocalBounds();
+    const XMMATRIX m = renderModelMatrix_.xm();
+    const XMVECTOR c = XMVector3TransformCoord(lb.Center().xm(), m);
+    const XMVECTOR e = lb.Extents().xm();
+    XMVECTOR ew = XMVectorMultiply(XMVectorAbs(m.r[0]), XMVectorSplatX(e));
+    ew = XMVectorMultiplyAdd(XMVectorAbs(m.r[1]), XMVectorSplatY(e), ew);
+    ew = XMVectorMultiplyAdd(XMVectorAbs(m.r[2]), XMVectorSplatZ(e), ew);
+    out.minv = Math::float3::FromXM(XMVectorSubtract(c, ew));
+    out.maxv = Math::float3::FromXM(XMVectorAdd(c, ew));
+    return true;
+}
+
+void RenderableObject::PublishRenderState()
+{
+    renderModelMatrix_ = modelMatrix_;
+    renderMatParams_ = matParams_;
 }
 
 void RenderableObject::ApplyMaterialParamsToCB()
 {
-    const auto& p = matParams_;
+    const auto& p = renderMatParams_;
     UpdateUniform("baseColor", p.baseColor.xm());
     UpdateUniform("metalRough", p.metalRough.xm());
     UpdateUniform("texOffsScale", p.texOffsScale.xm());
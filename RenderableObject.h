@@ -25,14 +25,20 @@ public:
 
     // Жизненный цикл
     virtual void Init(Renderer* renderer, ID3D12GraphicsCommandList* uploadCmdList, std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive);
+    AsyncTask<void> PreloadAsync(Renderer* renderer) override;
     virtual void Tick(float /*dt*/) {}
+    void PublishRenderState() override;
 
     // Базовый отрисовщик: Compute -> Graphics (Bind/IssueDraw)
-    virtual void Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj);
+    virtual void Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj,
+        BindStateCache& cache);
 
-    // Трансформ
+    // Трансформ (состояние симуляции; Render читает GetRenderModelMatrix)
     const Math::mat4& GetModelMatrix() const { return modelMatrix_; }
     void SetModelMatrix(const Math::mat4& m) { modelMatrix_ = m; }
+    const Math::mat4& GetRenderModelMatrix() const { return renderModelMatrix_; }
+    // Локальный AABB меша под renderModelMatrix_
+    bool GetWorldBounds(Math::AABB& out) const override;
 
     // Меш/материал
     Mesh* GetMesh() { return mesh_.get(); }
@@ -59,8 +65,8 @@ protected:
     virtual void RecordCompute(Renderer* renderer, ID3D12GraphicsCommandList* cl) {}
 	virtual void UpdateUniforms(Renderer* renderer, const mat4& view, const mat4& proj) {}
     virtual void PopulateContext(Renderer* renderer, ID3D12GraphicsCommandList* cl) {}
-    virtual void RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl);
-    virtual void IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl);
+    virtual void RecordGraphics(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache);
+    virtual void IssueDraw(Renderer* renderer, ID3D12GraphicsCommandList* cl, BindStateCache& cache);
 
     // Утилита записи в CB по имени из layout (b0)
     template<typename T> bool UpdateUniform(const std::string& name, const T& value) {
@@ -86,6 +92,11 @@ protected:
     std::shared_ptr<Mesh> mesh_;
     Math::mat4 modelMatrix_;
 
+    // Опубликованная копия для записи кадра: Tick пишет modelMatrix_/matParams_,
+    // Render/UpdateUniforms читают только эти поля
+    Math::mat4     renderModelMatrix_;
+    MaterialParams renderMatParams_;
+
     // CB (upload, пер-объектный)
     const ConstantBufferLayout* cbLayout_ = nullptr;
     uint8_t* cbvDataBegin_ = nullptr;
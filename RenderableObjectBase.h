@@ -3,6 +3,9 @@
 #include <vector>
 
 #include "RenderGraph.h"
+#include "AsyncTask.h"
+#include "BindStateCache.h"
+#include "Math.h"
 
 class Renderer;
 
@@ -11,8 +14,24 @@ class RenderableObjectBase
 public:
     virtual ~RenderableObjectBase() noexcept = default;
     virtual void Init(Renderer* renderer, ID3D12GraphicsCommandList* uploadCmdList, std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive) = 0;
+    // Предзагрузка ассетов в кэши менеджеров до Init (Scene::InitAll ждёт все параллельно)
+    virtual AsyncTask<void> PreloadAsync(Renderer* /*renderer*/) { co_return; }
     virtual void Tick(float /*dt*/) = 0;
-    virtual void Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj) = 0;
+    // Конвейер кадров: Tick(N+1) идёт параллельно с записью кадра N, поэтому Render читает
+    // только опубликованную копию состояния. Scene зовёт между кадрами, когда нет ни тиков, ни записи
+    virtual void PublishRenderState() {}
+    // cache — состояние cl, общее для всех объектов, записываемых в него подряд
+    virtual void Render(Renderer* renderer, ID3D12GraphicsCommandList* cl, const mat4& view, const mat4& proj,
+        BindStateCache& cache) = 0;
     virtual bool IsTransparent() const = 0;
     virtual bool IsSimpleRender() const = 0;
+    // Мировой AABB по опубликованному состоянию (отсечение по пирамиде). false — границ нет,
+    // объект рисуется всегда
+    virtual bool GetWorldBounds(Math::AABB& /*out*/) const { return false; }
+
+    // Асинхронный compute объекта: Scene собирает такие в один compute-пасс графа
+    // (COMPUTE-очередь) до GBuffer. Выход — буфер, который compute пишет как UAV,
+    // а графика объекта читает как SRV; переходы и фенсы ставит граф. nullptr — compute нет
+    virtual ID3D12Resource* GetAsyncComputeOutput() const { return nullptr; }
+    virtual void RecordAsyncCompute(Renderer* /*renderer*/, ID3D12GraphicsCommandList* /*cl*/) {}
 };
\ No newline at end of file
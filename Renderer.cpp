@@ -1,6 +1,7 @@
 #include "Renderer.h"
 #include "Helpers.h"
 #include <cassert>
+#include <cstdio>
 #include <dxgidebug.h>
 #pragma comment(lib, "dxguid.lib")
 #include <d3d12sdklayers.h> // ID3D12Debug*, ID3D12InfoQueue
@@ -56,14 +57,15 @@ void Renderer::Shutdown()
     // 1) Остановить «таймлайн» команд: никому ничего больше не сабмитим
     {
         std::lock_guard<std::mutex> lk(submitMtx_);
-        submitTimeline_.clear(); // PassBatch_ ссылается только на CL из кадровых пулов :contentReference[oaicite:3]{index=3}
+        submitTimeline_.clear();
+        submitBatchCount_ = 0; // PassBatch_ ссылается только на CL из кадровых пулов :contentReference[oaicite:3]{index=3}
     }
 
     // 2) Offscreen (G-Buffer/Light/Scene/Depth) — уничтожаем первыми
     DestroyDeferredTargets(); // корректно резетит ресурсы и их heap’ы + чистит knownStates_ :contentReference[oaicite:4]{index=4}
 
     // 3) Backbuffer’ы и RTV/DSV heap’ы
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    for (UINT i = 0; i < kMaxFramesInFlight; ++i) {
         renderTargets_[i].Reset();
     }
     depthBuffer_.Reset();
@@ -90,19 +92,33 @@ void Renderer::Shutdown()
 
     // 6) Кадровые ресурсы: сбросить использование пулов, обнулить аплоад-ринг
     // (их реальные ComPtr освободятся при разрушении Renderer, но это снимет связности)
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    for (UINT i = 0; i < kMaxFramesInFlight; ++i) {
+        frameFenceValues_[i] = 0;
+        if (!frameResources_[i]) {
+            continue;
+        }
         frameResources_[i]->ResetCommandAllocators(device_.Get());
         frameResources_[i]->ResetCommandListsUsage();
         frameResources_[i]->ResetUpload(); // очищает фолбэк-чанки и сбрасывает указатели внутри кадра :contentReference[oaicite:5]{index=5}
         frameResources_[i].reset();
-        frameFenceValues_[i] = 0;
     }
     nextFenceValue_ = 1;
+    frameSlot_ = 0;
 
     // 7) Fence/Queue
     if (fence_) {
         fence_.Reset();
     }
+    if (uploadFence_) {
+        uploadFence_.Reset();
+    }
+    nextUploadFenceValue_ = 1;
+    computeFence_.Reset();
+    computeQueue_.Reset();
+    nextComputeFenceValue_ = 1;
+    handoffFence_.Reset();
+    nextHandoffFenceValue_ = 1;
+    lastFrameFenceValue_ = 0;
     if (commandQueue_) {
         commandQueue_.Reset();
     }
@@ -153,7 +169,16 @@ void Renderer::InitD3D12(HWND window) {
     qd.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
     ThrowIfFailed(device_->CreateCommandQueue(&qd, IID_PPV_ARGS(&commandQueue_)));
 
-    // --- SwapChain + RTVs (kFrameCount) ---
+    D3D12_COMMAND_QUEUE_DESC cqd{};
+    cqd.Type = D3D12_COMMAND_LIST_TYPE_COMPUTE;
+    cqd.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    ThrowIfFailed(device_->CreateCommandQueue(&cqd, IID_PPV_ARGS(&computeQueue_)));
+    ThrowIfFailed(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&computeFence_)));
+    nextComputeFenceValue_ = 1;
+    ThrowIfFailed(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&handoffFence_)));
+    nextHandoffFenceValue_ = 1;
+
+    // --- SwapChain + RTVs (BackBufferCount_) ---
     CreateSwapChainAndRTVs(width_, height_);
 
     // --- Depth ---
@@ -171,18 +196,53 @@ void Renderer::InitD3D12(HWND window) {
             ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
         }
     }
+    if (!uploadFence_) {
+        ThrowIfFailed(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&uploadFence_)));
+    }
 
     // --- Frame resources ---
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    CreateFrameResources_();
+
+    samplerManager_.Init(device_.Get(), 512);
+}
+
+// Кольцо под framesInFlight_: недостающие слоты создаются, лишние освобождаются.
+// Только когда GPU простаивает (InitD3D12 / SetFramesInFlight после полной синхронизации)
+void Renderer::CreateFrameResources_() {
+    for (UINT i = 0; i < kMaxFramesInFlight; ++i) {
+        frameFenceValues_[i] = 0;
+        if (i >= framesInFlight_) {
+            frameResources_[i].reset();
+            continue;
+        }
+        if (frameResources_[i]) {
+            continue;
+        }
         // per-frame shader-visible heaps
         frameResources_[i] = std::make_unique<FrameResource>();
         frameResources_[i]->GetDescAlloc().Init(device_.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 4096);
         frameResources_[i]->GetSamplerAlloc().Init(device_.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 256);
-        frameFenceValues_[i] = 0;
         frameResources_[i]->InitUpload(device_.Get(), /*bytes*/ 4 * 1024 * 1024);
     }
+    frameSlot_ = 0;
+}
 
-    samplerManager_.Init(device_.Get(), 512);
+void Renderer::SetFramesInFlight(UINT count) {
+    count = std::clamp(count, 1u, kMaxFramesInFlight);
+    if (count == framesInFlight_) {
+        return;
+    }
+    framesInFlight_ = count;
+    if (!device_) {
+        return; // применится в InitD3D12
+    }
+
+    // Всё, что GPU ещё читает из кольца и свапа, должно отработать
+    WaitForPreviousFrame();
+    CreateFrameResources_();
+    CreateSwapChainAndRTVs(width_, height_); // число backbuffer'ов зависит от framesInFlight_
+    CreateDepthResources(width_, height_);
+    CreateDeferredTargets(width_, height_);
 }
 
 void Renderer::InitFence() {
@@ -219,15 +279,15 @@ void Renderer::CreateSwapChainAndRTVs(UINT width, UINT height) {
     ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&factory)));
 
     // Уничтожим старый свап и RTV при переинициализации (если было)
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    for (UINT i = 0; i < kMaxFramesInFlight; ++i) {
         renderTargets_[i].Reset();
     }
     rtvHeap_.Reset();
     swapChain_.Reset();
 
-    // Создаём swap chain (kFrameCount)
+    // Создаём swap chain (BackBufferCount_)
     DXGI_SWAP_CHAIN_DESC1 scd{};
-    scd.BufferCount = kFrameCount;
+    scd.BufferCount = BackBufferCount_();
     scd.Width = width;
     scd.Height = height;
     scd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -240,11 +300,11 @@ void Renderer::CreateSwapChainAndRTVs(UINT width, UINT height) {
         commandQueue_.Get(), hWnd_, &scd, nullptr, nullptr, &swap1));
     ThrowIfFailed(swap1.As(&swapChain_));
 
-    currentFrameIndex_ = swapChain_->GetCurrentBackBufferIndex();
+    backBufferIndex_ = swapChain_->GetCurrentBackBufferIndex();
 
     // RTV heap
     D3D12_DESCRIPTOR_HEAP_DESC rtvDesc{};
-    rtvDesc.NumDescriptors = kFrameCount;
+    rtvDesc.NumDescriptors = BackBufferCount_();
     rtvDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     rtvDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     ThrowIfFailed(device_->CreateDescriptorHeap(&rtvDesc, IID_PPV_ARGS(&rtvHeap_)));
@@ -252,7 +312,7 @@ void Renderer::CreateSwapChainAndRTVs(UINT width, UINT height) {
 
     // RTVs
     D3D12_CPU_DESCRIPTOR_HANDLE rtv = rtvHeap_->GetCPUDescriptorHandleForHeapStart();
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    for (UINT i = 0; i < BackBufferCount_(); ++i) {
         ThrowIfFailed(swapChain_->GetBuffer(i, IID_PPV_ARGS(&renderTargets_[i])));
 
         D3D12_RENDER_TARGET_VIEW_DESC rtvFmt{};
@@ -323,23 +383,30 @@ void Renderer::SignalFrame(UINT frameIndex) {
     const UINT64 v = nextFenceValue_++;
     ThrowIfFailed(commandQueue_->Signal(fence_.Get(), v));
     frameFenceValues_[frameIndex] = v;
+    lastFrameFenceValue_ = v;
 }
 
 void Renderer::BeginFrame() {
-    // Ждём GPU по своему backbuffer'у
-    WaitForFrame(currentFrameIndex_);
+    // Ждём GPU по своему слоту кольца (кадр framesInFlight_ назад)
+    WaitForFrame(frameSlot_);
+
+    // Граф сообщил новые времена жизни транзиентов — перекладываем цели только этого слота:
+    // его GPU-работа только что дождана, остальные слоты переложатся в своих BeginFrame
+    if (deferredLayoutGen_[frameSlot_] != transientLayoutGen_) {
+        PlaceDeferredTargets_(frameSlot_);
+    }
 
     ++totalFrameNumber_;
 
     // Сброс кадровых пулов
-    auto& fr = frameResources_[currentFrameIndex_];
+    auto& fr = frameResources_[frameSlot_];
     fr->ResetCommandAllocators(device_.Get());
     fr->ResetCommandListsUsage();
 
-    frameResources_[currentFrameIndex_]->GetDescAlloc().ResetPerFrame();
-    frameResources_[currentFrameIndex_]->GetSamplerAlloc().ResetPerFrame();
-    frameResources_[currentFrameIndex_]->ResetCommandListsUsage();
-    frameResources_[currentFrameIndex_]->ResetUpload();
+    frameResources_[frameSlot_]->GetDescAlloc().ResetPerFrame();
+    frameResources_[frameSlot_]->GetSamplerAlloc().ResetPerFrame();
+    frameResources_[frameSlot_]->ResetCommandListsUsage();
+    frameResources_[frameSlot_]->ResetUpload();
 }
 
 void Renderer::EndFrame() {
@@ -394,19 +461,19 @@ void Renderer::Tick(float dt)
         }
 
         // 2) применим pending-пересборки (если скан что-то нашёл и флаг выставлен)
-        materialManager_.ApplyPendingHotReloads(this, totalFrameNumber_, /*keepAliveFrames=*/kFrameCount + 1);
+        materialManager_.ApplyPendingHotReloads(this, totalFrameNumber_, /*keepAliveFrames=*/framesInFlight_ + 1);
     }
 }
 
 Renderer::ThreadCL Renderer::BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE type,
     ID3D12PipelineState* pso) {
-    auto& fr = frameResources_[currentFrameIndex_];
+    auto& fr = frameResources_[frameSlot_];
     ID3D12CommandAllocator* alloc = fr->AcquireCommandAllocator(device_.Get(), type);
     ID3D12GraphicsCommandList* cl = fr->AcquireCommandList(device_.Get(), type, alloc, pso);
 
     ID3D12DescriptorHeap* heaps[] = {
-        frameResources_[currentFrameIndex_]->GetDescAlloc().GetShaderVisibleHeap(),
-        frameResources_[currentFrameIndex_]->GetSamplerAlloc().GetShaderVisibleHeap()
+        frameResources_[frameSlot_]->GetDescAlloc().GetShaderVisibleHeap(),
+        frameResources_[frameSlot_]->GetSamplerAlloc().GetShaderVisibleHeap()
     };
     cl->SetDescriptorHeaps(_countof(heaps), heaps);
 
@@ -426,33 +493,130 @@ void Renderer::EndThreadCommandList(ThreadCL& t, size_t batchIndex) {
     if (t.cl != nullptr) {
         ThrowIfFailed(t.cl->Close());
         std::lock_guard<std::mutex> lk(submitMtx_);
-        if (batchIndex < submitTimeline_.size()) {
+        if (batchIndex < submitBatchCount_) {
+            assert(!submitTimeline_[batchIndex].closed && "CL ended after CloseSubmitBatch");
             submitTimeline_[batchIndex].directs.push_back(t.cl);
+            submitTimeline_[batchIndex].directStates.push_back(t.states);
         }
         t.cl = nullptr;
         t.alloc = nullptr;
+        t.states = nullptr;
     }
 }
 
 void Renderer::BeginSubmitTimeline() {
     std::lock_guard<std::mutex> lk(submitMtx_);
-    submitTimeline_.clear();
+    ResetSubmitTimeline_();
+}
+
+// Бакеты не удаляются, а очищаются: ёмкость векторов и имён переживает кадр
+void Renderer::ResetSubmitTimeline_() {
+    for (size_t i = 0; i < submitBatchCount_; ++i) {
+        PassBatch_& pb = submitTimeline_[i];
+        pb.name.clear();
+        pb.type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        pb.driver = nullptr;
+        pb.driverStates = nullptr;
+        pb.bundles.clear();
+        pb.directs.clear();
+        pb.directStates.clear();
+        pb.barriers.clear();
+        pb.discards.clear();
+        pb.waitsOn.clear();
+        pb.closed = false;
+    }
+    submitBatchCount_ = 0;
+    syncPlanned_ = false;
+    flushedBatches_ = 0;
+    flushSegment_ = 0;
+    segmentStarted_ = false;
 }
 
-size_t Renderer::BeginSubmitBatch(const std::string& passName) {
+size_t Renderer::BeginSubmitBatch(std::string_view passName, D3D12_COMMAND_LIST_TYPE type) {
     std::lock_guard<std::mutex> lk(submitMtx_);
-    const size_t idx = submitTimeline_.size();
-    submitTimeline_.push_back({});
-    submitTimeline_.back().name = passName;
+    assert(!syncPlanned_ && "batches must be declared before the first CloseSubmitBatch");
+    const size_t idx = submitBatchCount_++;
+    if (idx == submitTimeline_.size()) {
+        submitTimeline_.emplace_back();
+    }
+    submitTimeline_[idx].name.assign(passName);
+    submitTimeline_[idx].type = type;
     return idx;
 }
 
-void Renderer::RegisterPassDriver(ID3D12GraphicsCommandList* cl, size_t batchIndex)
+void Renderer::AddBatchWait(size_t batchIndex, size_t producerBatch)
+{
+    std::lock_guard<std::mutex> lk(submitMtx_);
+    assert(producerBatch < batchIndex && "batch can only wait for an earlier one");
+    assert(!syncPlanned_ && "waits must be declared before the first CloseSubmitBatch");
+    if (batchIndex < submitBatchCount_) {
+        submitTimeline_[batchIndex].waitsOn.push_back(static_cast<uint32_t>(producerBatch));
+    }
+}
+
+void Renderer::RegisterPassDriver(const ThreadCL& driver, size_t batchIndex)
 {
     std::lock_guard<std::mutex> lk(submitMtx_);
-    if (batchIndex < submitTimeline_.size()) {
-        submitTimeline_[batchIndex].driver = cl;
+    if (batchIndex < submitBatchCount_) {
+        submitTimeline_[batchIndex].driver = driver.cl;
+        submitTimeline_[batchIndex].driverStates = driver.states;
+    }
+}
+
+void Renderer::SetBatchBarriers(size_t batchIndex, std::span<const D3D12_RESOURCE_BARRIER> barriers,
+    std::span<ID3D12Resource* const> discards)
+{
+    std::lock_guard<std::mutex> lk(submitMtx_);
+    if (batchIndex < submitBatchCount_) {
+        submitTimeline_[batchIndex].barriers.assign(barriers.begin(), barriers.end());
+        submitTimeline_[batchIndex].discards.assign(discards.begin(), discards.end());
+    }
+}
+
+void Renderer::SetTransientLifetimes(std::span<ID3D12Resource* const> res,
+    std::span<const uint32_t> firstUse, std::span<const uint32_t> lastUse)
+{
+    const auto& D = deferred_[frameSlot_];
+    ID3D12Resource* const slots[kDeferredSrvPerFrame] = {
+        D.gb0.Get(), D.gb1.Get(), D.gb2.Get(), D.depth.Get(), D.light.Get(), D.scene.Get(), D.ssr.Get(), D.ssrBlur.Get() };
+
+    for (size_t i = 0; i < res.size() && i < firstUse.size() && i < lastUse.size(); ++i) {
+        for (UINT s = 0; s < kDeferredSrvPerFrame; ++s) {
+            if (res[i] != nullptr && res[i] == slots[s]) {
+                TransientRequest& t = transientLifetimes_[s];
+                if (t.firstUse != firstUse[i] || t.lastUse != lastUse[i]) {
+                    t.firstUse = firstUse[i];
+                    t.lastUse = lastUse[i];
+                    ++transientLayoutGen_;
+                }
+                break;
+            }
+        }
+    }
+}
+
+Renderer::UploadBatch Renderer::BeginUpload()
+{
+    UploadBatch b;
+    ThrowIfFailed(device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&b.alloc)));
+    ThrowIfFailed(device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, b.alloc.Get(), nullptr, IID_PPV_ARGS(&b.cl)));
+    b.cl->SetName(L"AsyncUploadCL");
+    return b;
+}
+
+GpuFence Renderer::SubmitUpload(UploadBatch& batch, TaskPriority resumePriority)
+{
+    ThrowIfFailed(batch.cl->Close());
+
+    UINT64 value = 0;
+    {
+        std::lock_guard<std::mutex> lk(uploadMtx_);
+        ID3D12CommandList* lists[] = { batch.cl.Get() };
+        commandQueue_->ExecuteCommandLists(1, lists);
+        value = nextUploadFenceValue_++;
+        ThrowIfFailed(commandQueue_->Signal(uploadFence_.Get(), value));
     }
+    return GpuFence(uploadFence_.Get(), value, resumePriority);
 }
 
 void Renderer::EndThreadCommandBundle(ThreadCL& b, size_t batchIndex)
@@ -460,7 +624,8 @@ void Renderer::EndThreadCommandBundle(ThreadCL& b, size_t batchIndex)
     if (b.cl != nullptr) {
         ThrowIfFailed(b.cl->Close());
         std::lock_guard<std::mutex> lk(submitMtx_);
-        if (batchIndex < submitTimeline_.size()) {
+        if (batchIndex < submitBatchCount_) {
+            assert(!submitTimeline_[batchIndex].closed && "bundle ended after CloseSubmitBatch");
             submitTimeline_[batchIndex].bundles.push_back(b.cl);
         }
         b.cl = nullptr;
@@ -468,52 +633,236 @@ void Renderer::EndThreadCommandBundle(ThreadCL& b, size_t batchIndex)
     }
 }
 
-void Renderer::ExecuteTimelineAndPresent() {
-    std::vector<ID3D12CommandList*> lists;
+void Renderer::CloseSubmitBatch(size_t batchIndex)
+{
+    std::lock_guard<std::mutex> lk(submitMtx_);
+    if (batchIndex < submitBatchCount_) {
+        submitTimeline_[batchIndex].closed = true;
+        FlushClosedBatches_();
+    }
+}
 
-    // собрать по порядку батчей
-    {
-        std::lock_guard<std::mutex> lk(submitMtx_);
-        for (auto& pb : submitTimeline_) {
-            // Если есть driver (создан в пассе) — дописываем в него ExecuteBundle(...)
-            if (pb.driver != nullptr) {
-                for (auto* b : pb.bundles) {
-                    if (b != nullptr) {
-                        pb.driver->ExecuteBundle(b);
-                    }
-                }
-                ThrowIfFailed(pb.driver->Close());
-                lists.push_back(pb.driver);
+// Сегменты очередей и фенсы между ними: бакеты и их waitsOn к этому моменту объявлены все
+void Renderer::PlanQueueSync_() {
+    syncBatches_.resize(submitBatchCount_);
+    for (size_t bi = 0; bi < submitBatchCount_; ++bi) {
+        const PassBatch_& pb = submitTimeline_[bi];
+        const bool compute = pb.type == D3D12_COMMAND_LIST_TYPE_COMPUTE;
+        syncBatches_[bi] = { compute ? kComputeSyncQueue : kDirectSyncQueue, pb.waitsOn };
+    }
+    uint64_t nextValue[QueueSyncPlan::kMaxQueues] = { nextFenceValue_, nextComputeFenceValue_, 1 };
+    queueSync_.Build(syncBatches_, nextValue, kDirectSyncQueue);
+    nextFenceValue_ = nextValue[kDirectSyncQueue];
+    nextComputeFenceValue_ = nextValue[kComputeSyncQueue];
+
+    syncPlanned_ = true;
+    flushedBatches_ = 0;
+    flushSegment_ = 0;
+    segmentStarted_ = false;
+    computeStarted_ = false;
+}
+
+// Под submitMtx_. Сегмент плана может уйти несколькими ExecuteCommandLists по мере
+// закрытия его бакетов: Wait'ы — перед первой частью, Signal — после последней.
+// Мьютекс держим и на время сабмита: порядок бакетов на очереди = порядок в таймлайне.
+void Renderer::FlushClosedBatches_() {
+    if (!syncPlanned_) {
+        PlanQueueSync_();
+    }
+    size_t end = flushedBatches_;
+    while (end < submitBatchCount_ && submitTimeline_[end].closed) {
+        ++end;
+    }
+    while (flushedBatches_ < end) {
+        const QueueSyncSegment& seg = queueSync_.segments[flushSegment_];
+        if (!segmentStarted_) {
+            BeginSyncSegment_(seg);
+        }
+        const size_t stop = std::min<size_t>(end, seg.endBatch);
+        submitLists_.clear();
+        for (size_t bi = flushedBatches_; bi < stop; ++bi) {
+            CollectBatchLists_(submitTimeline_[bi], submitLists_);
+        }
+        if (!submitLists_.empty()) {
+            ID3D12CommandQueue* queue = seg.queue == kComputeSyncQueue ? computeQueue_.Get() : commandQueue_.Get();
+            queue->ExecuteCommandLists(static_cast<UINT>(submitLists_.size()), submitLists_.data());
+            ++executeCount_;
+        }
+        flushedBatches_ = stop;
+        if (stop == seg.endBatch) {
+            EndSyncSegment_(seg);
+        }
+    }
+}
+
+void Renderer::BeginSyncSegment_(const QueueSyncSegment& seg) {
+    ID3D12CommandQueue* queue = seg.queue == kComputeSyncQueue ? computeQueue_.Get() : commandQueue_.Get();
+    // Ресурсы, которые прошлый кадр читал на direct без смены состояния (барьера нет),
+    // compute не должен переписать раньше времени
+    if (seg.queue == kComputeSyncQueue && !computeStarted_) {
+        computeStarted_ = true;
+        if (lastFrameFenceValue_ != 0) {
+            ThrowIfFailed(queue->Wait(fence_.Get(), lastFrameFenceValue_));
+        }
+    }
+    for (uint32_t k = 0; k < seg.waitCount; ++k) {
+        const QueueSyncWait& w = queueSync_.waits[seg.waitBegin + k];
+        ThrowIfFailed(queue->Wait(w.queue == kComputeSyncQueue ? computeFence_.Get() : fence_.Get(), w.value));
+    }
+    segmentStarted_ = true;
+}
+
+void Renderer::EndSyncSegment_(const QueueSyncSegment& seg) {
+    if (seg.signal) {
+        ID3D12CommandQueue* queue = seg.queue == kComputeSyncQueue ? computeQueue_.Get() : commandQueue_.Get();
+        ThrowIfFailed(queue->Signal(seg.queue == kComputeSyncQueue ? computeFence_.Get() : fence_.Get(), seg.value));
+    }
+    ++flushSegment_;
+    segmentStarted_ = false;
+}
+
+// CL'ки бакета в порядке исполнения: барьеры входа, driver с бандлами, готовые CL
+void Renderer::CollectBatchLists_(PassBatch_& pb, std::vector<ID3D12CommandList*>& lists) {
+    const bool compute = pb.type == D3D12_COMMAND_LIST_TYPE_COMPUTE;
+
+    // Барьеры входа в бакет — отдельным коротким CL перед всеми CL'ками бакета
+    // (driver к этому моменту уже записан, вставить в его начало нельзя)
+    if (!pb.barriers.empty() || !pb.discards.empty()) {
+        auto& fr = frameResources_[frameSlot_];
+        ID3D12CommandAllocator* alloc =
+            fr->AcquireCommandAllocator(device_.Get(), pb.type);
+        ID3D12GraphicsCommandList* cl =
+            fr->AcquireCommandList(device_.Get(), pb.type, alloc);
+        if (!pb.barriers.empty()) {
+            cl->ResourceBarrier(static_cast<UINT>(pb.barriers.size()), pb.barriers.data());
+        }
+        // Память после алиасинга не определена: RT/DS обязаны начать с Clear/Discard
+        for (ID3D12Resource* res : pb.discards) {
+            cl->DiscardResource(res, nullptr);
+        }
+        ThrowIfFailed(cl->Close());
+        lists.push_back(cl);
+    }
+
+    // Если есть driver (создан в пассе) — дописываем в него ExecuteBundle(...)
+    if (pb.driver != nullptr) {
+        for (auto* b : pb.bundles) {
+            if (b != nullptr) {
+                pb.driver->ExecuteBundle(b);
             }
-            else if (!pb.bundles.empty()) {
-                // fallback: нет driver’а — создадим временный
-                auto& fr = frameResources_[currentFrameIndex_];
-                ID3D12CommandAllocator* alloc =
-                    fr->AcquireCommandAllocator(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
-                ID3D12GraphicsCommandList* cl =
-                    fr->AcquireCommandList(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, alloc);
-                RecordBindDefaultsNoClear(cl);
-                for (auto* b : pb.bundles) {
-                    if (b != nullptr) {
-                        cl->ExecuteBundle(b);
-                    }
-                }
-                ThrowIfFailed(cl->Close());
-                lists.push_back(cl);
+        }
+        ThrowIfFailed(pb.driver->Close());
+        ResolveEntryStates_(pb.driverStates, pb.type, lists);
+        lists.push_back(pb.driver);
+    }
+    else if (!pb.bundles.empty() && !compute) {
+        // fallback: нет driver’а — создадим временный
+        auto& fr = frameResources_[frameSlot_];
+        ID3D12CommandAllocator* alloc =
+            fr->AcquireCommandAllocator(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+        ID3D12GraphicsCommandList* cl =
+            fr->AcquireCommandList(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, alloc);
+        RecordBindDefaultsNoClear(cl);
+        for (auto* b : pb.bundles) {
+            if (b != nullptr) {
+                cl->ExecuteBundle(b);
             }
+        }
+        ThrowIfFailed(cl->Close());
+        lists.push_back(cl);
+    }
 
-            // Также прикрепим любые готовые DIRECT-CL
-            if (!pb.directs.empty()) {
-                lists.insert(lists.end(), pb.directs.begin(), pb.directs.end());
+    // Также прикрепим любые готовые CL
+    for (size_t i = 0; i < pb.directs.size(); ++i) {
+        ResolveEntryStates_(pb.directStates[i], pb.type, lists);
+        lists.push_back(pb.directs[i]);
+    }
+}
+
+// Вход в CL: где ожидаемое на первом использовании состояние не совпало с текущим
+// глобальным — короткий CL с fix-up барьерами прямо перед ним. Зовётся в порядке сабмита,
+// так что глобальные состояния здесь — ровно те, в которых ресурсы придут к этому CL.
+// Для COMPUTE-CL переходы из/в графические состояния уходят на direct (SubmitComputeHandoff_).
+void Renderer::ResolveEntryStates_(const CommandListStates* states, D3D12_COMMAND_LIST_TYPE type,
+    std::vector<ID3D12CommandList*>& lists) {
+    if (states == nullptr || states->Entries().empty()) {
+        return;
+    }
+
+    const bool compute = type == D3D12_COMMAND_LIST_TYPE_COMPUTE;
+    fixupBarriers_.clear();
+    handoffBarriers_.clear();
+    {
+        std::lock_guard<std::mutex> lk(knownStatesMtx_);
+        for (const CommandListStates::Entry& e : states->Entries()) {
+            auto [it, inserted] = knownStates_.try_emplace(e.res, D3D12_RESOURCE_STATE_COMMON);
+            if (it->second != e.first) {
+                D3D12_RESOURCE_BARRIER b{};
+                b.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                b.Transition.pResource = e.res;
+                b.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                b.Transition.StateBefore = it->second;
+                b.Transition.StateAfter = e.first;
+                // Графическое состояние на compute-очереди не записать — переход уходит на direct
+                const bool graphics = compute && (!CommandListStates::IsComputeState(it->second) ||
+                                                  !CommandListStates::IsComputeState(e.first));
+                (graphics ? handoffBarriers_ : fixupBarriers_).push_back(b);
             }
+            it->second = e.last;
         }
-        submitTimeline_.clear();
     }
+    if (!handoffBarriers_.empty()) {
+        SubmitComputeHandoff_(lists);
+    }
+    if (fixupBarriers_.empty()) {
+        return;
+    }
+
+    auto& fr = frameResources_[frameSlot_];
+    ID3D12CommandAllocator* alloc = fr->AcquireCommandAllocator(device_.Get(), type);
+    ID3D12GraphicsCommandList* cl = fr->AcquireCommandList(device_.Get(), type, alloc);
+    cl->ResourceBarrier(static_cast<UINT>(fixupBarriers_.size()), fixupBarriers_.data());
+    ThrowIfFailed(cl->Close());
+    lists.push_back(cl);
+    stateFixupCount_ += fixupBarriers_.size();
+}
+
+// Как передача на графике у compute-пассов RenderGraph, но план фенсов кадра уже зафиксирован:
+// переходы handoffBarriers_ исполняются на direct прямо сейчас, на своём фенсе. Compute сперва
+// отдаёт накопленные CL'ки (ресурс мог быть у них), direct ждёт их, compute ждёт переходы.
+// Путь для ресурсов в обход графа — о нём сообщаем, в кадре графа его быть не должно
+void Renderer::SubmitComputeHandoff_(std::vector<ID3D12CommandList*>& lists) {
+    OutputDebugStringA("[Renderer] graphics-only resource state on a COMPUTE list, fix-up via direct\n");
+
+    if (!lists.empty()) {
+        computeQueue_->ExecuteCommandLists(static_cast<UINT>(lists.size()), lists.data());
+        lists.clear();
+        ++executeCount_;
+    }
+    const UINT64 computeDone = nextHandoffFenceValue_++;
+    ThrowIfFailed(computeQueue_->Signal(handoffFence_.Get(), computeDone));
+    ThrowIfFailed(commandQueue_->Wait(handoffFence_.Get(), computeDone));
+
+    auto& fr = frameResources_[frameSlot_];
+    ID3D12CommandAllocator* alloc = fr->AcquireCommandAllocator(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+    ID3D12GraphicsCommandList* cl = fr->AcquireCommandList(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, alloc);
+    cl->ResourceBarrier(static_cast<UINT>(handoffBarriers_.size()), handoffBarriers_.data());
+    ThrowIfFailed(cl->Close());
+    ID3D12CommandList* handoff[] = { cl };
+    commandQueue_->ExecuteCommandLists(1, handoff);
+    ++executeCount_;
+
+    const UINT64 directDone = nextHandoffFenceValue_++;
+    ThrowIfFailed(commandQueue_->Signal(handoffFence_.Get(), directDone));
+    ThrowIfFailed(computeQueue_->Wait(handoffFence_.Get(), directDone));
+    stateFixupCount_ += handoffBarriers_.size();
+}
 
+void Renderer::ExecuteTimelineAndPresent() {
     // Эпилог: RT→Present
     ID3D12GraphicsCommandList* epilogueCL = nullptr;
     {
-        auto& fr = frameResources_[currentFrameIndex_];
+        auto& fr = frameResources_[frameSlot_];
         ID3D12CommandAllocator* alloc =
             fr->AcquireCommandAllocator(device_.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
         ID3D12GraphicsCommandList* cl =
@@ -521,7 +870,7 @@ void Renderer::ExecuteTimelineAndPresent() {
 
         D3D12_RESOURCE_BARRIER b{};
         b.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        b.Transition.pResource = renderTargets_[currentFrameIndex_].Get();
+        b.Transition.pResource = renderTargets_[backBufferIndex_].Get();
         b.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
         b.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
         b.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
@@ -530,17 +879,39 @@ void Renderer::ExecuteTimelineAndPresent() {
         ThrowIfFailed(cl->Close());
         epilogueCL = cl;
     }
-    if (epilogueCL != nullptr) {
-        lists.push_back(epilogueCL);
-    }
 
-    if (!lists.empty()) {
-        commandQueue_->ExecuteCommandLists((UINT)lists.size(), lists.data());
+    {
+        std::lock_guard<std::mutex> lk(submitMtx_);
+        // Бакеты, которые никто не закрыл (не из графа), уходят сейчас, по порядку
+        for (size_t bi = 0; bi < submitBatchCount_; ++bi) {
+            submitTimeline_[bi].closed = true;
+        }
+        FlushClosedBatches_();
+
+        // Хвост плана — схождение очередей на direct (Wait'ы без CL'ок); эпилог после него
+        while (flushSegment_ < queueSync_.segments.size()) {
+            const QueueSyncSegment& seg = queueSync_.segments[flushSegment_];
+            if (!segmentStarted_) {
+                BeginSyncSegment_(seg);
+            }
+            EndSyncSegment_(seg);
+        }
+        ID3D12CommandList* lists[] = { epilogueCL };
+        commandQueue_->ExecuteCommandLists(1, lists);
+
+        lastFrameExecuteCount_ = executeCount_;
+        executeCount_ = 0;
+        lastFrameStateFixupCount_ = stateFixupCount_;
+        stateFixupCount_ = 0;
+        lastFrameBindStats_ = { bindIssued_.exchange(0, std::memory_order_relaxed),
+                                bindSkipped_.exchange(0, std::memory_order_relaxed) };
+        ResetSubmitTimeline_();
     }
 
     ThrowIfFailed(swapChain_->Present(1, 0));
-    SignalFrame(currentFrameIndex_);
-    currentFrameIndex_ = swapChain_->GetCurrentBackBufferIndex();
+    SignalFrame(frameSlot_);
+    frameSlot_ = (frameSlot_ + 1) % framesInFlight_;
+    backBufferIndex_ = swapChain_->GetCurrentBackBufferIndex();
 }
 
 void Renderer::WaitForPreviousFrame() {
@@ -565,7 +936,7 @@ void Renderer::OnResize(UINT width, UINT height) {
     WaitForPreviousFrame();
 
     // Освобождаем старые RTV/DSV
-    for (UINT i = 0; i < kFrameCount; ++i) {
+    for (UINT i = 0; i < kMaxFramesInFlight; ++i) {
         renderTargets_[i].Reset();
     }
     depthBuffer_.Reset();
@@ -575,7 +946,7 @@ void Renderer::OnResize(UINT width, UINT height) {
     // ResizeBuffers
     DXGI_SWAP_CHAIN_DESC desc{};
     ThrowIfFailed(swapChain_->GetDesc(&desc));
-    ThrowIfFailed(swapChain_->ResizeBuffers(kFrameCount, width_, height_, desc.BufferDesc.Format, desc.Flags));
+    ThrowIfFailed(swapChain_->ResizeBuffers(BackBufferCount_(), width_, height_, desc.BufferDesc.Format, desc.Flags));
 
     // Пересоздать RTV и DSV
     CreateSwapChainAndRTVs(width_, height_);
@@ -591,29 +962,38 @@ void Renderer::SetResourceState(ID3D12Resource* res, D3D12_RESOURCE_STATES state
     knownStates_[res] = state;
 }
 
-void Renderer::Transition(ID3D12GraphicsCommandList* cl, ID3D12Resource* res, D3D12_RESOURCE_STATES after) {
-    if (cl == nullptr || res == nullptr) {
-        return;
+void Renderer::GetResourceStates(std::span<ID3D12Resource* const> res, std::span<D3D12_RESOURCE_STATES> out) {
+    std::lock_guard<std::mutex> lk(knownStatesMtx_);
+    for (size_t i = 0; i < res.size() && i < out.size(); ++i) {
+        auto it = knownStates_.find(res[i]);
+        out[i] = (it == knownStates_.end()) ? D3D12_RESOURCE_STATE_COMMON : it->second;
     }
+}
 
-    D3D12_RESOURCE_STATES before = D3D12_RESOURCE_STATE_COMMON;
-    {
-        std::lock_guard<std::mutex> lk(knownStatesMtx_);
-        auto it = knownStates_.find(res);
-        before = (it == knownStates_.end()) ? D3D12_RESOURCE_STATE_COMMON : it->second;
-        if (before == after) {
-            return;
+void Renderer::SetResourceStates(std::span<ID3D12Resource* const> res, std::span<const D3D12_RESOURCE_STATES> states) {
+    std::lock_guard<std::mutex> lk(knownStatesMtx_);
+    for (size_t i = 0; i < res.size() && i < states.size(); ++i) {
+        if (res[i] != nullptr) {
+            knownStates_[res[i]] = states[i];
         }
-        knownStates_[res] = after;
+    }
+}
+
+void Renderer::Transition(ThreadCL& t, ID3D12Resource* res, D3D12_RESOURCE_STATES after) {
+    if (t.cl == nullptr || res == nullptr) {
+        return;
+    }
+    assert(t.type != D3D12_COMMAND_LIST_TYPE_BUNDLE && "Transition in a bundle");
+    assert((t.type != D3D12_COMMAND_LIST_TYPE_COMPUTE || CommandListStates::IsComputeState(after)) &&
+        "graphics-only state on a COMPUTE list");
+    if (t.states == nullptr) {
+        t.states = frameResources_[frameSlot_]->AcquireCommandListStates();
     }
 
     D3D12_RESOURCE_BARRIER b{};
-    b.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    b.Transition.pResource = res;
-    b.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    b.Transition.StateBefore = before;
-    b.Transition.StateAfter = after;
-    cl->ResourceBarrier(1, &b);
+    if (t.states->Transition(res, after, b)) {
+        t.cl->ResourceBarrier(1, &b);
+    }
 }
 
 void Renderer::UAVBarrier(ID3D12GraphicsCommandList* cl, ID3D12Resource* res) {
@@ -630,7 +1010,7 @@ void Renderer::RecordBindAndClear(ID3D12GraphicsCommandList* cl) {
     // Barrier: Present -> RenderTarget (для текущего backbuffer)
     D3D12_RESOURCE_BARRIER b{};
     b.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    b.Transition.pResource = renderTargets_[currentFrameIndex_].Get();
+    b.Transition.pResource = renderTargets_[backBufferIndex_].Get();
     b.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
     b.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
     b.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
@@ -638,7 +1018,7 @@ void Renderer::RecordBindAndClear(ID3D12GraphicsCommandList* cl) {
 
     // RTV/DSV
     D3D12_CPU_DESCRIPTOR_HANDLE rtv = rtvHeap_->GetCPUDescriptorHandleForHeapStart();
-    rtv.ptr += SIZE_T(currentFrameIndex_) * rtvDescriptorSize_;
+    rtv.ptr += SIZE_T(backBufferIndex_) * rtvDescriptorSize_;
     D3D12_CPU_DESCRIPTOR_HANDLE dsv = dsvHeap_->GetCPUDescriptorHandleForHeapStart();
     cl->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
 
@@ -662,7 +1042,7 @@ void Renderer::RecordBindAndClear(ID3D12GraphicsCommandList* cl) {
 void Renderer::RecordBindDefaultsNoClear(ID3D12GraphicsCommandList* cl) {
     // Только bind RTV/DSV + viewport/scissor (без барьера и клира)
     D3D12_CPU_DESCRIPTOR_HANDLE rtv = rtvHeap_->GetCPUDescriptorHandleForHeapStart();
-    rtv.ptr += SIZE_T(currentFrameIndex_) * rtvDescriptorSize_;
+    rtv.ptr += SIZE_T(backBufferIndex_) * rtvDescriptorSize_;
     D3D12_CPU_DESCRIPTOR_HANDLE dsv = dsvHeap_->GetCPUDescriptorHandleForHeapStart();
     cl->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
 
@@ -719,61 +1099,134 @@ void Renderer::CreateDeferredTargets(UINT width, UINT height)
     {
         D3D12_DESCRIPTOR_HEAP_DESC desc{};
         desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-        desc.NumDescriptors = kFrameCount * kDeferredRtvPerFrame;  // GB0,GB1,GB2, Light, Scene, SSR, SSRBlur
+        desc.NumDescriptors = kMaxFramesInFlight * kDeferredRtvPerFrame;  // GB0,GB1,GB2, Light, Scene, SSR, SSRBlur
         ThrowIfFailed(dev->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&deferredRtvHeap_)));
     }
     {
         D3D12_DESCRIPTOR_HEAP_DESC desc{};
         desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-        desc.NumDescriptors = kFrameCount * kDeferredDsvPerFrame;  // Depth
+        desc.NumDescriptors = kMaxFramesInFlight * kDeferredDsvPerFrame;  // Depth
         ThrowIfFailed(dev->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&deferredDsvHeap_)));
     }
     {
         D3D12_DESCRIPTOR_HEAP_DESC desc{};
         desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        desc.NumDescriptors = kFrameCount * kDeferredSrvPerFrame;  // GB0,GB1,GB2,Depth,Light,Scene,SSR,SSRBlur
+        desc.NumDescriptors = kMaxFramesInFlight * kDeferredSrvPerFrame + kNullSrvCount;  // GB0,GB1,GB2,Depth,Light,Scene,SSR,SSRBlur + null
         desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE; // CPU-only staging
         ThrowIfFailed(dev->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&deferredSrvCpuHeap_)));
-    }
 
-    // --- общие параметры размещения (Default heap) ---
-    D3D12_HEAP_PROPERTIES heapProps{};
-    heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-    heapProps.CreationNodeMask = 1;
-    heapProps.VisibleNodeMask = 1;
+        // null-дескрипторы: ресурс nullptr + явная размерность
+        D3D12_SHADER_RESOURCE_VIEW_DESC nd{};
+        nd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        nd.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        nd.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        nd.Texture2D.MipLevels = 1;
+        dev->CreateShaderResourceView(nullptr, &nd, GetNullSrv2D());
+        nd.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+        nd.TextureCube.MipLevels = 1;
+        dev->CreateShaderResourceView(nullptr, &nd, GetNullSrvCube());
+    }
 
-    auto MakeTex2DDesc = [&](DXGI_FORMAT fmt, D3D12_RESOURCE_FLAGS flags) {
-        D3D12_RESOURCE_DESC rd{};
+    // --- раскладка: все цели кадра в одной placed-куче, смещения — по временам жизни от графа ---
+    const DXGI_FORMAT slotFormats[kDeferredSrvPerFrame] = {
+        DXGI_FORMAT_R8G8B8A8_UNORM,     // GB0
+        DXGI_FORMAT_R10G10B10A2_UNORM,  // GB1
+        DXGI_FORMAT_R11G11B10_FLOAT,    // GB2
+        DXGI_FORMAT_D32_FLOAT,          // Depth
+        DXGI_FORMAT_R16G16B16A16_FLOAT, // Light
+        DXGI_FORMAT_R16G16B16A16_FLOAT, // Scene
+        DXGI_FORMAT_R8G8B8A8_UNORM,     // SSR
+        DXGI_FORMAT_R8G8B8A8_UNORM,     // SSRBlur
+    };
+    deferredHeapAlignment_ = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    for (UINT s = 0; s < kDeferredSrvPerFrame; ++s) {
+        D3D12_RESOURCE_DESC& rd = deferredDescs_[s];
+        rd = {};
         rd.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
         rd.Width = width ? width : 1;
         rd.Height = height ? height : 1;
         rd.DepthOrArraySize = 1;
         rd.MipLevels = 1;
-        rd.Format = fmt;
+        rd.Format = slotFormats[s];
         rd.SampleDesc.Count = 1;
         rd.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-        rd.Flags = flags;
-        return rd;
-        };
+        rd.Flags = s == static_cast<UINT>(DeferredSrvSlot::Depth)
+            ? D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL : D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+        const D3D12_RESOURCE_ALLOCATION_INFO info = dev->GetResourceAllocationInfo(0, 1, &rd);
+        transientLifetimes_[s].size = info.SizeInBytes;
+        transientLifetimes_[s].alignment = info.Alignment;
+        deferredHeapAlignment_ = std::max<uint64_t>(deferredHeapAlignment_, info.Alignment);
+    }
+    ++transientLayoutGen_; // размеры поменялись — раскладку пересчитать
+
+    for (UINT f = 0; f < framesInFlight_; ++f) {
+        PlaceDeferredTargets_(f);
+    }
+}
+
+// Раскладка по текущим временам жизни; считается один раз на их смену, не на каждый слот
+const TransientLayout& Renderer::GetTransientLayout_() {
+    if (transientLayoutSolvedGen_ != transientLayoutGen_) {
+        transientLayout_ = SolveTransientAliasing(transientLifetimes_);
+        transientStats_ = { transientLayout_.heapSize, transientLayout_.naiveSize };
+        transientLayoutSolvedGen_ = transientLayoutGen_;
+    }
+    return transientLayout_;
+}
+
+// Цели кадра f по текущей раскладке. GPU с ними должен быть закончен (ресайз — после полного
+// ожидания, смена времён жизни — в BeginFrame после WaitForFrame(f)). Куча слота переживает
+// перекладку, если новая раскладка в неё влезает: пересоздаются только placed-ресурсы и дескрипторы
+void Renderer::PlaceDeferredTargets_(UINT f)
+{
+    ID3D12Device* dev = device_.Get();
+    const TransientLayout& layout = GetTransientLayout_();
+    auto& D = deferred_[f];
+
+    {
+        std::lock_guard<std::mutex> lk(knownStatesMtx_);
+        for (ComPtr<ID3D12Resource>* r : { &D.gb0, &D.gb1, &D.gb2, &D.depth, &D.light, &D.scene, &D.ssr, &D.ssrBlur }) {
+            knownStates_.erase(r->Get());
+            r->Reset();
+        }
+    }
+    transientPlacements_[f].clear();
+
+    const uint64_t heapBytes =
+        (layout.heapSize + deferredHeapAlignment_ - 1) / deferredHeapAlignment_ * deferredHeapAlignment_;
+    if (!deferredHeap_[f] || deferredHeapBytes_[f] < heapBytes) {
+        D3D12_HEAP_DESC hd{};
+        hd.SizeInBytes = heapBytes;
+        hd.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        hd.Properties.CreationNodeMask = 1;
+        hd.Properties.VisibleNodeMask = 1;
+        hd.Alignment = deferredHeapAlignment_;
+        hd.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        deferredHeap_[f].Reset();
+        ThrowIfFailed(dev->CreateHeap(&hd, IID_PPV_ARGS(&deferredHeap_[f])));
+        deferredHeapBytes_[f] = heapBytes;
+    }
 
     // ---- универсальные фабрики ----
-    auto CreateRT = [&](DXGI_FORMAT fmt,
-        DeferredRtvSlot rtvSlot,
+    auto CreateRT = [&](DeferredRtvSlot rtvSlot,
         DeferredSrvSlot srvSlot,
-        UINT f,
         ComPtr<ID3D12Resource>& outRes,
         D3D12_CPU_DESCRIPTOR_HANDLE& outRTV,
         D3D12_CPU_DESCRIPTOR_HANDLE& outSRV,
         float4 clear = float4(0, 0, 0, 0))
         {
-            D3D12_RESOURCE_DESC rd = MakeTex2DDesc(fmt, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+            const UINT slot = static_cast<UINT>(srvSlot);
+            const D3D12_RESOURCE_DESC& rd = deferredDescs_[slot];
+            const DXGI_FORMAT fmt = rd.Format;
 
             D3D12_CLEAR_VALUE cv{}; cv.Format = fmt;
             cv.Color[0] = clear.x; cv.Color[1] = clear.y; cv.Color[2] = clear.z; cv.Color[3] = clear.w;
 
-            ThrowIfFailed(dev->CreateCommittedResource(
-                &heapProps, D3D12_HEAP_FLAG_NONE, &rd,
+            ThrowIfFailed(dev->CreatePlacedResource(
+                deferredHeap_[f].Get(), layout.offsets[slot], &rd,
                 D3D12_RESOURCE_STATE_RENDER_TARGET, &cv, IID_PPV_ARGS(&outRes)));
+            transientPlacements_[f].push_back({ outRes.Get(), layout.offsets[slot], transientLifetimes_[slot].size });
 
             // RTV/SRV — ТОЛЬКО для кадра f
             outRTV = DeferredRtvCPU(f, rtvSlot);
@@ -788,47 +1241,22 @@ void Renderer::CreateDeferredTargets(UINT width, UINT height)
             outSRV = DeferredSrvCPU(f, srvSlot);
             dev->CreateShaderResourceView(outRes.Get(), &sd, outSRV);
 
-            // сохранить хэндлы в deferred_[f]
-            auto& D = deferred_[f];
-            switch (rtvSlot) {
-            case DeferredRtvSlot::GB0:   D.gbRTV[0] = outRTV; break;
-            case DeferredRtvSlot::GB1:   D.gbRTV[1] = outRTV; break;
-            case DeferredRtvSlot::GB2:   D.gbRTV[2] = outRTV; break;
-            case DeferredRtvSlot::Light: D.lightRTV = outRTV; break;
-            case DeferredRtvSlot::Scene: D.sceneRTV = outRTV; break;
-            case DeferredRtvSlot::SSR:   D.ssrRTV = outRTV; break;
-            case DeferredRtvSlot::SSRBlur: D.ssrBlurRTV = outRTV; break;
-            default: break;
-            }
-            switch (srvSlot) {
-            case DeferredSrvSlot::GB0:    D.gbSRV[0] = outSRV; break;
-            case DeferredSrvSlot::GB1:    D.gbSRV[1] = outSRV; break;
-            case DeferredSrvSlot::GB2:    D.gbSRV[2] = outSRV; break;
-            case DeferredSrvSlot::Depth:  D.gbSRV[3] = outSRV; break;
-            case DeferredSrvSlot::Light:  D.lightSRV = outSRV; break;
-            case DeferredSrvSlot::Scene:  D.sceneSRV = outSRV; break;
-            case DeferredSrvSlot::SSR:    D.ssrSRV = outSRV; break;
-            case DeferredSrvSlot::SSRBlur:D.ssrBlurSRV = outSRV; break;
-            default: break;
-            }
-
             SetResourceState(outRes.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
         };
 
-    auto CreateDepth = [&](DXGI_FORMAT dsvFmt,
-        UINT f,
-        ComPtr<ID3D12Resource>& outRes,
+    auto CreateDepth = [&](ComPtr<ID3D12Resource>& outRes,
         D3D12_CPU_DESCRIPTOR_HANDLE& outDSV,
         D3D12_CPU_DESCRIPTOR_HANDLE& outDepthSRV)
         {
-            D3D12_RESOURCE_DESC rd = MakeTex2DDesc(dsvFmt, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+            const UINT slot = static_cast<UINT>(DeferredSrvSlot::Depth);
+            const D3D12_RESOURCE_DESC& rd = deferredDescs_[slot];
+            const DXGI_FORMAT dsvFmt = rd.Format;
 
             D3D12_CLEAR_VALUE cv{}; cv.Format = dsvFmt; cv.DepthStencil.Depth = 1.0f; cv.DepthStencil.Stencil = 0;
-            ThrowIfFailed(dev->CreateCommittedResource(
-                &heapProps, D3D12_HEAP_FLAG_NONE, &rd,
+            ThrowIfFailed(dev->CreatePlacedResource(
+                deferredHeap_[f].Get(), layout.offsets[slot], &rd,
                 D3D12_RESOURCE_STATE_DEPTH_WRITE, &cv, IID_PPV_ARGS(&outRes)));
-
-            auto& D = deferred_[f];
+            transientPlacements_[f].push_back({ outRes.Get(), layout.offsets[slot], transientLifetimes_[slot].size });
 
             // DSV
             outDSV = DeferredDsvCPU(f, DeferredDsvSlot::Depth);
@@ -836,7 +1264,6 @@ void Renderer::CreateDeferredTargets(UINT width, UINT height)
             dv.Format = dsvFmt;
             dv.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
             dev->CreateDepthStencilView(outRes.Get(), &dv, outDSV);
-            D.dsv = outDSV;
 
             // SRV к depth как R32_FLOAT
             D3D12_SHADER_RESOURCE_VIEW_DESC sd{};
@@ -846,50 +1273,44 @@ void Renderer::CreateDeferredTargets(UINT width, UINT height)
             sd.Texture2D.MipLevels = 1;
             outDepthSRV = DeferredSrvCPU(f, DeferredSrvSlot::Depth);
             dev->CreateShaderResourceView(outRes.Get(), &sd, outDepthSRV);
-            D.gbSRV[3] = outDepthSRV;
 
             SetResourceState(outRes.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
         };
 
-    for (UINT f = 0; f < kFrameCount; ++f)
-    {
-        auto& D = deferred_[f];
+    CreateRT(DeferredRtvSlot::GB0, DeferredSrvSlot::GB0, D.gb0, D.gbRTV[0], D.gbSRV[0]);
+    CreateRT(DeferredRtvSlot::GB1, DeferredSrvSlot::GB1, D.gb1, D.gbRTV[1], D.gbSRV[1]);
+    CreateRT(DeferredRtvSlot::GB2, DeferredSrvSlot::GB2, D.gb2, D.gbRTV[2], D.gbSRV[2]);
 
-        CreateRT(DXGI_FORMAT_R8G8B8A8_UNORM, DeferredRtvSlot::GB0, DeferredSrvSlot::GB0, f, D.gb0, D.gbRTV[0], D.gbSRV[0]);
-        CreateRT(DXGI_FORMAT_R10G10B10A2_UNORM, DeferredRtvSlot::GB1, DeferredSrvSlot::GB1, f, D.gb1, D.gbRTV[1], D.gbSRV[1]);
-        CreateRT(DXGI_FORMAT_R11G11B10_FLOAT, DeferredRtvSlot::GB2, DeferredSrvSlot::GB2, f, D.gb2, D.gbRTV[2], D.gbSRV[2]);
+    CreateDepth(D.depth, D.dsv, /*outDepthSRV*/ D.gbSRV[3]);
 
-        CreateDepth(DXGI_FORMAT_D32_FLOAT, f, D.depth, D.dsv, /*outDepthSRV*/ D.gbSRV[3]);
+    CreateRT(DeferredRtvSlot::Light, DeferredSrvSlot::Light, D.light, D.lightRTV, D.lightSRV);
+    CreateRT(DeferredRtvSlot::Scene, DeferredSrvSlot::Scene, D.scene, D.sceneRTV, D.sceneSRV);
+    CreateRT(DeferredRtvSlot::SSR, DeferredSrvSlot::SSR, D.ssr, D.ssrRTV, D.ssrSRV);
+    CreateRT(DeferredRtvSlot::SSRBlur, DeferredSrvSlot::SSRBlur, D.ssrBlur, D.ssrBlurRTV, D.ssrBlurSRV);
 
-        CreateRT(DXGI_FORMAT_R16G16B16A16_FLOAT, DeferredRtvSlot::Light, DeferredSrvSlot::Light, f, D.light, D.lightRTV, D.lightSRV);
-        CreateRT(DXGI_FORMAT_R16G16B16A16_FLOAT, DeferredRtvSlot::Scene, DeferredSrvSlot::Scene, f, D.scene, D.sceneRTV, D.sceneSRV);
-        CreateRT(DXGI_FORMAT_R8G8B8A8_UNORM, DeferredRtvSlot::SSR, DeferredSrvSlot::SSR, f, D.ssr, D.ssrRTV, D.ssrSRV);
-        CreateRT(DXGI_FORMAT_R8G8B8A8_UNORM, DeferredRtvSlot::SSRBlur, DeferredSrvSlot::SSRBlur, f, D.ssrBlur, D.ssrBlurRTV, D.ssrBlurSRV);
-    }
+    deferredLayoutGen_[f] = transientLayoutGen_;
 }
 
 void Renderer::DestroyDeferredTargets() {
     deferredRtvHeap_.Reset(); deferredDsvHeap_.Reset(); deferredSrvCpuHeap_.Reset();
-    for (UINT f = 0; f < kFrameCount; ++f) {
-        auto& D = deferred_[f];
-        D.gb0.Reset();
-        D.gb1.Reset();
-        D.gb2.Reset();
-        D.depth.Reset();
-        D.light.Reset();
-        D.scene.Reset();
-        D.ssr.Reset();
-        D.ssrBlur.Reset();
-    }
 
-    {
-        std::lock_guard<std::mutex> lk(knownStatesMtx_);
-        knownStates_.clear();
+    // Забываем состояния только своих целей: раскладка пересоздаётся и без ресайза,
+    // а состояния текстур/инстанс-буферов должны пережить это
+    std::lock_guard<std::mutex> lk(knownStatesMtx_);
+    for (UINT f = 0; f < kMaxFramesInFlight; ++f) {
+        auto& D = deferred_[f];
+        for (ComPtr<ID3D12Resource>* r : { &D.gb0, &D.gb1, &D.gb2, &D.depth, &D.light, &D.scene, &D.ssr, &D.ssrBlur }) {
+            knownStates_.erase(r->Get());
+            r->Reset();
+        }
+        transientPlacements_[f].clear();
+        deferredHeap_[f].Reset();
+        deferredHeapBytes_[f] = 0;
     }
 }
 
 void Renderer::BindGBuffer(ID3D12GraphicsCommandList* cl, ClearMode mode) {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     D3D12_CPU_DESCRIPTOR_HANDLE rtvs[3] = { D.gbRTV[0], D.gbRTV[1], D.gbRTV[2] };
     cl->OMSetRenderTargets(3, rtvs, FALSE, &D.dsv);
 
@@ -908,7 +1329,7 @@ void Renderer::BindGBuffer(ID3D12GraphicsCommandList* cl, ClearMode mode) {
 }
 
 void Renderer::BindLightTarget(ID3D12GraphicsCommandList* cl, ClearMode mode, bool withDepth) {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     cl->OMSetRenderTargets(1, &D.lightRTV, FALSE, withDepth ? &D.dsv : nullptr);
     D3D12_VIEWPORT vp{ 0,0,float(width_),float(height_),0,1 };
     D3D12_RECT     sr{ 0,0,(LONG)width_,(LONG)height_ };
@@ -920,7 +1341,7 @@ void Renderer::BindLightTarget(ID3D12GraphicsCommandList* cl, ClearMode mode, bo
 }
 
 void Renderer::BindSceneColor(ID3D12GraphicsCommandList* cl, ClearMode mode, bool withDepth) {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     cl->OMSetRenderTargets(1, &D.sceneRTV, FALSE, withDepth ? &D.dsv : nullptr);
     D3D12_VIEWPORT vp{ 0,0,float(width_),float(height_),0,1 };
     D3D12_RECT     sr{ 0,0,(LONG)width_,(LONG)height_ };
@@ -932,7 +1353,7 @@ void Renderer::BindSceneColor(ID3D12GraphicsCommandList* cl, ClearMode mode, boo
 }
 
 void Renderer::BindSSRTarget(ID3D12GraphicsCommandList* cl, ClearMode mode) {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     cl->OMSetRenderTargets(1, &D.ssrRTV, FALSE, nullptr);
     D3D12_VIEWPORT vp{ 0,0,float(width_),float(height_),0,1 };
     D3D12_RECT     sr{ 0,0,(LONG)width_,(LONG)height_ };
@@ -943,7 +1364,7 @@ void Renderer::BindSSRTarget(ID3D12GraphicsCommandList* cl, ClearMode mode) {
     }
 }
 void Renderer::BindSSRBlurTarget(ID3D12GraphicsCommandList* cl, ClearMode mode) {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     cl->OMSetRenderTargets(1, &D.ssrBlurRTV, FALSE, nullptr);
     D3D12_VIEWPORT vp{ 0,0,float(width_),float(height_),0,1 };
     D3D12_RECT     sr{ 0,0,(LONG)width_,(LONG)height_ };
@@ -955,17 +1376,17 @@ void Renderer::BindSSRBlurTarget(ID3D12GraphicsCommandList* cl, ClearMode mode)
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE Renderer::StageGBufferSrvTable() {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     auto tbl = StageSrvUavTable({ D.gbSRV[0], D.gbSRV[1], D.gbSRV[2], D.gbSRV[3] });
     return tbl.gpu; // ключ t0 в шейдере
 }
 D3D12_GPU_DESCRIPTOR_HANDLE Renderer::StageComposeSrvTable() {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     auto tbl = StageSrvUavTable({ D.lightSRV, D.gbSRV[2] }); // Light, Emissive
     return tbl.gpu;
 }
 D3D12_GPU_DESCRIPTOR_HANDLE Renderer::StageTonemapSrvTable() {
-    auto& D = deferred_[currentFrameIndex_];
+    auto& D = deferred_[frameSlot_];
     auto tbl = StageSrvUavTable({ D.sceneSRV });
     return tbl.gpu;
 }
\ No newline at end of file
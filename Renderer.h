@@ -6,6 +6,9 @@
 #include "DescriptorAllocator.h"
 #include "FrameResource.h"
 #include <unordered_map>
+#include <span>
+#include <string_view>
+#include <atomic>
 #include "Samplermanager.h"
 #include "CBManager.h"
 #include "Material.h"
@@ -14,6 +17,10 @@
 #include "TextManager.h"
 #include "FontManager.h"
 #include "MaterialDataManager.h"
+#include "GpuFence.h"
+#include "TransientAliasing.h"
+#include "QueueSync.h"
+#include "CommandListStates.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -23,6 +30,7 @@ public:
         ID3D12CommandAllocator* alloc = nullptr;
         ID3D12GraphicsCommandList* cl = nullptr;
         D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+        CommandListStates* states = nullptr; // заводит первый Transition; у бандлов нет (барьеры в них запрещены)
     };
     enum class ClearMode { None, Color, ColorDepth };
     struct DeferredTargets {
@@ -80,7 +88,19 @@ public:
     DXGI_FORMAT GetSceneColorFormat() const { return DXGI_FORMAT_R16G16B16A16_FLOAT; }
     DXGI_FORMAT GetBackbufferFormat() const { return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; }
 
-    const DeferredTargets& GetDeferredForFrame() const { return deferred_[currentFrameIndex_]; }
+    const DeferredTargets& GetDeferredForFrame() const { return deferred_[frameSlot_]; }
+
+    // Null-SRV (читаются нулями): заглушка слота, чей источник в этом кадре не рисовался
+    D3D12_CPU_DESCRIPTOR_HANDLE GetNullSrv2D() const { return DeferredSrvAt(kMaxFramesInFlight * kDeferredSrvPerFrame + 0); }
+    D3D12_CPU_DESCRIPTOR_HANDLE GetNullSrvCube() const { return DeferredSrvAt(kMaxFramesInFlight * kDeferredSrvPerFrame + 1); }
+
+    // Кадров в полёте (1..kMaxFramesInFlight): больше — CPU дальше убегает вперёд GPU
+    // (пропускная способность), меньше — короче задержка ввода. До InitD3D12 только
+    // запоминается; после — полная синхронизация с GPU и пересоздание кольца кадров,
+    // свапа и deferred-целей (как ресайз), звать между кадрами.
+    static constexpr UINT kMaxFramesInFlight = 4;
+    void SetFramesInFlight(UINT count);
+    UINT GetFramesInFlight() const { return framesInFlight_; }
 
     // Сервис
     void WaitForPreviousFrame();       // полная синхронизация (используется при ресайзе/деструкторе)
@@ -92,25 +112,85 @@ public:
     void EndThreadCommandBundle(ThreadCL& b, size_t batchIndex);
 
     void BeginSubmitTimeline();
-    size_t BeginSubmitBatch(const std::string& passName);
+    // Бакет на DIRECT- или COMPUTE-очереди; CL'ки в нём — того же типа
+    size_t BeginSubmitBatch(std::string_view passName, D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+    // Бакет стартует на GPU после producerBatch с другой очереди: Wait/Signal по фенсам очередей
+    // расставит ExecuteTimelineAndPresent (QueueSyncPlan)
+    void AddBatchWait(size_t batchIndex, size_t producerBatch);
+    // Все CL бакета сданы. Закрытый подряд от начала кадра префикс сразу уходит на очереди —
+    // GPU начинает, пока CPU пишет хвост кадра. Первое закрытие фиксирует план фенсов:
+    // бакеты и AddBatchWait кадра должны быть объявлены до него. Незакрытые закроет
+    // ExecuteTimelineAndPresent.
+    void CloseSubmitBatch(size_t batchIndex);
     void ExecuteTimelineAndPresent();
+    // Вызовов ExecuteCommandLists за прошлый кадр (без эпилога)
+    size_t GetSubmitCountLastFrame() const { return lastFrameExecuteCount_; }
+    // Fix-up барьеров на входах CL (Transition) за прошлый кадр
+    size_t GetStateFixupCountLastFrame() const { return lastFrameStateFixupCount_; }
+    // Set* при записи (BindStateCache и одиночные Material::Bind): ушло в CL / отсечено как повтор
+    struct BindStats {
+        uint64_t issued = 0;
+        uint64_t skipped = 0;
+    };
+    void AddBindStats(uint64_t issued, uint64_t skipped) {
+        bindIssued_.fetch_add(issued, std::memory_order_relaxed);
+        bindSkipped_.fetch_add(skipped, std::memory_order_relaxed);
+    }
+    BindStats GetBindStatsLastFrame() const { return lastFrameBindStats_; }
     void RecordBindAndClear(ID3D12GraphicsCommandList* cl);
     void RecordBindDefaultsNoClear(ID3D12GraphicsCommandList* cl);
-    void RegisterPassDriver(ID3D12GraphicsCommandList* cl, size_t batchIndex);
+    void RegisterPassDriver(const ThreadCL& driver, size_t batchIndex);
+    // Барьеры на вход в бакет (посчитаны графом): пишутся одним ResourceBarrier перед его CL'ками,
+    // следом DiscardResource для транзиентов, которые в этом бакете занимают общую память
+    void SetBatchBarriers(size_t batchIndex, std::span<const D3D12_RESOURCE_BARRIER> barriers,
+        std::span<ID3D12Resource* const> discards = {});
+
+    // Транзиентные цели (deferred_) лежат в одной placed-куче на кадр; смещения считает
+    // SolveTransientAliasing по временам жизни, которые сообщает RenderGraph.
+    struct TransientPlacement {
+        ID3D12Resource* res = nullptr;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+    struct TransientMemoryStats {
+        uint64_t heapBytes = 0;   // на один кадр
+        uint64_t naiveBytes = 0;  // столько же целей без алиасинга
+    };
+    // Позиции первого/последнего использования в порядке сабмита; изменилось — цели каждого
+    // слота перекладываются в его следующем BeginFrame (без полного ожидания GPU). Только с потока рендера.
+    void SetTransientLifetimes(std::span<ID3D12Resource* const> res,
+        std::span<const uint32_t> firstUse, std::span<const uint32_t> lastUse);
+    std::span<const TransientPlacement> GetTransientPlacements() const { return transientPlacements_[frameSlot_]; }
+    TransientMemoryStats GetTransientMemoryStats() const { return transientStats_; }
+
+    // Асинхронный аплоад для корутин-загрузчиков: свой allocator+CL, staging-буферы живут в батче,
+    // пока корутина не дождётся фенса (co_await SubmitUpload(batch)). Можно с любого потока.
+    struct UploadBatch {
+        ComPtr<ID3D12CommandAllocator>      alloc;
+        ComPtr<ID3D12GraphicsCommandList>   cl;
+        std::vector<ComPtr<ID3D12Resource>> keepAlive;
+    };
+    UploadBatch BeginUpload();
+    GpuFence SubmitUpload(UploadBatch& batch, TaskPriority resumePriority = TaskPriority::Background);
 
     // Геттеры
     ID3D12Device* GetDevice() const { return device_.Get(); }
     ID3D12CommandQueue* GetCommandQueue() const { return commandQueue_.Get(); }
+    ID3D12CommandQueue* GetComputeQueue() const { return computeQueue_.Get(); }
     HWND GetHWND() const { return hWnd_; }
     UINT GetWidth() const { return width_; }
     UINT GetHeight() const { return height_; }
 
     // Доступ к глобальному аллокатору дескрипторов и текущему кадру
-    DescriptorAllocator& GetDescAlloc() { return frameResources_[currentFrameIndex_]->GetDescAlloc(); }
-    DescriptorAllocator& GetSamplerAlloc() { return frameResources_[currentFrameIndex_]->GetSamplerAlloc(); }
-    FrameResource* GetFrameResource() { return frameResources_[currentFrameIndex_].get(); }
+    DescriptorAllocator& GetDescAlloc() { return frameResources_[frameSlot_]->GetDescAlloc(); }
+    DescriptorAllocator& GetSamplerAlloc() { return frameResources_[frameSlot_]->GetSamplerAlloc(); }
+    FrameResource* GetFrameResource() { return frameResources_[frameSlot_].get(); }
 
-    UINT GetCurrentFrameIndex() const { return currentFrameIndex_; }
+    // Слот кольца кадровых ресурсов (0..GetFramesInFlight()-1) — не индекс backbuffer'а
+    UINT GetCurrentFrameIndex() const { return frameSlot_; }
+    // Сквозной номер кадра: ключ для кэшей "уже подготовлено в этом кадре" (слот повторяется
+    // каждые N кадров, а при N = 1 — каждый кадр)
+    uint64_t GetFrameNumber() const { return totalFrameNumber_; }
 
     void InitTextSystem(ID3D12GraphicsCommandList* uploadCl, std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive, const std::wstring& folder);
 
@@ -128,7 +208,14 @@ public:
     bool GetWireframeMode() const { return wireframeMode_; }
 
     void SetResourceState(ID3D12Resource* res, D3D12_RESOURCE_STATES state);
-    void Transition(ID3D12GraphicsCommandList* cl, ID3D12Resource* res, D3D12_RESOURCE_STATES after);
+    // Пакетно, под одним локом (компиляция RenderGraph)
+    void GetResourceStates(std::span<ID3D12Resource* const> res, std::span<D3D12_RESOURCE_STATES> out);
+    void SetResourceStates(std::span<ID3D12Resource* const> res, std::span<const D3D12_RESOURCE_STATES> states);
+    // Без локов: состояние ведётся в t.states. Вход в CL (первое использование) сверяется
+    // с глобальными состояниями при сабмите, в порядке таймлайна, а не записи.
+    // Ресурсы RenderGraph'а сюда не передавать — их переходы считает граф.
+    // Для driver'а пасса — до RegisterPassDriver. В COMPUTE-CL — только compute-состояния
+    void Transition(ThreadCL& t, ID3D12Resource* res, D3D12_RESOURCE_STATES after);
     void UAVBarrier(ID3D12GraphicsCommandList* cl, ID3D12Resource* res);
 
     template<class Alloc, class It>
@@ -188,10 +275,10 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE DeferredSrvAt(UINT idx) const;
 
 private:
-    static constexpr UINT kFrameCount = 2;
     static constexpr UINT kDeferredRtvPerFrame = 7; // GB0,GB1,GB2, Light, Scene, SSR, SSRBlur
     static constexpr UINT kDeferredSrvPerFrame = 8; // GB0,GB1,GB2, Depth, Light, Scene, SSR, SSRBlur
     static constexpr UINT kDeferredDsvPerFrame = 1; // Depth
+    static constexpr UINT kNullSrvCount = 2;        // Texture2D, TextureCube — после всех кадров
 
     enum class DeferredRtvSlot : UINT { GB0, GB1, GB2, Light, Scene, SSR, SSRBlur, Count = kDeferredRtvPerFrame };
     enum class DeferredSrvSlot : UINT { GB0, GB1, GB2, Depth, Light, Scene, SSR, SSRBlur, Count = kDeferredSrvPerFrame };
@@ -203,11 +290,45 @@ private:
 
     struct PassBatch_ {
         std::string name;
+        D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT;
         ID3D12GraphicsCommandList* driver = nullptr;              // DIRECT
+        const CommandListStates* driverStates = nullptr;
         std::vector<ID3D12GraphicsCommandList*> bundles;          // TYPE_BUNDLE
-        std::vector<ID3D12CommandList*>         directs;          // готовые DIRECT-CL
+        std::vector<ID3D12CommandList*>         directs;          // готовые CL (тип = type бакета)
+        std::vector<const CommandListStates*>   directStates;     // параллельно directs
+        std::vector<D3D12_RESOURCE_BARRIER>     barriers;         // вход в бакет (RenderGraph)
+        std::vector<ID3D12Resource*>            discards;         // после барьеров: активированные алиасы
+        std::vector<uint32_t>                   waitsOn;          // бакеты других очередей до этого
+        bool                                    closed = false;   // CloseSubmitBatch
     };
-    std::vector<PassBatch_> submitTimeline_;
+    std::vector<PassBatch_> submitTimeline_;     // [0, submitBatchCount_) — бакеты кадра, хвост — запас
+    size_t submitBatchCount_ = 0;
+    std::vector<ID3D12CommandList*> submitLists_; // scratch FlushClosedBatches_
+    std::vector<D3D12_RESOURCE_BARRIER> fixupBarriers_; // scratch ResolveEntryStates_
+    std::vector<D3D12_RESOURCE_BARRIER> handoffBarriers_; // scratch: графические fix-up COMPUTE-CL
+    std::vector<QueueSyncBatch> syncBatches_;     // scratch: вход QueueSyncPlan
+    QueueSyncPlan queueSync_;
+    // Сабмит по мере закрытия (всё под submitMtx_): план строится при первом сбросе
+    bool   syncPlanned_ = false;
+    size_t flushedBatches_ = 0;   // [0, flushedBatches_) уже на очередях
+    size_t flushSegment_ = 0;     // текущий сегмент плана
+    bool   segmentStarted_ = false; // его Wait'ы уже выставлены
+    bool   computeStarted_ = false; // compute-очередь в этом кадре уже ждала прошлый кадр
+    size_t executeCount_ = 0, lastFrameExecuteCount_ = 0;
+    size_t stateFixupCount_ = 0, lastFrameStateFixupCount_ = 0;
+    std::atomic<uint64_t> bindIssued_{ 0 }, bindSkipped_{ 0 };
+    BindStats lastFrameBindStats_;
+    // Очереди в QueueSyncPlan: 0 — direct (на ней кадр сходится), 1 — compute
+    static constexpr uint8_t kDirectSyncQueue = 0, kComputeSyncQueue = 1;
+    void ResetSubmitTimeline_();
+    void PlanQueueSync_();
+    void FlushClosedBatches_();
+    void CollectBatchLists_(PassBatch_& pb, std::vector<ID3D12CommandList*>& lists);
+    void ResolveEntryStates_(const CommandListStates* states, D3D12_COMMAND_LIST_TYPE type,
+        std::vector<ID3D12CommandList*>& lists);
+    void SubmitComputeHandoff_(std::vector<ID3D12CommandList*>& lists);
+    void BeginSyncSegment_(const QueueSyncSegment& seg);
+    void EndSyncSegment_(const QueueSyncSegment& seg);
     std::mutex submitMtx_;
 
     // Heaps CPU для offscreen-ресурсов
@@ -217,7 +338,22 @@ private:
     UINT deferredRtvIncr_ = 0, deferredDsvIncr_ = 0, deferredSrvIncr_ = 0;
 
     // per-frame наборы
-    DeferredTargets deferred_[kFrameCount];
+    DeferredTargets deferred_[kMaxFramesInFlight];
+
+    // Placed-куча под deferred_ на кадр + раскладка (по DeferredSrvSlot: все 8 целей).
+    // Куча слота не сжимается: раскладка, которая в неё влезает, перекладывается без новой кучи
+    ComPtr<ID3D12Heap> deferredHeap_[kMaxFramesInFlight];
+    uint64_t deferredHeapBytes_[kMaxFramesInFlight]{};
+    uint64_t deferredLayoutGen_[kMaxFramesInFlight]{}; // по какому transientLayoutGen_ разложен слот
+    std::vector<TransientPlacement> transientPlacements_[kMaxFramesInFlight];
+    D3D12_RESOURCE_DESC deferredDescs_[kDeferredSrvPerFrame]{};
+    uint64_t deferredHeapAlignment_ = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    TransientRequest transientLifetimes_[kDeferredSrvPerFrame]{}; // размеры + времена жизни от графа
+    uint64_t transientLayoutGen_ = 0, transientLayoutSolvedGen_ = UINT64_MAX;
+    TransientLayout transientLayout_;
+    TransientMemoryStats transientStats_{};
+    const TransientLayout& GetTransientLayout_();
+    void PlaceDeferredTargets_(UINT f);
 
     // OS / размеры
     HWND  hWnd_ = nullptr;
@@ -241,7 +377,10 @@ private:
 
     // RTV/DSV
     ComPtr<ID3D12DescriptorHeap>      rtvHeap_;
-    ComPtr<ID3D12Resource>            renderTargets_[kFrameCount];
+    ComPtr<ID3D12Resource>            renderTargets_[kMaxFramesInFlight];
+    UINT                              backBufferIndex_ = 0;  // от свапа; с кольцом кадров не связан
+    // Backbuffer'ов не меньше, чем кадров в полёте (и не меньше двух для flip-модели)
+    UINT BackBufferCount_() const { return framesInFlight_ < 2 ? 2 : framesInFlight_; }
     UINT                              rtvDescriptorSize_ = 0;
 
     ComPtr<ID3D12DescriptorHeap>      dsvHeap_;
@@ -252,12 +391,33 @@ private:
     ComPtr<ID3D12Fence>               fence_;
     HANDLE                            fenceEvent_ = nullptr;
     UINT64                            nextFenceValue_ = 1;                  // глобальный инкремент
-    UINT64                            frameFenceValues_[kFrameCount] = {};  // последний сигнал для каждого кадра
+    UINT64                            frameFenceValues_[kMaxFramesInFlight] = {};  // последний сигнал слота кольца
+
+    // Асинхронный compute: своя очередь и фенс. Кадр сходится на direct (его фенс кадра
+    // покрывает и compute); compute кадра стартует не раньше конца прошлого кадра на direct
+    ComPtr<ID3D12CommandQueue>        computeQueue_;
+    ComPtr<ID3D12Fence>               computeFence_;
+    UINT64                            nextComputeFenceValue_ = 1;
+    UINT64                            lastFrameFenceValue_ = 0;
+    // Внеплановая передача на direct (ResolveEntryStates_ для COMPUTE-CL): свой фенс,
+    // номера QueueSyncPlan на fence_/computeFence_ не сбиваются
+    ComPtr<ID3D12Fence>               handoffFence_;
+    UINT64                            nextHandoffFenceValue_ = 1;
+
+    // Асинхронные аплоады: отдельный фенс, Execute+Signal под локом (значения монотонны в очереди)
+    ComPtr<ID3D12Fence>               uploadFence_;
+    UINT64                            nextUploadFenceValue_ = 1;
+    std::mutex                        uploadMtx_;
 
     // Кадровые ресурсы (аллокатор + upload и т.п.)
-	std::unique_ptr<FrameResource>    frameResources_[kFrameCount];
-    UINT                              currentFrameIndex_ = 0;                   // 0..kFrameCount-1
-
+    // Кольцо: слот кадра k — k % framesInFlight_; перед повторным использованием слота
+    // BeginFrame ждёт его фенс (frameFenceValues_)
+	std::unique_ptr<FrameResource>    frameResources_[kMaxFramesInFlight];
+    UINT                              framesInFlight_ = 2;
+    UINT                              frameSlot_ = 0;                   // 0..framesInFlight_-1
+    void CreateFrameResources_();
+
+    // Лок берут загрузчики (SetResourceState), граф раз за кадр и сабмит — не запись CL
     std::mutex knownStatesMtx_;
     std::unordered_map<ID3D12Resource*, D3D12_RESOURCE_STATES> knownStates_;
 
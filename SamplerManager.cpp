@@ -41,7 +41,7 @@ UINT SamplerManager::ensureCpu_(const D3D12_SAMPLER_DESC& desc) {
 
     Entry e;
     e.cpuIndex = idx;
-    e.lastFrame = UINT(-1);
+    e.lastFrame = UINT64_MAX;
     e.gpu.ptr = 0;
     cache_.emplace(key, e);
     return idx;
@@ -49,7 +49,7 @@ UINT SamplerManager::ensureCpu_(const D3D12_SAMPLER_DESC& desc) {
 
 D3D12_GPU_DESCRIPTOR_HANDLE SamplerManager::Get(Renderer* renderer, const D3D12_SAMPLER_DESC& desc) {
     const UINT cpuIdx = ensureCpu_(desc);
-    const UINT frame  = renderer->GetCurrentFrameIndex();
+    const uint64_t frame = renderer->GetFrameNumber();
 
     SamplerKey key(desc);
     {
@@ -56,7 +56,7 @@ public:
 private:
     struct Entry {
         UINT  cpuIndex = UINT(-1);                      // индекс в CPU heap
-        UINT  lastFrame = UINT(-1);                     // кадр, когда стейджили последний раз
+        uint64_t lastFrame = UINT64_MAX;                // кадр (GetFrameNumber), когда стейджили последний раз
         D3D12_GPU_DESCRIPTOR_HANDLE gpu{};              // GPU handle в shader-visible heap (на кадр lastFrame)
     };
 
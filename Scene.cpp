@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <algorithm>
+#include <array>
 
 #include "ActionMap.h"
 #include "Camera.h"
@@ -12,6 +13,17 @@
 
 void Scene::InitAll(Renderer* renderer, ID3D12GraphicsCommandList* uploadCmdList, std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* uploadKeepAlive)
 {
+    // Ассеты всех объектов — параллельно корутинами на TaskSystem; Init ниже берёт их из кэшей
+    {
+        std::vector<AsyncTask<void>> preloads;
+        preloads.reserve(objects_.size());
+        for (auto& obj : objects_)
+        {
+            preloads.push_back(obj->PreloadAsync(renderer));
+        }
+        SyncWait(WhenAll(std::move(preloads)));
+    }
+
     for (auto& obj : objects_)
     {
         obj->Init(renderer, uploadCmdList, uploadKeepAlive);
@@ -70,6 +82,9 @@ void Scene::InitAll(Renderer* renderer, ID3D12GraphicsCommandList* uploadCmdList
 
     skyBox_ = std::make_unique<Skybox>(L"textures/skybox.dds");
     skyBox_->Init(renderer, uploadCmdList, uploadKeepAlive);
+
+    // Первый кадр рисуется до первого тика — публикуем состояние после Init
+    PublishRenderState_();
 }
 
 void Scene::AddObject(std::unique_ptr<RenderableObjectBase> obj) {
@@ -77,21 +92,60 @@ void Scene::AddObject(std::unique_ptr<RenderableObjectBase> obj) {
 }
 
 void Scene::Tick(float deltaTime) {
+    // Ждём только свои тики: фоновые задачи (FS-probe и т.п.) кадр не держат
+    TaskGroup tickGroup(TaskPriority::FrameCritical);
+    LaunchTick_(tickGroup, deltaTime);
+    tickGroup.Wait();
+    PublishRenderState_();
+}
+
+void Scene::RunFrame(Renderer* renderer, float deltaTime) {
+    if (actions_ != nullptr && input_ != nullptr && actions_->WasActionPressed("PipelineFrames", *input_)) {
+        pipelinedFrames_ = !pipelinedFrames_;
+    }
+
+    if (!pipelinedFrames_) {
+        Tick(deltaTime);
+        Render(renderer);
+        return;
+    }
+
+    // Публикуем результат прошлого тика (он уже дождан), запускаем тик этого кадра и,
+    // не дожидаясь, пишем кадр по опубликованному состоянию. Тик ниже записи по приоритету:
+    // воркеры сперва разбирают CL кадра, а тик добирает простаивающие потоки.
+    // Ожидания главного потока в Render (отсечение, frameTasks.Wait()) помогают только своей
+    // группе и вложенным в её задачи — чужие задачи главный поток не крадёт, так что тик
+    // он не ест. Воркер, ждущий внутри задачи кадра, крадёт без фильтра и кусок тика взять может
+    PublishRenderState_();
+    TaskGroup tickGroup(TaskPriority::Normal);
+    LaunchTick_(tickGroup, deltaTime);
+    Render(renderer);
+    // До следующего NewFrame ввода/публикации тик должен закончиться
+    tickGroup.Wait();
+}
+
+void Scene::LaunchTick_(TaskGroup& group, float deltaTime) {
+    // Камера — дёшево и на главном потоке; читает Render только опубликованную копию
     if (input_ != nullptr && actions_ != nullptr) {
         camera_.UpdateFromActions(*input_, *actions_, deltaTime);
     }
 
-    auto& tasks = TaskSystem::Get();
-
-    tasks.Dispatch(objects_.size(),
+    // Размер куска подбирается сам по стоимости Tick'а
+    TaskSystem::Get().ParallelFor(group, 0, objects_.size(),
         [this, deltaTime](size_t index) {
-            if (index >= objects_.size()) {
-                return;
-			}
             objects_[index]->Tick(deltaTime);
-		}, 1);
+		}, TaskSystem::kAutoGrain, &tickTuner_);
+}
 
-	tasks.WaitForAll();
+void Scene::PublishRenderState_() {
+    renderView_ = camera_.GetViewMatrix();
+    renderCamPos_ = camera_.GetPosition();
+
+    // Копия на объект — дёшево, но объектов может быть много: тем же ParallelFor
+    TaskSystem::Get().ParallelFor(0, objects_.size(),
+        [this](size_t index) {
+            objects_[index]->PublishRenderState();
+        }, TaskSystem::kAutoGrain, &publishTuner_);
 }
 
 void Scene::Render(Renderer* renderer) {
@@ -103,12 +157,38 @@ void Scene::Render(Renderer* renderer) {
     {
         renderer->SetWireframeMode(!renderer->GetWireframeMode()); //toggle
     }
+    if (actions_->WasActionPressed("Reflections", *input_)) {
+        reflectionsEnabled_ = !reflectionsEnabled_;
+    }
+    // 1 → 2 → … → max → 1; между кадрами (до BeginFrame), рендерер сам досинхронизируется
+    if (actions_->WasActionPressed("FramesInFlight", *input_)) {
+        renderer->SetFramesInFlight(renderer->GetFramesInFlight() % Renderer::kMaxFramesInFlight + 1);
+    }
 
     auto* tb = renderer->GetTextManager();
     tb->Begin(renderer->GetWidth(), renderer->GetHeight(), 1.0f);
 
 	int textY = 8;
-    tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 32.0f, "FPS:%.0f", renderer->GetFPS());
+    tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 32.0f, "FPS:%.0f%s [%u in flight]", renderer->GetFPS(),
+        pipelinedFrames_ ? " (pipelined)" : "", renderer->GetFramesInFlight());
+    {
+        const auto rt = renderer->GetTransientMemoryStats();
+        textY += 32;
+        tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 16.0f, "RT:%.0fMB/frame (%.0fMB unaliased)",
+            rt.heapBytes / (1024.0 * 1024.0), rt.naiveBytes / (1024.0 * 1024.0));
+        textY += 16;
+        tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 16.0f, "Passes:%zu (%zu culled, %zu merged)%s Split barriers:%zu Submits:%zu Fixups:%zu",
+            frameGraph_.GetPassCount(), frameGraph_.GetCulledPassCount(), frameGraph_.GetMergedPassCount(),
+            reflectionsEnabled_ ? "" : " SSR off", frameGraph_.GetSplitBarrierCount(), renderer->GetSubmitCountLastFrame(),
+            renderer->GetStateFixupCountLastFrame());
+        textY += 16;
+        const Renderer::BindStats bs = renderer->GetBindStatsLastFrame();
+        tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 16.0f, "Binds:%llu set, %llu skipped",
+            (unsigned long long)bs.issued, (unsigned long long)bs.skipped);
+        textY += 16;
+        tb->AddTextf(8, textY, TextManager::RGBA(1, 1, 1, 0.5), 16.0f, "Objects:%zu drawn, %zu culled",
+            cullStats_.drawn, cullStats_.culled);
+    }
 
     //textY += 32;
     //tb->AddText(8, textY, TextManager::RGBA(1, 1, 1), 32.0f, "Some text with size 32!!!");
@@ -124,7 +204,7 @@ void Scene::Render(Renderer* renderer) {
 
     // матрицы
     const float aspect = float(renderer->GetWidth()) / float(renderer->GetHeight());
-    const mat4 view = camera_.GetViewMatrix();
+    const mat4 view = renderView_;
     constexpr float HFOV = XMConvertToRadians(90.f);
     const float VFOV = 2.f * atan(tan(HFOV * 0.5f) / aspect);
     const float zNear = 0.01f;
@@ -141,32 +221,85 @@ void Scene::Render(Renderer* renderer) {
 		TransparentComplexRender
 	};
 
-	std::unordered_map<ObjectRenderType, std::vector<RenderableObjectBase*>> objectsToRender;
+    // Массив, а не map: пассы читают списки параллельно, operator[] вставлял бы на лету
+    std::array<std::vector<RenderableObjectBase*>, 4> objectsToRender;
 
-    for (const auto& obj : objects_) {
-        if (obj) {
+    // Отсечение по пирамиде: мировые AABB собираются в SoA параллельно, затем SIMD-тест по 4
+    culler_.Resize(objects_.size());
+    TaskSystem::Get().ParallelForRange(0, objects_.size(), [this](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Math::AABB b;
+            if (objects_[i] && objects_[i]->GetWorldBounds(b)) {
+                culler_.SetBounds(i, b);
+            }
+            else {
+                culler_.SetUnbounded(i);
+            }
+        }
+    }, TaskSystem::kAutoGrain, &boundsTuner_);
+    cullStats_ = culler_.Cull(Frustum::FromViewProj(view * proj), &cullTuner_);
+
+    for (size_t oi = 0; oi < objects_.size(); ++oi) {
+        const auto& obj = objects_[oi];
+        if (obj && culler_.IsVisible(oi)) {
             if (obj->IsTransparent())
             {
                 if (obj->IsSimpleRender()) {
-                    objectsToRender[ObjectRenderType::TransparentSimpleRender].push_back(obj.get());
+                    objectsToRender[size_t(ObjectRenderType::TransparentSimpleRender)].push_back(obj.get());
                 }
                 else {
-                    objectsToRender[ObjectRenderType::TransparentComplexRender].push_back(obj.get());
+                    objectsToRender[size_t(ObjectRenderType::TransparentComplexRender)].push_back(obj.get());
                 }
             }
             else
             {
                 if (obj->IsSimpleRender()) {
-                    objectsToRender[ObjectRenderType::OpaqueSimpleRender].push_back(obj.get());
+                    objectsToRender[size_t(ObjectRenderType::OpaqueSimpleRender)].push_back(obj.get());
                 }
                 else {
-                    objectsToRender[ObjectRenderType::OpaqueComplexRender].push_back(obj.get());
+                    objectsToRender[size_t(ObjectRenderType::OpaqueComplexRender)].push_back(obj.get());
                 }
             }
         }
 	}
 
-    RenderGraph rg;
+    // Объекты с асинхронным compute — один compute-пасс на всех
+    asyncComputeObjects_.clear();
+    for (const auto& obj : objects_) {
+        if (obj && obj->GetAsyncComputeOutput() != nullptr) {
+            asyncComputeObjects_.push_back(obj.get());
+        }
+    }
+
+    // Все задачи записи CL этого кадра — в кадровом классе приоритета
+    TaskGroup frameTasks(TaskPriority::FrameCritical);
+
+    // Граф постоянный: декларация та же — перекомпиляции нет, меняются только колбэки
+    RenderGraph& rg = frameGraph_;
+    rg.BeginFrame();
+
+    // Ресурсы кадра: пассы объявляют доступы, переходы и барьеры считает граф
+    const auto& DF = renderer->GetDeferredForFrame();
+    const auto rGB0 = rg.ImportResource("GB0", DF.gb0.Get());
+    const auto rGB1 = rg.ImportResource("GB1", DF.gb1.Get());
+    const auto rGB2 = rg.ImportResource("GB2", DF.gb2.Get());
+    const auto rDepth = rg.ImportResource("Depth", DF.depth.Get());
+    const auto rLight = rg.ImportResource("Light", DF.light.Get());
+    const auto rSSR = rg.ImportResource("SSR", DF.ssr.Get());
+    const auto rSSRBlur = rg.ImportResource("SSRBlur", DF.ssrBlur.Get());
+    const auto rScene = rg.ImportResource("SceneColor", DF.scene.Get());
+    using RG = RenderGraph;
+
+    // Выходы async compute: compute пишет (UAV), читает пасс, который рисует объект.
+    // Списки доступов — в членах: ёмкость переживает кадр
+    computeAccesses_.clear();
+    gbufferAccesses_.assign({ RG::RTV(rGB0), RG::RTV(rGB1), RG::RTV(rGB2), RG::DSVWrite(rDepth) });
+    transparentAccesses_.assign({ RG::RTV(rScene), RG::DSVWrite(rDepth) });
+    for (RenderableObjectBase* obj : asyncComputeObjects_) {
+        const auto rOut = rg.ImportResource("AsyncComputeOut", obj->GetAsyncComputeOutput());
+        computeAccesses_.push_back(RG::UAV(rOut));
+        (obj->IsTransparent() ? transparentAccesses_ : gbufferAccesses_).push_back(RG::SRV(rOut));
+    }
 
     // 1) Пролог (clear)
     auto pClear = rg.AddPass("PrologueClear", {},
@@ -177,34 +310,44 @@ void Scene::Render(Renderer* renderer) {
             renderer->EndThreadCommandList(t, ctx.batchIndex);
         });
 
-    auto pGBuffer = rg.AddPass("GBuffer", { pClear },
+    // 1.0) Async compute (анимация инстансов и т.п.) — на compute-очереди параллельно
+    // с графикой до первого читателя; фенсы по рёбрам графа
+    if (!asyncComputeObjects_.empty()) {
+        rg.AddComputePass("AsyncCompute", {}, computeAccesses_,
+            [this, renderer](RenderGraph::PassContext ctx) {
+                auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+                t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
+                for (RenderableObjectBase* obj : asyncComputeObjects_) {
+                    obj->RecordAsyncCompute(renderer, t.cl);
+                }
+                renderer->EndThreadCommandList(t, ctx.batchIndex);
+            });
+    }
+
+    auto pGBuffer = rg.AddPass("GBuffer", { pClear }, gbufferAccesses_,
         [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext ctx) {
-            RenderGraph rgGB(ctx.batchIndex);
+            RenderGraph& rgGB = gbufferGraph_;
+            rgGB.BeginFrame(ctx.batchIndex);
 
             // 1.1 Driver: биндим и чистим один раз. НЕ закрываем driver тут.
             rgGB.AddPass("GBuffer.Driver", {}, [renderer](RenderGraph::PassContext sub) {
                 auto driver = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
-                
-                const auto& D = renderer->GetDeferredForFrame();
-                renderer->Transition(driver.cl, D.gb0.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-                renderer->Transition(driver.cl, D.gb1.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-                renderer->Transition(driver.cl, D.gb2.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-                renderer->Transition(driver.cl, D.depth.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
-
                 renderer->BindGBuffer(driver.cl, Renderer::ClearMode::ColorDepth);
-                renderer->RegisterPassDriver(driver.cl, sub.batchIndex);
+                renderer->RegisterPassDriver(driver, sub.batchIndex);
                 });
 
             // 1.2 Opaque simple → bundles
-            rgGB.AddPass("GBuffer.OpaqueSimple", {}, [this, renderer, view, proj, &objectsToRender](RenderGraph::PassContext sub) {
-                RenderObjectBatch(renderer, objectsToRender[ObjectRenderType::OpaqueSimpleRender],
-                    sub.batchIndex, view, proj, /*useBundles=*/true, true);
+            rgGB.AddPass("GBuffer.OpaqueSimple", {}, [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext sub) {
+                RenderObjectBatch(renderer, objectsToRender[size_t(ObjectRenderType::OpaqueSimpleRender)],
+                    sub.batchIndex, view, proj, /*useBundles=*/true, true,
+                    &renderTuners_[size_t(ObjectRenderType::OpaqueSimpleRender)]);
                 });
 
             // 1.3 Opaque complex → direct CL, без очисток
-            rgGB.AddPass("GBuffer.OpaqueComplex", {}, [this, renderer, view, proj, &objectsToRender](RenderGraph::PassContext sub) {
-                RenderObjectBatch(renderer, objectsToRender[ObjectRenderType::OpaqueComplexRender],
-                    sub.batchIndex, view, proj, /*useBundles=*/false, true);
+            rgGB.AddPass("GBuffer.OpaqueComplex", {}, [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext sub) {
+                RenderObjectBatch(renderer, objectsToRender[size_t(ObjectRenderType::OpaqueComplexRender)],
+                    sub.batchIndex, view, proj, /*useBundles=*/false, true,
+                    &renderTuners_[size_t(ObjectRenderType::OpaqueComplexRender)]);
                 });
 
             rgGB.Execute(renderer);
@@ -212,15 +355,10 @@ void Scene::Render(Renderer* renderer) {
 
     // 2) LIGHTING — fullscreen → LightTarget (очистка один раз)
     auto pLighting = rg.AddPass("Lighting", { pGBuffer },
+        { RG::SRV(rGB0), RG::SRV(rGB1), RG::SRV(rGB2), RG::SRV(rDepth), RG::RTV(rLight) },
         [this, renderer, &view, &proj, &invView, &invProj](RenderGraph::PassContext ctx) {
             auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
             t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
-            const auto& D = renderer->GetDeferredForFrame();
-            renderer->Transition(t.cl, D.gb0.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.gb1.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.gb2.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.depth.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.light.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
             renderer->BindLightTarget(t.cl, Renderer::ClearMode::Color, false);
 
             float3 sunDirWS = Math::float3(-0.5f, -0.7f, -0.5f); // «лучи вниз»
@@ -233,7 +371,7 @@ void Scene::Render(Renderer* renderer) {
             matLighting_->UpdateCB0Field("ambientIntensity", 0.05f, (uint8_t*)cb.cpu);
             matLighting_->UpdateCB0Field("lightRgb", float3(1, 1, 1).xm(), (uint8_t*)cb.cpu);
             matLighting_->UpdateCB0Field("exposure", 1.5f, (uint8_t*)cb.cpu);
-            matLighting_->UpdateCB0Field("camPosWS", camera_.GetPosition().xm(), (uint8_t*)cb.cpu);
+            matLighting_->UpdateCB0Field("camPosWS", renderCamPos_.xm(), (uint8_t*)cb.cpu);
             matLighting_->UpdateCB0Field("invView", invView.xm(), (uint8_t*)cb.cpu);
             matLighting_->UpdateCB0Field("invProj", invProj.xm(), (uint8_t*)cb.cpu);
 
@@ -242,41 +380,37 @@ void Scene::Render(Renderer* renderer) {
             rc.table[0] = renderer->StageGBufferSrvTable();
             rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::PointClamp() });
 
-            matLighting_->Bind(t.cl, rc);
+            renderer->AddBindStats(matLighting_->Bind(t.cl, rc), 0);
             t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
             t.cl->DrawInstanced(3, 1, 0, 0);
 
             renderer->EndThreadCommandList(t, ctx.batchIndex);
         });
 
-    auto pSky = rg.AddPass("Skybox", { pLighting },
+    // Нет неба — пасса нет (его запись в Light потребляется, сам он не отсечётся)
+    auto pSky = !skyBox_ ? pLighting : rg.AddPass("Skybox", { pLighting },
+        { RG::RTV(rLight), RG::DSVRead(rDepth) },
         [this, renderer, &view, &proj](RenderGraph::PassContext ctx) {
-            if (!skyBox_) { return; }
             auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
             t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
 
-            const auto& D = renderer->GetDeferredForFrame();
-            renderer->Transition(t.cl, D.light.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-            renderer->Transition(t.cl, D.depth.Get(), D3D12_RESOURCE_STATE_DEPTH_READ);
-
             // RTV = SceneColor, DSV = GBuffer Depth (read-only), без очисток
             renderer->BindLightTarget(t.cl, Renderer::ClearMode::None, true);
 
-            skyBox_->Render(renderer, t.cl, view, proj);
+            BindStateCache cache;
+            skyBox_->Render(renderer, t.cl, view, proj, cache);
+            renderer->AddBindStats(cache.Issued(), cache.Skipped());
 
             renderer->EndThreadCommandList(t, ctx.batchIndex);
         });
 
     // --- SSR ---
-    auto pSSR = rg.AddPass("SSR", { pSky }, [this, renderer, &view, &proj, &invView, &invProj, zNear, zFar](RenderGraph::PassContext ctx) {
+    auto pSSR = rg.AddPass("SSR", { pSky },
+        { RG::SRV(rDepth), RG::SRV(rGB1), RG::SRV(rLight), RG::RTV(rSSR) },
+        [this, renderer, &view, &proj, &invView, &invProj, zNear, zFar](RenderGraph::PassContext ctx) {
         auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
         t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
         const auto& D = renderer->GetDeferredForFrame();
-        
-        renderer->Transition(t.cl, D.depth.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        renderer->Transition(t.cl, D.gb1.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        renderer->Transition(t.cl, D.light.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        renderer->Transition(t.cl, D.ssr.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
         renderer->BindSSRTarget(t.cl, Renderer::ClearMode::Color);
 
         auto cb = renderer->GetFrameResource()->AllocDynamic(matSSR_->GetCBSizeBytesAligned(0, 256), 256);
@@ -295,71 +429,52 @@ void Scene::Render(Renderer* renderer) {
         rc.table[0] = renderer->StageSrvUavTable({ D.lightSRV, D.gbSRV[1], D.gbSRV[3] }).gpu; // t0 Light, t1 GB1, t2 Depth
         rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::LinearClamp(), SamplerManager::PointClamp() });
 
-        matSSR_->Bind(t.cl, rc);
+        renderer->AddBindStats(matSSR_->Bind(t.cl, rc), 0);
         t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         t.cl->DrawInstanced(3, 1, 0, 0);
         renderer->EndThreadCommandList(t, ctx.batchIndex);
         });
 
-    // --- BLUR X ---
-    auto pBlur = rg.AddPass("SSR.Blur", { pSSR }, [this, renderer](RenderGraph::PassContext ctx) {
+    // --- BLUR --- (разделимый: X в ssrBlur, Y обратно в ssr — два пасса, барьеры между ними ставит граф)
+    auto blurPass = [this, renderer](RenderGraph::PassContext ctx, bool vertical) {
         auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
         t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
         const auto& D = renderer->GetDeferredForFrame();
-        // X Pass---
-        renderer->Transition(t.cl, D.ssr.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        renderer->Transition(t.cl, D.ssrBlur.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-        renderer->BindSSRBlurTarget(t.cl, Renderer::ClearMode::Color);
+        if (vertical) {
+            renderer->BindSSRTarget(t.cl, Renderer::ClearMode::None); // RT=ssr
+        }
+        else {
+            renderer->BindSSRBlurTarget(t.cl, Renderer::ClearMode::Color);
+        }
 
         auto cb = renderer->GetFrameResource()->AllocDynamic(matBlur_->GetCBSizeBytesAligned(0, 256), 256);
-        float2 dir = float2(1.0f / renderer->GetWidth(), 0.0f);
+        const float2 dir = vertical ? float2(0.0f, 1.0f / renderer->GetHeight()) : float2(1.0f / renderer->GetWidth(), 0.0f);
         matBlur_->UpdateCB0Field("dir", dir.xm(), (uint8_t*)cb.cpu);
         matBlur_->UpdateCB0Field("radius", 1.0f, (uint8_t*)cb.cpu);
         RenderContext rc{};
         rc.cbv[0] = cb.gpu;
-        rc.table[0] = renderer->StageSrvUavTable({ D.ssrSRV }).gpu;
+        rc.table[0] = renderer->StageSrvUavTable({ vertical ? D.ssrBlurSRV : D.ssrSRV }).gpu;
         rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::LinearClamp() });
 
-        matBlur_->Bind(t.cl, rc);
+        renderer->AddBindStats(matBlur_->Bind(t.cl, rc), 0);
         t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         t.cl->DrawInstanced(3, 1, 0, 0);
-        // ---
-        // Y Pass---
-        renderer->Transition(t.cl, D.ssrBlur.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        renderer->Transition(t.cl, D.ssr.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-
-        renderer->BindSSRTarget(t.cl, Renderer::ClearMode::None); // RT=ssr
-
-        cb = renderer->GetFrameResource()->AllocDynamic(matBlur_->GetCBSizeBytesAligned(0, 256), 256);
-        dir = float2(0.0f, 1.0f / renderer->GetHeight());
-        matBlur_->UpdateCB0Field("dir", dir.xm(), (uint8_t*)cb.cpu);
-        matBlur_->UpdateCB0Field("radius", 1.0f, (uint8_t*)cb.cpu);
-        
-        rc.cbv[0] = cb.gpu;
-        rc.table[0] = renderer->StageSrvUavTable({ D.ssrBlurSRV }).gpu;
-        rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::LinearClamp() });
-
-        matBlur_->Bind(t.cl, rc);
-        t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        t.cl->DrawInstanced(3, 1, 0, 0);
-        //---
         renderer->EndThreadCommandList(t, ctx.batchIndex);
-        });
+    };
+    auto pBlurX = rg.AddPass("SSR.BlurX", { pSSR }, { RG::SRV(rSSR), RG::RTV(rSSRBlur) },
+        [blurPass](RenderGraph::PassContext ctx) { blurPass(ctx, false); });
+    auto pBlurY = rg.AddPass("SSR.BlurY", { pBlurX }, { RG::SRV(rSSRBlur), RG::RTV(rSSR) },
+        [blurPass](RenderGraph::PassContext ctx) { blurPass(ctx, true); });
 
     // 3) COMPOSE — Light + Emissive → SceneColor
-    auto pCompose = rg.AddPass("Compose", { pBlur },
-        [this, renderer, &view, &proj, &invView, &invProj, zNear, zFar](RenderGraph::PassContext ctx) {
+    // Отражения выключены — Compose не читает SSR, и граф отсекает SSR + оба блюра
+    // (ни CL, ни бакетов, ни барьеров); на место t6 идёт null-SRV (α = 0 → только небо)
+    const bool reflections = reflectionsEnabled_;
+    auto composeFn = [this, renderer, &view, &proj, &invView, &invProj, zNear, zFar, reflections](RenderGraph::PassContext ctx) {
             auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
             t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
             const auto& D = renderer->GetDeferredForFrame();
-            renderer->Transition(t.cl, D.gb0.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.gb1.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.gb2.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.depth.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.light.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.ssr.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            renderer->Transition(t.cl, D.scene.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
             renderer->BindSceneColor(t.cl, Renderer::ClearMode::Color, false);
 
             // === CB для compose_ps ===
@@ -378,44 +493,51 @@ void Scene::Render(Renderer* renderer) {
             srvs.push_back(D.gbSRV[0]);   // t2 (GB0)
             srvs.push_back(D.gbSRV[1]);   // t3 (GB1)
             srvs.push_back(D.gbSRV[3]);   // t4 (Depth)
-            srvs.push_back(skyBox_->GetTex()->GetSRVCPU());
-            srvs.push_back(D.ssrSRV);
+            srvs.push_back(skyBox_ ? skyBox_->GetTex()->GetSRVCPU() : renderer->GetNullSrvCube()); // t5
+            srvs.push_back(reflections ? D.ssrSRV : renderer->GetNullSrv2D());                     // t6
 
             RenderContext rc{};
             rc.cbv[0] = cb.gpu; // b0
             rc.table[0] = renderer->StageSrvUavTable(srvs).gpu;
             rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::LinearClamp(), SamplerManager::PointClamp() });
 
-            matCompose_->Bind(t.cl, rc);
+            renderer->AddBindStats(matCompose_->Bind(t.cl, rc), 0);
             t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
             t.cl->DrawInstanced(3, 1, 0, 0);
 
             renderer->EndThreadCommandList(t, ctx.batchIndex);
-        });
+        };
+    auto pCompose = reflections
+        ? rg.AddPass("Compose", { pBlurY },
+            { RG::SRV(rGB0), RG::SRV(rGB1), RG::SRV(rGB2), RG::SRV(rDepth), RG::SRV(rLight), RG::SRV(rSSR), RG::RTV(rScene) },
+            std::move(composeFn))
+        : rg.AddPass("Compose", { pSky },
+            { RG::SRV(rGB0), RG::SRV(rGB1), RG::SRV(rGB2), RG::SRV(rDepth), RG::SRV(rLight), RG::RTV(rScene) },
+            std::move(composeFn));
 
     // 4) TRANSPARENT — forward поверх SceneColor, depth test по GBuffer DSV
-    auto pTransp = rg.AddPass("Transparent", { pCompose },
-        [this, renderer, view, proj, &objectsToRender](RenderGraph::PassContext ctx) {
-            RenderGraph rgTr(ctx.batchIndex);
+    auto pTransp = rg.AddPass("Transparent", { pCompose }, transparentAccesses_,
+        [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext ctx) {
+            RenderGraph& rgTr = transparentGraph_;
+            rgTr.BeginFrame(ctx.batchIndex);
 
             // Driver: RTV=SceneColor, DSV=GBuffer. Без очистки. НЕ закрываем.
             rgTr.AddPass("Transparent.Driver", {}, [renderer](RenderGraph::PassContext sub) {
                 auto driver = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
-                const auto& D = renderer->GetDeferredForFrame();
-                renderer->Transition(driver.cl, D.scene.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
-                renderer->Transition(driver.cl, D.depth.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
                 renderer->BindSceneColor(driver.cl, Renderer::ClearMode::None, true);
-                renderer->RegisterPassDriver(driver.cl, sub.batchIndex);
+                renderer->RegisterPassDriver(driver, sub.batchIndex);
                 });
 
-            rgTr.AddPass("Transparent.Simple", {}, [this, renderer, view, proj, &objectsToRender](RenderGraph::PassContext sub) {
-                RenderObjectBatch(renderer, objectsToRender[ObjectRenderType::TransparentSimpleRender],
-                    sub.batchIndex, view, proj, /*useBundles=*/true, false);
+            rgTr.AddPass("Transparent.Simple", {}, [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext sub) {
+                RenderObjectBatch(renderer, objectsToRender[size_t(ObjectRenderType::TransparentSimpleRender)],
+                    sub.batchIndex, view, proj, /*useBundles=*/true, false,
+                    &renderTuners_[size_t(ObjectRenderType::TransparentSimpleRender)]);
                 });
 
-            rgTr.AddPass("Transparent.Complex", {}, [this, renderer, view, proj, &objectsToRender](RenderGraph::PassContext sub) {
-                RenderObjectBatch(renderer, objectsToRender[ObjectRenderType::TransparentComplexRender],
-                    sub.batchIndex, view, proj, /*useBundles=*/false, false);
+            rgTr.AddPass("Transparent.Complex", {}, [this, renderer, &view, &proj, &objectsToRender](RenderGraph::PassContext sub) {
+                RenderObjectBatch(renderer, objectsToRender[size_t(ObjectRenderType::TransparentComplexRender)],
+                    sub.batchIndex, view, proj, /*useBundles=*/false, false,
+                    &renderTuners_[size_t(ObjectRenderType::TransparentComplexRender)]);
                 });
 
             rgTr.Execute(renderer);
@@ -423,44 +545,48 @@ void Scene::Render(Renderer* renderer) {
 
     // 5) TONEMAP — SceneColor → Backbuffer
     auto pTonemap = rg.AddPass("Tonemap", { pTransp },
+        { RG::SRV(rScene) },
         [this, renderer](RenderGraph::PassContext ctx) {
-            auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
+            auto t = ctx.BeginCommandList();
             t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
-            const auto& D = renderer->GetDeferredForFrame();
-            renderer->Transition(t.cl, D.scene.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
             renderer->RecordBindDefaultsNoClear(t.cl);
 
             RenderContext rc{};
             rc.table[0] = renderer->StageTonemapSrvTable(); // t0
             rc.samplerTable[0] = renderer->GetSamplerManager()->GetTable(renderer, { SamplerManager::LinearClamp() });
 
-            matTonemap_->Bind(t.cl, rc);
+            renderer->AddBindStats(matTonemap_->Bind(t.cl, rc), 0);
             t.cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
             t.cl->DrawInstanced(3, 1, 0, 0);
 
-            renderer->EndThreadCommandList(t, ctx.batchIndex);
+            ctx.EndCommandList(t);
         });
+    rg.AllowMerge(pTonemap);
 
-    // 6) OVERLAY — как было
+    // 6) OVERLAY — как было; вместе с Tonemap дешевле своего CL — граф их склеивает
     auto pOverlay = rg.AddPass("Overlay", { pTonemap },
         [this, renderer](RenderGraph::PassContext ctx) {
             if (auto* tm = renderer->GetTextManager()) {
-                auto t = renderer->BeginThreadCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
+                auto t = ctx.BeginCommandList();
                 t.cl->SetName(std::wstring(ctx.passName.begin(), ctx.passName.end()).data());
                 renderer->RecordBindDefaultsNoClear(t.cl);
                 tm->Build(renderer, t.cl);
                 tm->Draw(renderer, t.cl);
-                renderer->EndThreadCommandList(t, ctx.batchIndex);
+                ctx.EndCommandList(t);
             }
         });
+    rg.AllowMerge(pOverlay);
 
-    // Граф только регистрирует бакеты и запускает задачи
-    rg.Execute(renderer);
+    // Граф регистрирует бакеты в топологическом порядке и запускает пассы задачами
+    // в frameTasks: независимые пишутся параллельно, порядок сабмита — по бакетам.
+    // Дописанный бакет закрывается, готовый префикс кадра сразу уходит на GPU
+    rg.Execute(renderer, frameTasks);
 
-    // ОДИН общий вейт: ждём, пока воркеры допишут CL'ки в свои бакеты
-    TaskSystem::Get().WaitForAll();
+    // ОДИН общий вейт: ждём, пока воркеры допишут CL'ки в свои бакеты.
+    // Только задачи кадра — главный поток сам помогает их исполнять
+    frameTasks.Wait();
 
-    // Сабмитим бакеты в порядке топологии и делаем Present
+    // Досабмитываем хвост бакетов и делаем Present
     renderer->EndFrame();
 }
 
@@ -469,24 +595,23 @@ void Scene::RenderObjectBatch(Renderer* renderer,
     size_t batchIndex,
     const mat4& view, const mat4& proj,
     bool useBundles,
-    bool bindGbufOrScene)
+    bool bindGbufOrScene,
+    ParallelForTuner* tuner)
 {
     if (objects.empty()) return;
 
-    auto& tasks = TaskSystem::Get();
-    const size_t N = objects.size();
-    const size_t chunkSize = 8;
-
-    tasks.Dispatch((N + chunkSize - 1) / chunkSize,
-        [renderer, view, proj, &objects, useBundles, chunkSize, batchIndex, bindGbufOrScene](std::size_t jobIndex)
+    // Кусок = один CL/бандл; размер подбирается по стоимости записи (вместе с открытием CL).
+    // Блокирующий: когда пасс вернулся, все CL его бакета сданы и бакет можно закрывать
+    // (ждущий поток помогает пулу, приоритет — кадровый, от задачи пасса)
+    TaskSystem::Get().ParallelForRange(0, objects.size(),
+        [renderer, view, proj, &objects, useBundles, batchIndex, bindGbufOrScene](std::size_t begin, std::size_t end)
         {
-            const size_t begin = jobIndex * chunkSize;
-            const size_t end = std::min(begin + chunkSize, objects.size());
-
+            // Один кэш на кусок: соседние объекты обычно делят PSO/RS/сэмплеры/меш
+            BindStateCache cache;
             if (useBundles) {
                 auto b = renderer->BeginThreadCommandBundle(nullptr);
                 for (size_t i = begin; i < end; ++i) {
-                    if (auto* obj = objects[i]) obj->Render(renderer, b.cl, view, proj);
+                    if (auto* obj = objects[i]) obj->Render(renderer, b.cl, view, proj, cache);
                 }
                 renderer->EndThreadCommandBundle(b, batchIndex);
             }
@@ -502,11 +627,12 @@ void Scene::RenderObjectBatch(Renderer* renderer,
                 }
                 
                 for (size_t i = begin; i < end; ++i) {
-                    if (auto* obj = objects[i]) obj->Render(renderer, t.cl, view, proj);
+                    if (auto* obj = objects[i]) obj->Render(renderer, t.cl, view, proj, cache);
                 }
                 renderer->EndThreadCommandList(t, batchIndex);
             }
-        }, 1);
+            renderer->AddBindStats(cache.Issued(), cache.Skipped());
+        }, TaskSystem::kAutoGrain, tuner);
 }
 
 void Scene::Clear()
@@ -518,4 +644,8 @@ void Scene::Clear()
     matSSR_.reset();
     objects_.clear();
     skyBox_.reset();
+    frameGraph_.Clear();
+    gbufferGraph_.Clear();
+    transparentGraph_.Clear();
+    asyncComputeObjects_.clear();
 }
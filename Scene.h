@@ -7,6 +7,9 @@
 #include "Camera.h"
 #include "InputManager.h"
 #include "Skybox.h"
+#include "TaskSystem.h"
+#include "RenderGraph.h"
+#include "FrustumCulling.h"
 
 class Renderer;
 
@@ -22,11 +25,20 @@ public:
     void Tick(float deltaTime);
     void Render(Renderer* renderer);
 
+    // Кадр целиком. В конвейерном режиме Tick следующего кадра идёт на воркерах параллельно
+    // с записью текущего (время кадра ~ max(sim, record), картинка отстаёт от симуляции на кадр)
+    void RunFrame(Renderer* renderer, float deltaTime);
+    void SetPipelinedFrames(bool enabled) { pipelinedFrames_ = enabled; }
+    bool GetPipelinedFrames() const { return pipelinedFrames_; }
+
     void Clear();
 
 private:
+    void LaunchTick_(TaskGroup& group, float deltaTime);
+    void PublishRenderState_();
+
     void RenderObjectBatch(Renderer* renderer, const std::vector<RenderableObjectBase*>& objects, size_t batchIndex,
-        const mat4& view, const mat4& proj, bool useCommandBundle, bool bindGbufOrScene);
+        const mat4& view, const mat4& proj, bool useCommandBundle, bool bindGbufOrScene, ParallelForTuner* tuner);
     
     std::shared_ptr<Material> matLighting_;
     std::shared_ptr<Material> matCompose_;
@@ -39,5 +51,35 @@ private:
     ActionMap* actions_ = nullptr;
     Camera camera_;
 
+    // Опубликованная камера: Render не трогает camera_, которую двигает Tick
+    mat4   renderView_;
+    float3 renderCamPos_;
+
+    bool pipelinedFrames_ = true;
+    bool reflectionsEnabled_ = true; // выкл. — SSR-пассы отсекает граф
+
     std::unique_ptr<Skybox> skyBox_;
+
+    // Авто-грейн ParallelFor между кадрами: тики и запись по видам объектов (ObjectRenderType)
+    ParallelForTuner tickTuner_;
+    ParallelForTuner publishTuner_;
+    ParallelForTuner renderTuners_[4];
+    ParallelForTuner boundsTuner_;
+    ParallelForTuner cullTuner_;
+
+    // Отсечение по пирамиде: SoA мировых AABB по индексу в objects_, между кадрами без аллокаций
+    FrustumCuller culler_;
+    FrustumCuller::Stats cullStats_;
+
+    // Графы кадра живут между кадрами: каждый кадр только перепривязываются колбэки,
+    // топология и план барьеров — из кэша (вложенные — для GBuffer/Transparent)
+    RenderGraph frameGraph_;
+    RenderGraph gbufferGraph_;
+    RenderGraph transparentGraph_;
+
+    // scratch кадра: объекты с async compute и списки доступов пассов, которые их касаются
+    std::vector<RenderableObjectBase*> asyncComputeObjects_;
+    std::vector<RenderGraph::ResourceAccess> computeAccesses_;
+    std::vector<RenderGraph::ResourceAccess> gbufferAccesses_;
+    std::vector<RenderGraph::ResourceAccess> transparentAccesses_;
 };
@@ -1,24 +1,85 @@
 #include "TaskSystem.h"
 #include <algorithm>
+#include <chrono>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Подсказка ядру "крутимся в ожидании": меньше греем и не мешаем гипертреду-соседу
+static inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
 
 thread_local std::size_t TaskSystem::tlsIndex_ = static_cast<std::size_t>(-1);
+thread_local TaskSystem* TaskSystem::tlsOwner_ = nullptr;
+thread_local TaskPriority TaskSystem::tlsPriority_ = TaskPriority::Normal;
+thread_local const CancellationToken* TaskSystem::tlsCancel_ = nullptr;
+thread_local const TaskGroup* TaskSystem::tlsRoot_ = nullptr;
+
+TaskGroup::TaskGroup(TaskPriority priority) : priority_(priority) {
+    if (TaskSystem::tlsRoot_) {
+        root_ = TaskSystem::tlsRoot_;
+    }
+}
 
 TaskSystem& TaskSystem::Get() {
+    // Пул создаём раньше системы: разрушится позже неё (Stop() ещё отпускает задачи)
+    JobPool_();
     static TaskSystem g;
     return g;
 }
 
+NodePool<TaskSystem::Job_>& TaskSystem::JobPool_() {
+    static NodePool<Job_> pool;
+    return pool;
+}
+
+TaskSystem::Stats TaskSystem::GetStats() const {
+    Stats s;
+    s.jobBlocks = JobPool_().BlocksAllocated();
+    s.dispatchBlocks = dispatchPool_.BlocksAllocated() + forPool_.BlocksAllocated();
+    s.continuationAllocs = continuationAllocs_.load(std::memory_order_relaxed);
+    s.callableHeapFallbacks = InlineFunctionStats::heapFallbacks.load(std::memory_order_relaxed);
+    s.spinHits = spinHits_.load(std::memory_order_relaxed);
+    s.parks = parks_.load(std::memory_order_relaxed);
+    s.cancelledDrops = cancelledDrops_.load(std::memory_order_relaxed);
+    return s;
+}
+
 TaskSystem::~TaskSystem() {
     Stop();
 }
 
 void TaskSystem::Start(unsigned threadCount) {
-    std::lock_guard<std::mutex> lk(mtx_);
+    Config cfg;
+    cfg.threadCount = threadCount;
+    Start(cfg);
+}
+
+void TaskSystem::Start(const Config& config) {
+    std::lock_guard<std::mutex> lk(startStopMtx_);
     if (running_) {
         return;
     }
 
     running_ = true;
+    config_ = config;
+    unsigned threadCount = config.threadCount;
 
     if (threadCount == 0) {
         unsigned hc = std::thread::hardware_concurrency();
@@ -28,22 +89,35 @@ void TaskSystem::Start(unsigned threadCount) {
         threadCount = std::max(1u, hc - 1u); // один поток оставим главному
     }
 
+    // Локальные деки создаём до старта потоков: воры обращаются к ним по индексу
+    locals_.clear();
+    locals_.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        locals_.push_back(std::make_unique<Worker_>());
+        locals_.back()->rng = 0x9E3779B9u * (i + 1u);
+    }
+
     workers_.reserve(threadCount);
     for (unsigned i = 0; i < threadCount; ++i) {
         workers_.emplace_back([this, i]() {
             tlsIndex_ = i;
+            tlsOwner_ = this;
+            SetupWorkerThread_(i);
             WorkerLoop_(i);
         });
     }
 }
 
 void TaskSystem::Stop() {
+    std::lock_guard<std::mutex> startLk(startStopMtx_);
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+
     {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (!running_) {
-            return;
-        }
-        running_ = false;
+        std::lock_guard<std::mutex> lk(parkMtx_);
+        workEpoch_.fetch_add(1, std::memory_order_seq_cst);
     }
     cvWork_.notify_all();
 
@@ -54,106 +128,861 @@ void TaskSystem::Stop() {
     }
     workers_.clear();
 
-    // Очистим очередь (на всякий случай)
-    {
-        std::lock_guard<std::mutex> lk(mtx_);
-        while (!queue_.empty()) {
-            queue_.pop();
+    // Очистим очередь (на всякий случай): воркеры дорабатывают всё, что видят, но внешний
+    // Submit мог проскочить между проверкой running_ и остановкой
+    // Продолжения отпущенных задач снова попадают в очередь — крутим, пока не опустеет
+    for (;;) {
+        Job_* leftovers = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(injectMtx_);
+            JobList_ all;
+            for (std::size_t lane = 0; lane < kPriorityCount; ++lane) {
+                if (injected_[lane].head) {
+                    all.Splice(injected_[lane].head, injected_[lane].tail);
+                }
+                injected_[lane] = {};
+                injectedCount_[lane].store(0, std::memory_order_relaxed);
+            }
+            leftovers = all.head;
+        }
+        if (!leftovers) {
+            break;
+        }
+        while (leftovers) {
+            Job_* job = leftovers;
+            leftovers = job->next;
+            // Не выполняем, но отпускаем счётчики, чтобы ждущие группы не повисли
+            job->fn = nullptr;
+            if (job->priority == TaskPriority::Background) {
+                backgroundRunning_.fetch_add(1, std::memory_order_relaxed); // Run_ отпустит "слот"
+            }
+            Run_(job);
         }
     }
+    locals_.clear();
 }
 
 void TaskSystem::Submit(const Task& t) {
-    {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (!running_) {
-            return;
+    if (!running_) {
+        return;
+    }
+    Enqueue_(NewJob_(Task(t), nullptr, TaskPriority::Normal));
+}
+
+void TaskSystem::Submit(Task&& t) {
+    if (!running_) {
+        return;
+    }
+    Enqueue_(NewJob_(std::move(t), nullptr, TaskPriority::Normal));
+}
+
+void TaskSystem::Submit(Task&& t, TaskPriority priority) {
+    if (!running_) {
+        return;
+    }
+    Enqueue_(NewJob_(std::move(t), nullptr, priority));
+}
+
+void TaskSystem::Submit(TaskGroup& group, Task&& t) {
+    if (!running_) {
+        return;
+    }
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    Enqueue_(NewJob_(std::move(t), &group, group.priority_));
+}
+
+void TaskSystem::Submit(Task&& t, const TaskOptions& options) {
+    if (!running_) {
+        return;
+    }
+    Enqueue_(NewJob_(std::move(t), nullptr, options.priority, options));
+}
+
+void TaskSystem::Submit(TaskGroup& group, Task&& t, const TaskOptions& options) {
+    if (!running_) {
+        return;
+    }
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    Enqueue_(NewJob_(std::move(t), &group, group.priority_, options));
+}
+
+bool TaskSystem::IsCurrentTaskCancelled() {
+    return tlsCancel_ && tlsCancel_->IsCancelled();
+}
+
+TaskHandle TaskSystem::Submit(Task&& t, std::span<const TaskHandle> deps) {
+    return SubmitWithDeps_(nullptr, std::move(t), deps);
+}
+
+TaskHandle TaskSystem::Submit(Task&& t, std::initializer_list<TaskHandle> deps) {
+    return SubmitWithDeps_(nullptr, std::move(t), std::span<const TaskHandle>(deps.begin(), deps.size()));
+}
+
+TaskHandle TaskSystem::Submit(TaskGroup& group, Task&& t, std::span<const TaskHandle> deps) {
+    return SubmitWithDeps_(&group, std::move(t), deps);
+}
+
+TaskHandle TaskSystem::Submit(TaskGroup& group, Task&& t, std::initializer_list<TaskHandle> deps) {
+    return SubmitWithDeps_(&group, std::move(t), std::span<const TaskHandle>(deps.begin(), deps.size()));
+}
+
+TaskHandle TaskSystem::SubmitWithDeps_(TaskGroup* group, Task&& t, std::span<const TaskHandle> deps) {
+    if (!running_) {
+        return {};
+    }
+
+    Job_* job = NewJob_(std::move(t), group, group ? group->priority_ : TaskPriority::Normal);
+    job->refs.store(2, std::memory_order_relaxed); // планировщик + возвращаемый handle
+
+    // Учитываем сразу, а не при постановке в очередь: Wait(group)/WaitForAll видят
+    // и ещё не готовые задачи
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    if (group) {
+        group->pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // +1 "защитный": пока подписываемся, задачу не запустит успевший завершиться пререквизит
+    job->pendingDeps.store(static_cast<int32_t>(deps.size()) + 1, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < deps.size(); ++i) {
+        Job_* prereq = deps[i].job_;
+        if (!prereq) {
+            job->pendingDeps.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        Continuation_* link = nullptr;
+        if (i < kInlineDeps) {
+            link = &job->links[i];
+            link->heap = false;
         }
-        queue_.push(t);
-        inFlight_.fetch_add(1, std::memory_order_relaxed);
+        else {
+            continuationAllocs_.fetch_add(1, std::memory_order_relaxed);
+            link = new Continuation_{};
+            link->heap = true;
+        }
+        link->job = job;
+        if (!AddContinuation_(prereq, link)) {
+            if (link->heap) {
+                delete link;
+            }
+            job->pendingDeps.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    ResolveDependency_(job);
+
+    return TaskHandle(job);
+}
+
+bool TaskSystem::AddContinuation_(Job_* prereq, Continuation_* node) {
+    Continuation_* head = prereq->continuations.load(std::memory_order_acquire);
+    do {
+        if (head == ClosedList_()) {
+            return false; // пререквизит уже завершён
+        }
+        node->next = head;
+    } while (!prereq->continuations.compare_exchange_weak(head, node,
+        std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+}
+
+void TaskSystem::ResolveDependency_(Job_* job) {
+    if (job->pendingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Push_(job);
+    }
+}
+
+void TaskSystem::Release_(Job_* job) {
+    if (job->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        JobPool_().Release(job);
+    }
+}
+
+TaskSystem::Job_* TaskSystem::NewJob_(Task&& fn, TaskGroup* group, TaskPriority priority) {
+    Job_* job = JobPool_().Acquire();
+    job->fn = std::move(fn);
+    job->group = group;
+    job->root.store(group ? group->root_ : nullptr, std::memory_order_relaxed);
+    job->priority = priority;
+    job->refs.store(1, std::memory_order_relaxed);
+    job->pendingDeps.store(0, std::memory_order_relaxed);
+    job->continuations.store(nullptr, std::memory_order_relaxed);
+    job->done.store(false, std::memory_order_relaxed);
+    job->watched.store(false, std::memory_order_relaxed);
+    job->deadline = kNoDeadline;
+    return job;
+}
+
+TaskSystem::Job_* TaskSystem::NewJob_(Task&& fn, TaskGroup* group, TaskPriority priority, const TaskOptions& options) {
+    Job_* job = NewJob_(std::move(fn), group, priority);
+    job->cancel = options.cancel;
+    job->deadline = options.deadline;
+    return job;
+}
+
+void TaskSystem::Enqueue_(Job_* job) {
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    Push_(job);
+}
+
+void TaskSystem::Push_(Job_* job) {
+    const std::size_t lane = static_cast<std::size_t>(job->priority);
+    if (lane < kDequeLanes && IsWorkerThread_()) {
+        // Воркер: в свой дек без локов
+        locals_[tlsIndex_]->deques[lane].Push(job);
+    }
+    else {
+        // Внешний поток или фоновая задача (у фоновых своих деков нет).
+        // Фоновая очередь упорядочена по сроку: устаревающая раньше работа стартует раньше
+        std::lock_guard<std::mutex> lk(injectMtx_);
+        if (job->priority == TaskPriority::Background) {
+            injected_[lane].InsertByDeadline(job);
+        }
+        else {
+            injected_[lane].PushBack(job);
+        }
+        injectedCount_[lane].fetch_add(1, std::memory_order_release);
+    }
+    WakeWorkers_();
+}
+
+void TaskSystem::WakeWorkers_() {
+    // seq_cst в паре с WorkerLoop_/HelpUntil_: либо мы увидим спящего, либо он увидит нашу работу
+    workEpoch_.fetch_add(1, std::memory_order_seq_cst);
+
+    // Ждущие в Wait() тоже могут помочь с новой работой
+    if (waitersSleeping_.load(std::memory_order_seq_cst) != 0u) {
+        {
+            std::lock_guard<std::mutex> lk(waitMtx_);
+        }
+        cvWait_.notify_all();
+    }
+
+    // Крутящийся воркер подберёт работу сам, а дальше разбудит следующего (CascadeWake_).
+    // Сами будим максимум одного: сколько бы задач ни пришло, поставщик (обычно главный
+    // поток) платит за один notify, а не за N.
+    if (spinning_.load(std::memory_order_seq_cst) != 0u) {
+        return;
+    }
+    if (sleeping_.load(std::memory_order_seq_cst) == 0u) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(parkMtx_);
     }
     cvWork_.notify_one();
 }
 
-void TaskSystem::Submit(Task&& t) {
+void TaskSystem::CascadeWake_() {
+    // Вызывается воркером, только что вышедшим из простоя с задачей на руках:
+    // если в очередях осталось ещё — передаём эстафету следующему
+    if (spinning_.load(std::memory_order_seq_cst) != 0u ||
+        sleeping_.load(std::memory_order_seq_cst) == 0u ||
+        !HasVisibleWork_()) {
+        return;
+    }
     {
-        std::lock_guard<std::mutex> lk(mtx_);
-        if (!running_) {
-            return;
-        }
-        queue_.push(std::move(t));
-        inFlight_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lk(parkMtx_);
     }
     cvWork_.notify_one();
 }
 
 void TaskSystem::Dispatch(std::size_t jobCount,
-                          std::function<void(std::size_t)> fn,
+                          DispatchFn fn,
                           std::size_t batchSize) {
-    if (jobCount == 0 || !fn) {
+    DispatchImpl_(nullptr, jobCount, std::move(fn), batchSize);
+}
+
+void TaskSystem::Dispatch(TaskGroup& group,
+                          std::size_t jobCount,
+                          DispatchFn fn,
+                          std::size_t batchSize) {
+    DispatchImpl_(&group, jobCount, std::move(fn), batchSize);
+}
+
+void TaskSystem::DispatchImpl_(TaskGroup* group, std::size_t jobCount,
+                               DispatchFn&& fn,
+                               std::size_t batchSize) {
+    if (jobCount == 0 || !fn || !running_) {
         return;
     }
     if (batchSize == 0) {
         batchSize = 1;
     }
 
-    // Держим fn живой даже после выхода из Dispatch
-    auto fnShared = std::make_shared<std::function<void(std::size_t)>>(std::move(fn));
-
     const std::size_t batches = (jobCount + batchSize - 1) / batchSize;
+
+    // Тело держим в пуловом блоке, пока его не отпустит последний батч
+    DispatchBlock_* blk = dispatchPool_.Acquire();
+    blk->fn = std::move(fn);
+    blk->refs.store(batches, std::memory_order_relaxed);
+
+    inFlight_.fetch_add(batches, std::memory_order_relaxed);
+    if (group) {
+        group->pending_.fetch_add(batches, std::memory_order_relaxed);
+    }
+
+    const TaskPriority priority = group ? group->priority_ : TaskPriority::Normal;
+    const std::size_t lane = static_cast<std::size_t>(priority);
+    const bool toLocal = lane < kDequeLanes && IsWorkerThread_();
+    JobList_ chain;
+
     for (std::size_t b = 0; b < batches; ++b) {
         const std::size_t begin = b * batchSize;
         const std::size_t end = std::min(jobCount, begin + batchSize);
 
-        Submit([begin, end, fnShared]() {
+        Job_* job = NewJob_([this, blk, begin, end]() {
             for (std::size_t i = begin; i < end; ++i) {
-                (*fnShared)(i);
+                blk->fn(i);
             }
+            if (blk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                blk->fn = nullptr;
+                dispatchPool_.Release(blk);
+            }
+            }, group, priority);
+
+        if (toLocal) {
+            locals_[tlsIndex_]->deques[lane].Push(job);
+        }
+        else {
+            chain.PushBack(job);
+        }
+    }
+
+    if (!toLocal) {
+        // Один лок на весь пакет вместо лока на каждую задачу
+        std::lock_guard<std::mutex> lk(injectMtx_);
+        injected_[lane].Splice(chain.head, chain.tail);
+        injectedCount_[lane].fetch_add(batches, std::memory_order_release);
+    }
+    WakeWorkers_();
+}
+
+// Блокирующий цикл наследует приоритет текущей задачи, но не ниже Normal: из фоновой задачи
+// подзадачи ушли бы в фоновую полосу, а её слоты (при 2 воркерах — единственный) заняты
+// самим вызывающим, который ждёт группу и фоновое не берёт — вечное ожидание
+TaskPriority TaskSystem::BlockingForPriority_() {
+    return tlsPriority_ == TaskPriority::Background ? TaskPriority::Normal : tlsPriority_;
+}
+
+void TaskSystem::ParallelFor(std::size_t begin, std::size_t end, DispatchFn fn,
+                             std::size_t grain, ParallelForTuner* tuner) {
+    if (begin >= end || !fn) {
+        return;
+    }
+    TaskGroup group(BlockingForPriority_());
+    ForBlock_* blk = NewForBlock_(std::move(fn), nullptr, grain, tuner);
+    RunForRange_(blk, begin, end, &group); // вызывающий поток работает сам, делясь с простаивающими
+    group.Wait();
+}
+
+void TaskSystem::ParallelForRange(std::size_t begin, std::size_t end, RangeFn fn,
+                                  std::size_t grain, ParallelForTuner* tuner) {
+    if (begin >= end || !fn) {
+        return;
+    }
+    TaskGroup group(BlockingForPriority_());
+    ForBlock_* blk = NewForBlock_(nullptr, std::move(fn), grain, tuner);
+    RunForRange_(blk, begin, end, &group);
+    group.Wait();
+}
+
+void TaskSystem::ParallelFor(TaskGroup& group, std::size_t begin, std::size_t end, DispatchFn fn,
+                             std::size_t grain, ParallelForTuner* tuner) {
+    if (begin >= end || !fn || !running_) {
+        return;
+    }
+    SpawnForRange_(NewForBlock_(std::move(fn), nullptr, grain, tuner), begin, end, &group);
+}
+
+void TaskSystem::ParallelForRange(TaskGroup& group, std::size_t begin, std::size_t end, RangeFn fn,
+                                  std::size_t grain, ParallelForTuner* tuner) {
+    if (begin >= end || !fn || !running_) {
+        return;
+    }
+    SpawnForRange_(NewForBlock_(nullptr, std::move(fn), grain, tuner), begin, end, &group);
+}
+
+TaskSystem::ForBlock_* TaskSystem::NewForBlock_(DispatchFn&& index, RangeFn&& range,
+                                                std::size_t grain, ParallelForTuner* tuner) {
+    ForBlock_* blk = forPool_.Acquire();
+    blk->index = std::move(index);
+    blk->range = std::move(range);
+    blk->refs.store(1, std::memory_order_relaxed);
+    blk->autoGrain = (grain == kAutoGrain);
+    blk->tuner = tuner;
+
+    std::size_t g = grain;
+    if (blk->autoGrain) {
+        // Стартуем с прошлого измерения, если оно есть; иначе — с одного элемента
+        g = tuner ? tuner->grain.load(std::memory_order_relaxed) : 0;
+    }
+    blk->grain.store(std::max<std::size_t>(1, g), std::memory_order_relaxed);
+    return blk;
+}
+
+void TaskSystem::SpawnForRange_(ForBlock_* blk, std::size_t begin, std::size_t end, TaskGroup* group) {
+    Job_* job = NewJob_([this, blk, begin, end, group]() {
+        RunForRange_(blk, begin, end, group);
+        }, group, group ? group->priority_ : tlsPriority_);
+    inFlight_.fetch_add(1, std::memory_order_relaxed);
+    if (group) {
+        group->pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Push_(job);
+}
+
+bool TaskSystem::WantsSplit_() const {
+    if (locals_.size() <= 1 || !running_) {
+        return false;
+    }
+    if (IsWorkerThread_()) {
+        // Свои деки пусты — ворам нечего взять, делимся половиной
+        const Worker_& w = *locals_[tlsIndex_];
+        return w.deques[0].Empty() && w.deques[1].Empty();
+    }
+    // Внешний поток: своего дека нет, ориентируемся на простаивающих воркеров
+    return sleeping_.load(std::memory_order_relaxed) + spinning_.load(std::memory_order_relaxed) != 0u;
+}
+
+void TaskSystem::RunForRange_(ForBlock_* blk, std::size_t begin, std::size_t end, TaskGroup* group) {
+    using Clock = std::chrono::steady_clock;
+
+    while (begin < end) {
+        const std::size_t grain = blk->grain.load(std::memory_order_relaxed);
+
+        // Ленивое деление: правую половину — в очередь, левую продолжаем сами
+        while (end - begin > grain && WantsSplit_()) {
+            const std::size_t mid = begin + (end - begin) / 2;
+            blk->refs.fetch_add(1, std::memory_order_relaxed);
+            SpawnForRange_(blk, mid, end, group);
+            end = mid;
+        }
+
+        const std::size_t chunkEnd = std::min(end, begin + grain);
+        const auto t0 = blk->autoGrain ? Clock::now() : Clock::time_point{};
+
+        if (blk->range) {
+            blk->range(begin, chunkEnd);
+        }
+        else {
+            for (std::size_t i = begin; i < chunkEnd; ++i) {
+                blk->index(i);
+            }
+        }
+
+        if (blk->autoGrain) {
+            // Мультипликативная подстройка к целевой длительности куска (не больше чем x2 за шаг);
+            // так учитываются и постоянные накладные тела (открытие CL и т.п.)
+            // Хвост отрезка короче grain — по нему растить grain нельзя
+            const std::size_t items = chunkEnd - begin;
+            const double ns = std::max(1.0, std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+            const double scaled = double(items) * kTargetChunkNs / ns;
+            const double clamped = std::clamp(scaled, double(grain) * 0.5,
+                double(std::max(grain, 2 * items)));
+            blk->grain.store(std::max<std::size_t>(1, std::size_t(clamped + 0.5)), std::memory_order_relaxed);
+        }
+        begin = chunkEnd;
+    }
+
+    if (blk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (blk->tuner && blk->autoGrain) {
+            blk->tuner->grain.store(blk->grain.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        blk->index = nullptr;
+        blk->range = nullptr;
+        forPool_.Release(blk);
+    }
+}
+
+template<typename Pred>
+void TaskSystem::HelpUntil_(Pred done, const TaskGroup* only, bool allowBackground) {
+    // Вызывающий поток не спит, пока есть подходящая работа: исполняет её сам.
+    // Это и ускоряет ожидание, и не даёт вложенному Wait() из воркера занять поток впустую.
+    // only != nullptr — корень группы: из общей очереди (внешний поток — и из чужих деков)
+    // берём только её задачи: чужая долгая задача (FS-probe, тик) иначе застряла бы на стеке
+    // ждущего и держала бы его Wait().
+    while (!done()) {
+        if (Job_* job = FindWorkAsHelper_(only, allowBackground)) {
+            Run_(job);
+            continue;
+        }
+
+        // Наши задачи уже разобраны другими потоками — спим до их завершения или новой работы.
+        // Протокол тот же, что у парковки воркеров (см. WorkerLoop_).
+        waitersSleeping_.fetch_add(1, std::memory_order_seq_cst);
+        const uint64_t epoch = workEpoch_.load(std::memory_order_seq_cst);
+
+        if (!done() && !HasWorkFor_(only, allowBackground)) {
+            std::unique_lock<std::mutex> lk(waitMtx_);
+            cvWait_.wait(lk, [&]() {
+                return done() || workEpoch_.load(std::memory_order_seq_cst) != epoch;
             });
+        }
+        waitersSleeping_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void TaskGroup::Wait() {
+    TaskSystem::Get().Wait(*this);
+}
+
+void TaskSystem::Wait(TaskGroup& group) {
+    HelpUntil_([&group]() {
+        return group.pending_.load(std::memory_order_seq_cst) == 0;
+    }, group.root_, false);
+}
+
+void TaskSystem::Wait(const TaskHandle& handle) {
+    Job_* job = handle.job_;
+    if (!job) {
+        return;
     }
+    // watched — чтобы Run_ будил ждущих только ради задач, которые кто-то ждёт
+    job->watched.store(true, std::memory_order_seq_cst);
+    HelpUntil_([job]() {
+        return job->done.load(std::memory_order_seq_cst);
+    }, job->root.load(std::memory_order_relaxed), false);
 }
 
 void TaskSystem::WaitForAll() {
-    std::unique_lock<std::mutex> lk(mtx_);
-    cvIdle_.wait(lk, [this]() {
-        return (inFlight_.load(std::memory_order_acquire) == 0) && queue_.empty();
-    });
+    HelpUntil_([this]() {
+        return inFlight_.load(std::memory_order_seq_cst) == 0;
+    }, nullptr, true);
 }
 
 std::size_t TaskSystem::ThreadIndex() const {
     return tlsIndex_;
 }
 
-void TaskSystem::WorkerLoop_(std::size_t /*index*/) {
-    for (;;) {
-        Task task;
+TaskSystem::Job_* TaskSystem::PopInjected_(std::size_t lane, const TaskGroup* only) {
+    if (injectedCount_[lane].load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lk(injectMtx_);
+    Job_* j = injected_[lane].PopFirst(only);
+    if (j) {
+        injectedCount_[lane].fetch_sub(1, std::memory_order_relaxed);
+    }
+    return j;
+}
 
-        {
-            std::unique_lock<std::mutex> lk(mtx_);
-            cvWork_.wait(lk, [this]() {
-                return !running_ || !queue_.empty();
-            });
+std::size_t TaskSystem::BackgroundSlots_() const {
+    // Хотя бы один воркер всегда свободен для работы кадра
+    return locals_.size() > 1 ? locals_.size() - 1 : 1;
+}
+
+TaskSystem::Job_* TaskSystem::PopBackground_() {
+    constexpr std::size_t lane = static_cast<std::size_t>(TaskPriority::Background);
+    if (injectedCount_[lane].load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    // Занимаем слот до того, как снимем задачу; слот отпускает Run_
+    std::size_t running = backgroundRunning_.load(std::memory_order_relaxed);
+    do {
+        if (running >= BackgroundSlots_()) {
+            return nullptr;
+        }
+    } while (!backgroundRunning_.compare_exchange_weak(running, running + 1,
+        std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    Job_* j = PopInjected_(lane);
+    if (!j) {
+        backgroundRunning_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+TaskSystem::Job_* TaskSystem::StealFromOthers_(std::size_t lane, std::size_t self, uint32_t& rng,
+                                               const TaskGroup* only) {
+    const std::size_t n = locals_.size();
+    if (n == 0 || (n == 1 && self == 0)) {
+        return nullptr;
+    }
+
+    // Случайная жертва, дальше — по кругу
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    const std::size_t start = rng % n;
+
+    Job_* j = nullptr;
+    for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t victim = (start + k) % n;
+        if (victim == self) {
+            continue;
+        }
+        if (!only) {
+            if (locals_[victim]->deques[lane].Steal(j)) {
+                return j;
+            }
+        }
+        else if (locals_[victim]->deques[lane].StealIf(j, [only](const Job_* c) {
+            return c->root.load(std::memory_order_relaxed) == only;
+        })) {
+            return j;
+        }
+    }
+    return nullptr;
+}
+
+TaskSystem::Job_* TaskSystem::FindWork_(std::size_t self) {
+    // Строго по убыванию приоритета: кадровая работа (своя, общая, чужая) вытесняет обычную,
+    // обычная — фоновую. Фоновая стоит в очереди и не мешает, пока выше что-то есть.
+    Worker_& w = *locals_[self];
+    Job_* j = nullptr;
+    for (std::size_t lane = 0; lane < kDequeLanes; ++lane) {
+        if (w.deques[lane].Pop(j)) {
+            return j;
+        }
+        if ((j = PopInjected_(lane)) != nullptr) {
+            return j;
+        }
+        if ((j = StealFromOthers_(lane, self, w.rng)) != nullptr) {
+            return j;
+        }
+    }
+    return PopBackground_();
+}
+
+TaskSystem::Job_* TaskSystem::FindWorkAsHelper_(const TaskGroup* only, bool allowBackground) {
+    // Фильтр only — по корню группы: своя группа и всё, что породили её задачи.
+    // Воркер свой дек снимает и крадёт без фильтра: деки общие для всех групп, а ждущий
+    // воркер и так исполнил бы эти задачи после возврата. Внешний поток (main) фильтрует и
+    // кражу: иначе Wait(frameTasks) на главном потоке исполнил бы тик или чужую работу кадра.
+    // Фоновые задачи ждущий берёт только в WaitForAll: иначе долгая фоновая задача
+    // застряла бы на стеке главного потока посреди кадра.
+    const bool isWorker = IsWorkerThread_();
+    // Внешний поток (main): своего дека нет, свой генератор для выбора жертвы
+    thread_local uint32_t externalRng = 0x85EBCA6Bu;
+    uint32_t& rng = isWorker ? locals_[tlsIndex_]->rng : externalRng;
+    const std::size_t self = isWorker ? tlsIndex_ : static_cast<std::size_t>(-1);
+
+    Job_* j = nullptr;
+    for (std::size_t lane = 0; lane < kDequeLanes; ++lane) {
+        if (isWorker && locals_[tlsIndex_]->deques[lane].Pop(j)) {
+            return j;
+        }
+        if ((j = PopInjected_(lane, only)) != nullptr) {
+            return j;
+        }
+        if ((j = StealFromOthers_(lane, self, rng, isWorker ? nullptr : only)) != nullptr) {
+            return j;
+        }
+    }
+    return allowBackground ? PopBackground_() : nullptr;
+}
+
+bool TaskSystem::HasVisibleWork_(bool includeBackground) const {
+    for (std::size_t lane = 0; lane < kDequeLanes; ++lane) {
+        if (injectedCount_[lane].load(std::memory_order_acquire) != 0) {
+            return true;
+        }
+    }
+    for (const auto& w : locals_) {
+        for (const auto& dq : w->deques) {
+            if (!dq.Empty()) {
+                return true;
+            }
+        }
+    }
+    if (!includeBackground) {
+        return false;
+    }
+    // Фоновая работа "видна", только если под неё есть свободный слот
+    constexpr std::size_t bg = static_cast<std::size_t>(TaskPriority::Background);
+    return injectedCount_[bg].load(std::memory_order_acquire) != 0 &&
+           backgroundRunning_.load(std::memory_order_acquire) < BackgroundSlots_();
+}
 
-            if (!running_ && queue_.empty()) {
-                break;
+bool TaskSystem::HasWorkFor_(const TaskGroup* only, bool allowBackground) const {
+    if (!only) {
+        return HasVisibleWork_(allowBackground);
+    }
+    // Как в FindWorkAsHelper_: воркеру годится любой дек, внешнему потоку — только
+    // верх дека из своей группы (кража берёт только верх)
+    const bool isWorker = IsWorkerThread_();
+    for (const auto& w : locals_) {
+        for (const auto& dq : w->deques) {
+            Job_* top = nullptr;
+            if (dq.PeekTop(top) && (isWorker || top->root.load(std::memory_order_relaxed) == only)) {
+                return true;
             }
+        }
+    }
+    std::lock_guard<std::mutex> lk(injectMtx_);
+    for (std::size_t lane = 0; lane < kDequeLanes; ++lane) {
+        if (injected_[lane].Contains(only)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskSystem::Run_(Job_* job) {
+    const TaskPriority priority = job->priority;
 
-            task = std::move(queue_.front());
-            queue_.pop();
+    // Выполняем за пределами любых локов. Приоритет задачи виден вложенным
+    // блокирующим ParallelFor (их подзадачи идут в том же классе).
+    // Отменённую до старта задачу выбрасываем: счётчики и продолжения — как у выполненной
+    if (job->fn) {
+        if (job->cancel.IsCancelled()) {
+            cancelledDrops_.fetch_add(1, std::memory_order_relaxed);
         }
+        else {
+            const TaskPriority outer = tlsPriority_;
+            const CancellationToken* outerCancel = tlsCancel_;
+            const TaskGroup* outerRoot = tlsRoot_;
+            tlsPriority_ = priority;
+            tlsCancel_ = &job->cancel;
+            tlsRoot_ = job->root.load(std::memory_order_relaxed);
+            job->fn();
+            tlsPriority_ = outer;
+            tlsCancel_ = outerCancel;
+            tlsRoot_ = outerRoot;
+        }
+    }
+    job->fn = nullptr; // захваченное освобождаем сразу, не дожидаясь последнего handle
+    job->cancel = {};
 
-        // Выполняем за пределами лока
-        if (task) {
-            task();
+    // Закрываем список продолжений и запускаем тех, для кого мы были последним пререквизитом
+    Continuation_* cont = job->continuations.exchange(ClosedList_(), std::memory_order_acq_rel);
+    job->done.store(true, std::memory_order_seq_cst);
+    while (cont) {
+        // Встроенное звено живёт в задаче-потребителе, а та может стартовать и умереть
+        // сразу после ResolveDependency_ — всё нужное читаем заранее
+        Continuation_* next = cont->next;
+        Job_* dependent = cont->job;
+        if (cont->heap) {
+            delete cont;
         }
+        ResolveDependency_(dependent);
+        cont = next;
+    }
 
-        // Обновляем счётчики и будим возможных ждунов
-        const std::size_t left = inFlight_.fetch_sub(1, std::memory_order_acq_rel) - 1;
-        if (left == 0) {
-            std::lock_guard<std::mutex> lk(mtx_);
-            if (queue_.empty()) {
-                cvIdle_.notify_all();
+    TaskGroup* group = job->group;
+    bool wake = job->watched.load(std::memory_order_seq_cst);
+    Release_(job);
+
+    if (priority == TaskPriority::Background) {
+        backgroundRunning_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    // Обновляем счётчики и будим возможных ждунов. После декремента группу не трогаем:
+    // ждущий может сразу выйти из Wait() и разрушить её.
+    if (group && group->pending_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+        wake = true;
+    }
+    if (inFlight_.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+        wake = true;
+    }
+    if (wake && waitersSleeping_.load(std::memory_order_seq_cst) != 0u) {
+        {
+            std::lock_guard<std::mutex> lk(waitMtx_);
+        }
+        cvWait_.notify_all();
+    }
+}
+
+void TaskSystem::WorkerLoop_(std::size_t index) {
+    bool idle = false; // только что вышли из простоя — при находке будим следующего
+    for (;;) {
+        Job_* job = FindWork_(index);
+        if (!job && (config_.spinMicros != 0u || config_.yieldCount != 0u)) {
+            job = SpinForWork_(index);
+            idle = true;
+        }
+        if (job) {
+            if (idle) {
+                idle = false;
+                CascadeWake_();
             }
+            Run_(job);
+            continue;
+        }
+
+        // Работы не видно — паркуемся. Порядок важен: сначала объявляем себя спящим,
+        // потом читаем эпоху и перепроверяем очереди (иначе можно потерять пробуждение).
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        const uint64_t epoch = workEpoch_.load(std::memory_order_seq_cst);
+
+        if (HasVisibleWork_()) {
+            sleeping_.fetch_sub(1, std::memory_order_relaxed);
+            continue;
         }
+        if (!running_) {
+            sleeping_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+
+        parks_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> lk(parkMtx_);
+            cvWork_.wait(lk, [this, epoch]() {
+                return workEpoch_.load(std::memory_order_seq_cst) != epoch || !running_;
+            });
+        }
+        sleeping_.fetch_sub(1, std::memory_order_relaxed);
+        idle = true;
     }
-}
\ No newline at end of file
+}
+
+TaskSystem::Job_* TaskSystem::SpinForWork_(std::size_t index) {
+    using Clock = std::chrono::steady_clock;
+
+    // Пока мы в spinning_, WakeWorkers_ никого не будит: работа достанется нам.
+    // Уходя (с задачей или в сон), счётчик снимаем до объявления себя спящим —
+    // протокол парковки в WorkerLoop_ от этого не меняется.
+    spinning_.fetch_add(1, std::memory_order_seq_cst);
+    Job_* job = nullptr;
+
+    const auto deadline = Clock::now() + std::chrono::microseconds(config_.spinMicros);
+    for (uint32_t iter = 0; running_.load(std::memory_order_relaxed); ++iter) {
+        if (HasVisibleWork_() && (job = FindWork_(index)) != nullptr) {
+            break;
+        }
+        for (int k = 0; k < 32; ++k) {
+            CpuRelax();
+        }
+        // Часы дёргаем не на каждой итерации
+        if ((iter & 7u) == 7u && Clock::now() >= deadline) {
+            break;
+        }
+    }
+
+    for (uint32_t y = 0; !job && y < config_.yieldCount && running_.load(std::memory_order_relaxed); ++y) {
+        std::this_thread::yield();
+        if (HasVisibleWork_()) {
+            job = FindWork_(index);
+        }
+    }
+
+    spinning_.fetch_sub(1, std::memory_order_seq_cst);
+    if (job) {
+        spinHits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void TaskSystem::SetupWorkerThread_(std::size_t index) const {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned core = static_cast<unsigned>((config_.firstCore + index) % cores);
+#if defined(_WIN32)
+    if (config_.nameThreads) {
+        const std::wstring name = L"TaskWorker " + std::to_wstring(index);
+        SetThreadDescription(GetCurrentThread(), name.c_str());
+    }
+    if (config_.pinThreads && core < sizeof(DWORD_PTR) * 8) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+    }
+#elif defined(__linux__)
+    if (config_.nameThreads) {
+        const std::string name = "TaskWorker " + std::to_string(index); // Linux: до 15 символов
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    }
+    if (config_.pinThreads) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)core;
+#endif
+}
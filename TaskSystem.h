@@ -1,37 +1,205 @@
 #pragma once
-#include <functional>
 #include <vector>
+#include <memory>
 #include <thread>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <span>
+#include <initializer_list>
+#include <utility>
+
+#include "WorkStealingDeque.h"
+#include "InlineFunction.h"
+#include "NodePool.h"
+
+class TaskSystem;
+class TaskHandle;
+
+// Классы приоритета. Воркер берёт работу строго по убыванию приоритета;
+// фоновые задачи идут, только когда выше ничего нет, и никогда не занимают все воркеры.
+enum class TaskPriority : uint8_t {
+    FrameCritical = 0, // запись CL, тики — всё, что держит кадр
+    Normal = 1,
+    Background = 2,    // FS-probe, парсинг ассетов, стриминг
+};
+
+// Отмена: источник (держит тот, кто заказал работу) отменяет, токен едет с задачей.
+// Отменённая задача, ещё не начатая, выбрасывается при снятии с очереди; начатая —
+// сама проверяет токен (TaskSystem::IsCurrentTaskCancelled()) и выходит.
+class CancellationToken {
+public:
+    CancellationToken() = default; // пустой — никогда не отменяется
+
+    bool IsCancelled() const { return state_ && state_->load(std::memory_order_acquire); }
+    bool CanBeCancelled() const { return state_ != nullptr; }
+
+private:
+    friend class CancellationSource;
+    explicit CancellationToken(std::shared_ptr<std::atomic<bool>> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<std::atomic<bool>> state_;
+};
+
+class CancellationSource {
+public:
+    CancellationSource() : state_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() { state_->store(true, std::memory_order_release); }
+    bool IsCancelled() const { return state_->load(std::memory_order_acquire); }
+    CancellationToken Token() const { return CancellationToken(state_); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> state_;
+};
+
+// Счётчик "своих" задач: Wait() ждёт только их (а не весь пул, как WaitForAll)
+// и пока ждёт — сам исполняет задачи из очередей. Группу нельзя разрушать до Wait().
+// Группа, созданная внутри задачи, относится к корню группы этой задачи: внешний поток,
+// ждущий корень, помогает и вложенной работе (блокирующие ParallelFor, вложенный граф),
+// но не чужим корням.
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskPriority priority = TaskPriority::Normal);
+    ~TaskGroup() = default;
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void Wait();
+    bool IsDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+    std::size_t Pending() const { return pending_.load(std::memory_order_relaxed); }
+    TaskPriority Priority() const { return priority_; }
+
+private:
+    friend class TaskSystem;
+    std::atomic<std::size_t> pending_{ 0 };
+    TaskPriority             priority_ = TaskPriority::Normal; // наследуют все задачи группы
+    const TaskGroup*         root_ = this; // только для сравнения, не разыменовывается
+};
+
+// Состояние авто-грейна ParallelFor между вызовами (держать рядом с местом вызова)
+struct ParallelForTuner {
+    std::atomic<std::size_t> grain{ 0 }; // 0 — ещё не измерено
+};
 
 class TaskSystem {
 public:
-    using Task = std::function<void()>;
+    // Вызываемые хранятся inline (без кучи), если влезают в буфер
+    using Task = InlineFunction<void(), 64>;
+    // Тело Dispatch живёт в одном пуловом блоке на весь вызов, поэтому буфер побольше
+    using DispatchFn = InlineFunction<void(std::size_t), 192>;
+    // Тело ParallelForRange: получает подотрезок [begin, end)
+    using RangeFn = InlineFunction<void(std::size_t, std::size_t), 192>;
+
+    // grain == kAutoGrain: размер куска подбирается по измеренной стоимости элемента
+    static constexpr std::size_t kAutoGrain = 0;
+
+    using Clock = std::chrono::steady_clock;
+    static constexpr Clock::time_point kNoDeadline = Clock::time_point::max();
+
+    // Необязательные свойства задачи (стриминг и прочая работа, которая может устареть).
+    // deadline упорядочивает фоновую очередь: раньше срок — раньше старт; задачи без срока
+    // идут после всех со сроком, между собой — FIFO. В кадровых лейнах срок не влияет.
+    struct TaskOptions {
+        TaskPriority      priority = TaskPriority::Normal; // для Submit в группу берётся приоритет группы
+        CancellationToken cancel;
+        Clock::time_point deadline = kNoDeadline;
+    };
+
+    // Счётчики для проверки "0 аллокаций на задачу" в установившемся режиме
+    struct Stats {
+        uint64_t jobBlocks = 0;         // блоки пула задач
+        uint64_t dispatchBlocks = 0;    // блоки пулов Dispatch/ParallelFor
+        uint64_t continuationAllocs = 0;// звенья продолжений сверх встроенных
+        uint64_t callableHeapFallbacks = 0; // вызываемые, не влезшие в inline-буфер
+        uint64_t spinHits = 0;          // работа нашлась во время spin/yield (без сна и пробуждения)
+        uint64_t parks = 0;             // уходы в сон на cv (каждый стоит пробуждения потом)
+        uint64_t cancelledDrops = 0;    // отменённые задачи, выброшенные без запуска
+    };
+
+    // Настройки пула. Простаивающий воркер сначала крутится (pause), потом отдаёт квант (yield),
+    // и только потом паркуется: короткие паузы между пассами не платят за пробуждение потока,
+    // ценой сожжённого CPU в простое. spinMicros = yieldCount = 0 — сразу в сон.
+    struct Config {
+        unsigned threadCount = 0;     // 0 — по числу ядер минус главный поток
+        uint32_t spinMicros = 50;
+        uint32_t yieldCount = 16;
+        bool     pinThreads = false;  // воркер i -> ядро (firstCore + i) % ядер
+        unsigned firstCore = 1;       // ядро 0 оставляем главному потоку
+        bool     nameThreads = true;  // "TaskWorker N" в отладчике/профайлере
+    };
 
     // Глобальный доступ
     static TaskSystem& Get();
 
     // Запуск/остановка пула
     void Start(unsigned threadCount = 0);
+    void Start(const Config& config);
     void Stop();
 
-    // Постановка задач
+    // Постановка задач: из воркера — в его локальный дек, извне — в общую очередь инъекций
     void Submit(const Task& t);
     void Submit(Task&& t);
+    void Submit(Task&& t, TaskPriority priority);
+
+    // То же, но с учётом в группе (ждать через group.Wait()); приоритет — группы
+    void Submit(TaskGroup& group, Task&& t);
+
+    // С токеном отмены и сроком
+    void Submit(Task&& t, const TaskOptions& options);
+    void Submit(TaskGroup& group, Task&& t, const TaskOptions& options);
+
+    // Для уже начатой задачи: отменили ли её токен (вне задачи и без токена — false)
+    static bool IsCurrentTaskCancelled();
+
+    // Задача с пререквизитами: станет исполнимой, когда завершатся все deps (без блокирующих
+    // ожиданий — последний завершившийся пререквизит сам ставит её в очередь).
+    // Возвращённый handle можно передать как пререквизит дальше.
+    TaskHandle Submit(Task&& t, std::span<const TaskHandle> deps);
+    TaskHandle Submit(Task&& t, std::initializer_list<TaskHandle> deps);
+    TaskHandle Submit(TaskGroup& group, Task&& t, std::span<const TaskHandle> deps);
+    TaskHandle Submit(TaskGroup& group, Task&& t, std::initializer_list<TaskHandle> deps);
 
     // Распараллеливание "N одинаковых работ" батчами (по умолчанию по 1)
     void Dispatch(std::size_t jobCount,
-        std::function<void(std::size_t)> fn,
+        DispatchFn fn,
         std::size_t batchSize = 1);
+    void Dispatch(TaskGroup& group,
+        std::size_t jobCount,
+        DispatchFn fn,
+        std::size_t batchSize = 1);
+
+    // Параллельный цикл с ленивым двоичным делением: отрезок делится пополам, только когда
+    // в локальном деке исполнителя пусто (т.е. простаивающим ворам нечего украсть); иначе
+    // идём кусками по grain. Блокирующие версии исполняют часть работы на вызывающем потоке.
+    void ParallelFor(std::size_t begin, std::size_t end, DispatchFn fn,
+        std::size_t grain = kAutoGrain, ParallelForTuner* tuner = nullptr);
+    void ParallelForRange(std::size_t begin, std::size_t end, RangeFn fn,
+        std::size_t grain = kAutoGrain, ParallelForTuner* tuner = nullptr);
+    // Блокирующие версии наследуют приоритет текущей задачи (вне пула — Normal).
+    // Неблокирующие: задачи учитываются в group и берут её приоритет
+    void ParallelFor(TaskGroup& group, std::size_t begin, std::size_t end, DispatchFn fn,
+        std::size_t grain = kAutoGrain, ParallelForTuner* tuner = nullptr);
+    void ParallelForRange(TaskGroup& group, std::size_t begin, std::size_t end, RangeFn fn,
+        std::size_t grain = kAutoGrain, ParallelForTuner* tuner = nullptr);
 
+    // Ждать только задачи группы; вызывающий поток в это время помогает пулу
+    void Wait(TaskGroup& group);
+    // Ждать одну задачу (и помогать пулу)
+    void Wait(const TaskHandle& handle);
+
+    // Ждать вообще все задачи (включая фоновые) — только для shutdown/ресайза
     void WaitForAll();
 
     // Индекс воркера (0..threads-1) или SIZE_MAX, если внешний поток
     std::size_t ThreadIndex() const;
+    std::size_t WorkerCount() const { return workers_.size(); }
+
+    Stats GetStats() const;
 
 private:
     TaskSystem() = default;
@@ -40,16 +208,241 @@ private:
     TaskSystem(const TaskSystem&) = delete;
     TaskSystem& operator=(const TaskSystem&) = delete;
 
+    friend class TaskHandle;
+
+    struct Job_;
+
+    // Звено списка продолжений: "после меня запусти job"
+    struct Continuation_ {
+        Job_*          job = nullptr;
+        Continuation_* next = nullptr;
+        bool           heap = false;
+    };
+
+    // Звенья для первых kInlineDeps пререквизитов живут в самой задаче-потребителе
+    static constexpr std::size_t kInlineDeps = 4;
+
+    // Узел задачи. Берётся из пула и возвращается в него, когда отпущена последняя ссылка.
+    static constexpr std::size_t kPriorityCount = 3;
+    // Лейны с локальными деками (фоновые живут только в общей очереди)
+    static constexpr std::size_t kDequeLanes = 2;
+
+    struct Job_ {
+        Task         fn;
+        TaskGroup*   group = nullptr;
+        std::atomic<const TaskGroup*> root{ nullptr }; // корень группы: фильтр помощи ждущих
+        Job_*        next = nullptr; // пул / очередь инъекций
+        TaskPriority priority = TaskPriority::Normal;
+
+        CancellationToken cancel;
+        Clock::time_point deadline = kNoDeadline;
+
+        std::atomic<int32_t>        refs{ 1 };        // планировщик + TaskHandle'ы
+        std::atomic<int32_t>        pendingDeps{ 0 }; // незавершённые пререквизиты
+        std::atomic<Continuation_*> continuations{ nullptr };
+        std::atomic<bool>           done{ false };
+        std::atomic<bool>           watched{ false }; // кто-то ждёт через Wait(handle)
+
+        Continuation_ links[kInlineDeps];
+    };
+
+    // Общее состояние одного вызова Dispatch (вместо make_shared)
+    struct DispatchBlock_ {
+        DispatchFn               fn;
+        std::atomic<std::size_t> refs{ 0 };
+        DispatchBlock_*          next = nullptr;
+    };
+
+    // Общее состояние одного ParallelFor
+    struct ForBlock_ {
+        DispatchFn               index; // одно из двух
+        RangeFn                  range;
+        std::atomic<std::size_t> refs{ 0 };
+        std::atomic<std::size_t> grain{ 1 };
+        bool                     autoGrain = false;
+        ParallelForTuner*        tuner = nullptr;
+        ForBlock_*               next = nullptr;
+    };
+
+    // Целевая длительность одного куска в авто-режиме: на порядок дороже накладных задачи
+    static constexpr double kTargetChunkNs = 20000.0;
+
+    // Маркер "список продолжений закрыт" — задача уже завершилась
+    static Continuation_* ClosedList_() { return reinterpret_cast<Continuation_*>(uintptr_t(1)); }
+
+    // Интрузивный FIFO по Job_::next (под внешним локом)
+    struct JobList_ {
+        Job_* head = nullptr;
+        Job_* tail = nullptr;
+
+        void PushBack(Job_* j) {
+            j->next = nullptr;
+            (tail ? tail->next : head) = j;
+            tail = j;
+        }
+        void Splice(Job_* first, Job_* last) {
+            (tail ? tail->next : head) = first;
+            tail = last;
+        }
+        // Вставка по сроку (стабильно: за всеми с тем же или более ранним сроком).
+        // Без срока или не раньше хвоста — O(1), как PushBack
+        void InsertByDeadline(Job_* j) {
+            if (!tail || tail->deadline <= j->deadline) {
+                PushBack(j);
+                return;
+            }
+            Job_* prev = nullptr;
+            Job_* cur = head;
+            while (cur->deadline <= j->deadline) {
+                prev = cur;
+                cur = cur->next;
+            }
+            j->next = cur;
+            (prev ? prev->next : head) = j;
+        }
+        Job_* PopFirst(const TaskGroup* only) {
+            Job_* prev = nullptr;
+            Job_* j = head;
+            if (only) {
+                while (j && j->root.load(std::memory_order_relaxed) != only) {
+                    prev = j;
+                    j = j->next;
+                }
+            }
+            if (!j) {
+                return nullptr;
+            }
+            (prev ? prev->next : head) = j->next;
+            if (tail == j) {
+                tail = prev;
+            }
+            j->next = nullptr;
+            return j;
+        }
+        bool Contains(const TaskGroup* only) const {
+            for (const Job_* j = head; j; j = j->next) {
+                if (!only || j->root.load(std::memory_order_relaxed) == only) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    struct Worker_ {
+        WorkStealingDeque<Job_*> deques[kDequeLanes];
+        uint32_t rng = 0; // xorshift для выбора жертвы
+    };
+
     void WorkerLoop_(std::size_t index);
+    Job_* SpinForWork_(std::size_t index);
+    void  SetupWorkerThread_(std::size_t index) const;
+
+    Job_* NewJob_(Task&& fn, TaskGroup* group, TaskPriority priority);
+    Job_* NewJob_(Task&& fn, TaskGroup* group, TaskPriority priority, const TaskOptions& options);
+    void Enqueue_(Job_* job);
+    void Push_(Job_* job);
+    TaskHandle SubmitWithDeps_(TaskGroup* group, Task&& t, std::span<const TaskHandle> deps);
+    bool AddContinuation_(Job_* prereq, Continuation_* node);
+    void ResolveDependency_(Job_* job);
+    static void Release_(Job_* job);
+    static NodePool<Job_>& JobPool_();
+    void DispatchImpl_(TaskGroup* group, std::size_t jobCount,
+        DispatchFn&& fn, std::size_t batchSize);
+    ForBlock_* NewForBlock_(DispatchFn&& index, RangeFn&& range, std::size_t grain, ParallelForTuner* tuner);
+    void SpawnForRange_(ForBlock_* blk, std::size_t begin, std::size_t end, TaskGroup* group);
+    void RunForRange_(ForBlock_* blk, std::size_t begin, std::size_t end, TaskGroup* group);
+    bool WantsSplit_() const;
+    Job_* FindWork_(std::size_t self);
+    // only — корень группы (TaskGroup::root_), nullptr — без фильтра.
+    // allowBackground — только WaitForAll: иначе долгая фоновая задача встала бы на стек ждущего
+    Job_* FindWorkAsHelper_(const TaskGroup* only, bool allowBackground);
+    Job_* PopInjected_(std::size_t lane, const TaskGroup* only = nullptr);
+    Job_* PopBackground_();
+    Job_* StealFromOthers_(std::size_t lane, std::size_t self, uint32_t& rng, const TaskGroup* only = nullptr);
+    bool  IsWorkerThread_() const { return tlsOwner_ == this && tlsIndex_ < locals_.size(); }
+    std::size_t BackgroundSlots_() const;
+    bool  HasVisibleWork_(bool includeBackground = true) const;
+    bool  HasWorkFor_(const TaskGroup* only, bool allowBackground) const;
+    void  Run_(Job_* job);
+    void  WakeWorkers_();
+    void  CascadeWake_();
+    template<typename Pred> void HelpUntil_(Pred done, const TaskGroup* only, bool allowBackground);
+    static TaskPriority BlockingForPriority_();
 
 private:
-    std::vector<std::thread>        workers_;
-    std::queue<Task>                queue_;
-    mutable std::mutex              mtx_;
+    std::vector<std::thread>              workers_;
+    std::vector<std::unique_ptr<Worker_>> locals_;
+
+    // Очереди инъекций по приоритетам: внешние потоки (main, загрузчики) и все фоновые задачи
+    JobList_                        injected_[kPriorityCount];
+    mutable std::mutex              injectMtx_;
+    std::atomic<std::size_t>        injectedCount_[kPriorityCount]{};
+
+    // Сколько воркеров сейчас заняты фоновыми задачами (ограничено BackgroundSlots_())
+    std::atomic<std::size_t>        backgroundRunning_{ 0 };
+
+    // Парковка простаивающих воркеров
+    std::mutex                      parkMtx_;
     std::condition_variable         cvWork_;
-    std::condition_variable         cvIdle_;
+    std::atomic<uint64_t>           workEpoch_{ 0 };
+    std::atomic<unsigned>           sleeping_{ 0 };
+    std::atomic<unsigned>           spinning_{ 0 }; // крутятся в SpinForWork_: будить их не нужно
+    std::atomic<uint64_t>           spinHits_{ 0 };
+    std::atomic<uint64_t>           parks_{ 0 };
+    std::atomic<uint64_t>           cancelledDrops_{ 0 };
+    Config                          config_;
+
+    // Ожидающие (WaitForAll / TaskGroup::Wait): спят, когда помогать нечем
+    std::mutex                      waitMtx_;
+    std::condition_variable         cvWait_;
+    std::atomic<unsigned>           waitersSleeping_{ 0 };
+
+    std::mutex                      startStopMtx_;
     std::atomic<bool>               running_{ false };
     std::atomic<std::size_t>        inFlight_{ 0 };
 
+    NodePool<DispatchBlock_>        dispatchPool_;
+    NodePool<ForBlock_>             forPool_;
+    std::atomic<uint64_t>           continuationAllocs_{ 0 };
+
     static thread_local std::size_t tlsIndex_;
-};
\ No newline at end of file
+    static thread_local TaskSystem* tlsOwner_;
+    static thread_local TaskPriority tlsPriority_; // приоритет исполняемой задачи
+    static thread_local const CancellationToken* tlsCancel_; // токен исполняемой задачи
+    static thread_local const TaskGroup* tlsRoot_; // корень группы исполняемой задачи
+    friend class TaskGroup;
+};
+
+// Лёгкая ссылка на задачу (счётчик ссылок на узел задачи). Пустой handle считается завершённым.
+class TaskHandle {
+public:
+    TaskHandle() = default;
+    TaskHandle(const TaskHandle& o) noexcept : job_(o.job_) {
+        if (job_) {
+            job_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    TaskHandle(TaskHandle&& o) noexcept : job_(o.job_) { o.job_ = nullptr; }
+    TaskHandle& operator=(TaskHandle o) noexcept {
+        std::swap(job_, o.job_);
+        return *this;
+    }
+    ~TaskHandle() { Reset(); }
+
+    void Reset() {
+        if (job_) {
+            TaskSystem::Release_(job_);
+            job_ = nullptr;
+        }
+    }
+
+    bool IsValid() const { return job_ != nullptr; }
+    bool IsDone() const { return job_ == nullptr || job_->done.load(std::memory_order_acquire); }
+
+private:
+    friend class TaskSystem;
+    explicit TaskHandle(TaskSystem::Job_* job) : job_(job) {} // забирает уже взятую ссылку
+
+    TaskSystem::Job_* job_ = nullptr;
+};
@@ -209,20 +209,18 @@ void TextManager::Draw(Renderer* r, ID3D12GraphicsCommandList* cl) {
     }
 
     // root constants: viewport.xy, dummy, spread, pxSize
-    std::vector<uint32_t> k;
-    k.reserve(8);
     auto f2u = [](float f)->uint32_t { uint32_t u; std::memcpy(&u, &f, 4); return u; };
-    k.push_back(f2u((float)vpW_)); k.push_back(f2u((float)vpH_));
-    k.push_back(0); k.push_back(0);
-    k.push_back(f2u((float)font_->Spread()));
-    k.push_back(f2u((float)font_->PxSize()));
-    k.push_back(0); k.push_back(0);
-    rc_.constants[1] = std::move(k);
+    rc_.constants[1] = {
+        f2u((float)vpW_), f2u((float)vpH_),
+        0u, 0u,
+        f2u((float)font_->Spread()),
+        f2u((float)font_->PxSize()),
+        0u, 0u };
 
     // Самплер (linear clamp)
     rc_.samplerTable[0] = r->GetSamplerManager()->GetTable(r, { SamplerManager::LinearClamp() });
 
-    mat_->Bind(cl, rc_);
+    r->AddBindStats(mat_->Bind(cl, rc_), 0);
 
     cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     cl->IASetVertexBuffers(0, 1, &vbv_);
@@ -35,10 +35,25 @@ static bool EndsWithNoCase(const std::wstring& s, const std::wstring& suf)
     return true;
 }
 
+// WIC требует COM на потоке; воркеры TaskSystem его сами не инициализируют
+static void EnsureComOnThread()
+{
+    struct ComScope {
+        HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        ~ComScope() {
+            if (SUCCEEDED(hr)) {
+                CoUninitialize();
+            }
+        }
+    };
+    static thread_local ComScope scope;
+}
+
 // ========================= WIC loader (to RGBA8) =========================
 bool Texture2D::LoadRGBA8_WIC_(const std::wstring& path, std::vector<uint8_t>& outRGBA, UINT& outW, UINT& outH)
 {
     outRGBA.clear(); outW = outH = 0;
+    EnsureComOnThread();
 
     ComPtr<IWICImagingFactory> factory;
     if (!CreateWICFactory(factory)) {
@@ -349,7 +364,7 @@ bool Texture2D::CreateFromDDS_(Renderer* r, ID3D12GraphicsCommandList* uploadCmd
 
     width_ = width; height_ = height; mipLevels_ = mipCount;
     resourceFormat_ = td.Format; srvFormat_ = srvFmt;
-    stagedFrame_ = UINT(-1); srvGPU_.ptr = 0;
+    stagedFrame_ = UINT64_MAX; srvGPU_.ptr = 0;
 
     return true;
 }
@@ -397,11 +412,27 @@ bool Texture2D::CreateFromFile(Renderer* renderer,
     resourceFormat_ = resourceFmt; srvFormat_ = srvFmt;
 
     // сброс staged кэша
-    stagedFrame_ = UINT(-1); srvGPU_.ptr = 0;
+    stagedFrame_ = UINT64_MAX; srvGPU_.ptr = 0;
 
     return true;
 }
 
+AsyncTask<bool> Texture2D::CreateFromFileAsync(Renderer* renderer, CreateDesc desc,
+    CancellationToken cancel, TaskSystem::Clock::time_point deadline)
+{
+    co_await ScheduleOn(TaskPriority::Background, deadline);
+    if (cancel.IsCancelled()) {
+        co_return false;
+    }
+
+    Renderer::UploadBatch upload = renderer->BeginUpload();
+    if (!CreateFromFile(renderer, upload.cl.Get(), desc, &upload.keepAlive)) {
+        co_return false;
+    }
+    co_await renderer->SubmitUpload(upload);
+    co_return true;
+}
+
 void Texture2D::CreateFromRGBA8(Renderer* renderer,
     ID3D12GraphicsCommandList* uploadCmd,
     const void* rgba8, UINT width, UINT height,
@@ -417,12 +448,12 @@ void Texture2D::CreateFromRGBA8(Renderer* renderer,
     width_ = width; height_ = height; mipLevels_ = 1;
     resourceFormat_ = resFmt; srvFormat_ = srvFmt;
 
-    stagedFrame_ = UINT(-1); srvGPU_.ptr = 0;
+    stagedFrame_ = UINT64_MAX; srvGPU_.ptr = 0;
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE Texture2D::GetSRVForFrame(Renderer* r)
 {
-    if (stagedFrame_ == r->GetCurrentFrameIndex() && srvGPU_.ptr != 0) {
+    if (stagedFrame_ == r->GetFrameNumber() && srvGPU_.ptr != 0) {
         return srvGPU_;
     }
 
@@ -431,7 +462,7 @@ D3D12_GPU_DESCRIPTOR_HANDLE Texture2D::GetSRVForFrame(Renderer* r)
     r->GetDevice()->CopyDescriptorsSimple(1, h.cpu, srvCPU_, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
     srvGPU_ = h.gpu;
-    stagedFrame_ = r->GetCurrentFrameIndex();
+    stagedFrame_ = r->GetFrameNumber();
     return srvGPU_;
 }
 
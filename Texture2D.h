@@ -5,6 +5,8 @@
 #include <vector>
 #include <string>
 
+#include "AsyncTask.h"
+
 class Renderer;
 
 
@@ -31,6 +33,12 @@ public:
 		const CreateDesc& desc,
 		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>* keepAlive);
 
+	// То же асинхронно: чтение/декод на фоновом воркере, аплоад своим CL, true — после фенса.
+	// Объект текстуры должен жить до завершения задачи. Отменённая до старта загрузка — false.
+	AsyncTask<bool> CreateFromFileAsync(Renderer* renderer, CreateDesc desc,
+		CancellationToken cancel = {},
+		TaskSystem::Clock::time_point deadline = TaskSystem::kNoDeadline);
+
 	// Старый путь: создание из RGBA8 буфера (оставлено для совместимости)
 	void CreateFromRGBA8(Renderer* renderer,
 		ID3D12GraphicsCommandList* uploadCmd,
@@ -70,7 +78,7 @@ private:
 	D3D12_CPU_DESCRIPTOR_HANDLE srvCPU_{};
 
 	// Кэш staged GPU handle на кадр
-	UINT stagedFrame_ = UINT(-1);
+	uint64_t stagedFrame_ = UINT64_MAX; // Renderer::GetFrameNumber()
 	D3D12_GPU_DESCRIPTOR_HANDLE srvGPU_{};
 
 	// Метаданные
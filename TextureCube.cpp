@@ -204,7 +204,7 @@ bool TextureCube::CreateFromDDS(Renderer* r,
     CreateSrvCPU_(r, format_, mips, arr);
 
     // сброс staged-кэша
-    stagedFrame_ = UINT(-1);
+    stagedFrame_ = UINT64_MAX;
     srvGPU_.ptr = 0;
 
     return true;
@@ -212,7 +212,7 @@ bool TextureCube::CreateFromDDS(Renderer* r,
 
 D3D12_GPU_DESCRIPTOR_HANDLE TextureCube::GetSRVForFrame(Renderer* r)
 {
-    if (stagedFrame_ == r->GetCurrentFrameIndex() && srvGPU_.ptr != 0) {
+    if (stagedFrame_ == r->GetFrameNumber() && srvGPU_.ptr != 0) {
         return srvGPU_;
     }
     auto& da = r->GetDescAlloc();
@@ -220,7 +220,7 @@ D3D12_GPU_DESCRIPTOR_HANDLE TextureCube::GetSRVForFrame(Renderer* r)
     r->GetDevice()->CopyDescriptorsSimple(
         1, h.cpu, srvCPU_, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     srvGPU_ = h.gpu;
-    stagedFrame_ = r->GetCurrentFrameIndex();
+    stagedFrame_ = r->GetFrameNumber();
     return srvGPU_;
 }
 
@@ -47,7 +47,7 @@ private:
     D3D12_CPU_DESCRIPTOR_HANDLE srvCPU_{};
 
     // Кэш «состейдженного» GPU handle на кадр (как в Texture2D)
-    UINT stagedFrame_ = UINT(-1);
+    uint64_t stagedFrame_ = UINT64_MAX; // Renderer::GetFrameNumber()
     D3D12_GPU_DESCRIPTOR_HANDLE srvGPU_{};
 
     // Метаданные
@@ -0,0 +1,84 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Раскладка транзиентных ресурсов в одной куче по времени жизни.
+// Жадно: от больших к маленьким, каждому — наименьшее смещение, не пересекающее по памяти
+// уже размещённых, чьи интервалы жизни пересекаются с его. Чистый CPU, без D3D.
+
+struct TransientRequest {
+    uint64_t size = 0;
+    uint64_t alignment = 1;
+    uint32_t firstUse = 0;          // позиция пасса в порядке сабмита, включительно
+    uint32_t lastUse = UINT32_MAX;  // [0, UINT32_MAX] — живёт весь кадр (не алиасится)
+};
+
+struct TransientLayout {
+    std::vector<uint64_t> offsets;  // по индексу запроса
+    uint64_t heapSize = 0;
+    uint64_t naiveSize = 0;         // сумма без алиасинга (для статистики)
+};
+
+namespace TransientDetail {
+inline uint64_t AlignUp(uint64_t v, uint64_t a) {
+    return a <= 1 ? v : (v + a - 1) / a * a;
+}
+
+inline bool LifetimesOverlap(const TransientRequest& a, const TransientRequest& b) {
+    return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+}
+}
+
+inline TransientLayout SolveTransientAliasing(std::span<const TransientRequest> req) {
+    using TransientDetail::AlignUp;
+    using TransientDetail::LifetimesOverlap;
+
+    TransientLayout out;
+    out.offsets.assign(req.size(), 0);
+
+    // Порядок размещения: крупные первыми, при равенстве — кто раньше начинается (детерминированно)
+    std::vector<uint32_t> order(req.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (req[a].size != req[b].size) {
+            return req[a].size > req[b].size;
+        }
+        return req[a].firstUse < req[b].firstUse;
+    });
+
+    struct Busy { uint64_t begin, end; };
+    std::vector<Busy> busy;
+    std::vector<uint32_t> placed;
+    placed.reserve(req.size());
+
+    for (uint32_t i : order) {
+        const TransientRequest& r = req[i];
+        out.naiveSize += AlignUp(r.size, r.alignment);
+
+        // Занятые отрезки памяти среди тех, кто жив одновременно с r
+        busy.clear();
+        for (uint32_t j : placed) {
+            if (LifetimesOverlap(r, req[j])) {
+                busy.push_back({ out.offsets[j], out.offsets[j] + req[j].size });
+            }
+        }
+        std::sort(busy.begin(), busy.end(), [](const Busy& a, const Busy& b) { return a.begin < b.begin; });
+
+        // Первая дыра, куда r влезает с учётом выравнивания
+        uint64_t offset = AlignUp(0, r.alignment);
+        for (const Busy& b : busy) {
+            if (offset + r.size <= b.begin) {
+                break;
+            }
+            offset = AlignUp(std::max(offset, b.end), r.alignment);
+        }
+
+        out.offsets[i] = offset;
+        out.heapSize = std::max(out.heapSize, offset + r.size);
+        placed.push_back(i);
+    }
+    return out;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Chase-Lev deque (вариант Lê/Pop/Cohen/Nardelli для C11-атомиков).
+// Владелец кладёт/снимает с "дна" (LIFO, без локов), воры забирают с "верха" (FIFO, один CAS).
+// T — тривиально копируемый тип (у нас это указатели на задачи).
+template<typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 1024) {
+        int64_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        rings_.push_back(std::make_unique<Ring_>(cap));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Только поток-владелец
+    void Push(T item) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        Ring_* r = ring_.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            r = Grow_(r, b, t);
+        }
+        r->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Только поток-владелец
+    bool Pop(T& out) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring_* r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // пусто
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        out = r->Get(b);
+        if (t == b) {
+            // последний элемент — гонимся с ворами
+            const bool won = top_.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Любой поток
+    bool Steal(T& out) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+
+        Ring_* r = ring_.load(std::memory_order_acquire);
+        T item = r->Get(t);
+        if (!top_.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false; // проиграли гонку — пусть вызывающий попробует другую жертву
+        }
+        out = item;
+        return true;
+    }
+
+    // Любой поток: как Steal, но берёт верхний элемент, только если он подходит под pred.
+    // pred может увидеть уже снятый элемент — его ответ тогда отбрасывается проигранным CAS
+    template<typename Pred>
+    bool StealIf(T& out, Pred&& pred) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+
+        Ring_* r = ring_.load(std::memory_order_acquire);
+        T item = r->Get(t);
+        if (!pred(item)) {
+            return false;
+        }
+        if (!top_.compare_exchange_strong(t, t + 1,
+            std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        out = item;
+        return true;
+    }
+
+    // Приблизительно (для эвристик): верхний элемент без снятия, может быть уже устаревшим
+    bool PeekTop(T& out) const {
+        const int64_t t = top_.load(std::memory_order_acquire);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        out = ring_.load(std::memory_order_acquire)->Get(t);
+        return true;
+    }
+
+    // Приблизительно (для эвристик): может врать при гонках
+    bool Empty() const {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+    int64_t SizeApprox() const {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? (b - t) : 0;
+    }
+
+private:
+    struct Ring_ {
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Ring_(int64_t cap)
+            : capacity(cap), mask(cap - 1), items(new std::atomic<T>[static_cast<size_t>(cap)]) {
+        }
+
+        void Put(int64_t i, T v) { items[static_cast<size_t>(i & mask)].store(v, std::memory_order_relaxed); }
+        T Get(int64_t i) const { return items[static_cast<size_t>(i & mask)].load(std::memory_order_relaxed); }
+    };
+
+    Ring_* Grow_(Ring_* old, int64_t b, int64_t t) {
+        auto bigger = std::make_unique<Ring_>(old->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->Put(i, old->Get(i));
+        }
+        Ring_* r = bigger.get();
+        // Старые кольца не освобождаем до разрушения дека: вор мог уже прочитать указатель.
+        rings_.push_back(std::move(bigger));
+        ring_.store(r, std::memory_order_release);
+        return r;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_{ 0 };
+    alignas(64) std::atomic<int64_t> bottom_{ 0 };
+    alignas(64) std::atomic<Ring_*>  ring_{ nullptr };
+    std::vector<std::unique_ptr<Ring_>> rings_; // владение (трогает только владелец)
+};
@@ -0,0 +1,142 @@
+// Бенчмарк ParallelAlgorithms против std:: — собирается и на Linux:
+//   g++ -std=c++20 -O2 -pthread -I.. ParallelAlgorithmsBench.cpp ../TaskSystem.cpp -o ParallelAlgorithmsBench
+//   cl /std:c++20 /O2 /EHsc /I.. ParallelAlgorithmsBench.cpp ..\TaskSystem.cpp
+// Каждый случай заодно сверяет результат с std::, расхождение — код возврата 1.
+#include "ParallelAlgorithms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Лучшее время из нескольких прогонов, мс. prepare() — вне замера (восстановить вход)
+template<typename Prepare, typename Fn>
+static double BestMs(int reps, Prepare&& prepare, Fn&& fn) {
+    double best = 1e30;
+    for (int r = 0; r < reps; ++r) {
+        prepare();
+        const auto t0 = Clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    return best;
+}
+
+static void Report(const char* name, std::size_t n, double oursMs, double stdMs, bool ok) {
+    std::printf("%-16s n=%-9zu ours=%9.3fms std=%9.3fms speedup=%5.2fx %s\n",
+        name, n, oursMs, stdMs, stdMs / std::max(oursMs, 1e-6), ok ? "" : "MISMATCH");
+}
+
+static int BenchSize(std::size_t n, std::mt19937_64& rng) {
+    const int reps = n <= 100000 ? 50 : 3;
+    int fails = 0;
+    auto nop = [] {};
+
+    std::vector<uint32_t> src32(n);
+    std::vector<uint64_t> src64(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        src64[i] = rng();
+        src32[i] = static_cast<uint32_t>(src64[i]);
+    }
+
+    // Reduce (сумма в uint64, без переполнения-UB)
+    {
+        uint64_t ours = 0, ref = 0;
+        const double a = BestMs(reps, nop, [&] { ours = ParallelReduce(std::span<const uint64_t>(src64)); });
+        const double b = BestMs(reps, nop, [&] { ref = std::accumulate(src64.begin(), src64.end(), uint64_t(0)); });
+        fails += ours != ref;
+        Report("reduce", n, a, b, ours == ref);
+    }
+
+    // Exclusive scan
+    {
+        std::vector<uint64_t> ours(n), ref(n);
+        const double a = BestMs(reps, nop, [&] { ParallelExclusiveScan(std::span<const uint64_t>(src64), std::span<uint64_t>(ours)); });
+        const double b = BestMs(reps, nop, [&] { std::exclusive_scan(src64.begin(), src64.end(), ref.begin(), uint64_t(0)); });
+        fails += ours != ref;
+        Report("exclusive_scan", n, a, b, ours == ref);
+    }
+
+    // Partition (стабильный; сравниваем с std::stable_partition)
+    {
+        std::vector<uint32_t> ours, ref;
+        auto pred = [](uint32_t v) { return (v & 3u) == 0u; }; // ~25% "видимых"
+        std::size_t ko = 0, kr = 0;
+        const double a = BestMs(reps, [&] { ours = src32; }, [&] { ko = ParallelPartition(std::span<uint32_t>(ours), pred); });
+        const double b = BestMs(reps, [&] { ref = src32; }, [&] {
+            kr = static_cast<std::size_t>(std::stable_partition(ref.begin(), ref.end(), pred) - ref.begin());
+        });
+        const bool ok = ko == kr && ours == ref;
+        fails += !ok;
+        Report("partition", n, a, b, ok);
+    }
+
+    // Radix sort 32 (ключи) против std::sort
+    {
+        std::vector<uint32_t> ours, ref;
+        const double a = BestMs(reps, [&] { ours = src32; }, [&] { ParallelRadixSort(std::span<uint32_t>(ours)); });
+        const double b = BestMs(reps, [&] { ref = src32; }, [&] { std::sort(ref.begin(), ref.end()); });
+        fails += ours != ref;
+        Report("radix32", n, a, b, ours == ref);
+    }
+
+    // Radix sort 64 + payload против std::stable_sort пар (результат стабильной сортировки однозначен)
+    {
+        // Повторы ключей — проверка стабильности
+        std::vector<uint64_t> inKeys = src64;
+        for (std::size_t i = 0; i < n; i += 7) {
+            inKeys[i] = src64[i / 2];
+        }
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> vals;
+        std::vector<std::pair<uint64_t, uint32_t>> ref;
+        auto prepOurs = [&] {
+            keys = inKeys;
+            vals.resize(n);
+            std::iota(vals.begin(), vals.end(), 0u);
+        };
+        auto prepRef = [&] {
+            ref.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                ref[i] = { inKeys[i], static_cast<uint32_t>(i) };
+            }
+        };
+        const double a = BestMs(reps, prepOurs, [&] {
+            ParallelRadixSort(std::span<uint64_t>(keys), std::span<uint32_t>(vals));
+        });
+        const double b = BestMs(reps, prepRef, [&] {
+            std::stable_sort(ref.begin(), ref.end(), [](const auto& x, const auto& y) { return x.first < y.first; });
+        });
+        bool ok = true;
+        for (std::size_t i = 0; i < n && ok; ++i) {
+            ok = keys[i] == ref[i].first && vals[i] == ref[i].second;
+        }
+        fails += !ok;
+        Report("radix64+payload", n, a, b, ok);
+    }
+
+    return fails;
+}
+
+int main() {
+    auto& ts = TaskSystem::Get();
+    ts.Start();
+    std::printf("workers=%zu\n", ts.WorkerCount());
+
+    std::mt19937_64 rng(12345);
+    int fails = 0;
+    for (std::size_t n : { std::size_t(1000), std::size_t(100000), std::size_t(10000000) }) {
+        fails += BenchSize(n, rng);
+    }
+
+    ts.Stop();
+    if (fails != 0) {
+        std::printf("FAIL: %d mismatches\n", fails);
+        return 1;
+    }
+    return 0;
+}
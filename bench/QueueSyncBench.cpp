@@ -0,0 +1,284 @@
+// Проверка расстановки межочередных фенсов (QueueSyncPlan) на синтетических бакетах, без GPU —
+// собирается и на Linux:
+//   g++ -std=c++20 -O2 -I.. QueueSyncBench.cpp -o QueueSyncBench
+//   cl /std:c++20 /O2 /EHsc /I.. QueueSyncBench.cpp
+// Каждый случай сверяет план с ожидаемым, расхождение — код возврата 1.
+#include "QueueSync.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+enum : uint8_t { kDirect = 0, kCompute = 1, kCopy = 2 };
+using Known = std::array<uint64_t, QueueSyncPlan::kMaxQueues>;
+
+// Синтетический кадр: очередь бакета + кого он ждёт (waits живут здесь, батчи ссылаются на них)
+struct Frame {
+    std::vector<uint8_t> queues;
+    std::vector<std::vector<uint32_t>> waits;
+    std::vector<QueueSyncBatch> batches;
+
+    void Add(uint8_t q, std::vector<uint32_t> w = {}) {
+        queues.push_back(q);
+        waits.push_back(std::move(w));
+    }
+    std::span<const QueueSyncBatch> Batches() {
+        batches.resize(queues.size());
+        for (size_t i = 0; i < queues.size(); ++i) {
+            batches[i] = { queues[i], waits[i] };
+        }
+        return batches;
+    }
+};
+
+static void Report(const char* name, bool ok) {
+    std::printf("%-22s %s\n", name, ok ? "ok" : "MISMATCH");
+}
+
+// Инварианты любого плана; known[s] — что очередь сегмента s знает о всех очередях после него.
+// Проверяется и минимальность: каждый Wait что-то добавляет к уже известному
+static bool CheckPlan(std::span<const QueueSyncBatch> b, const QueueSyncPlan& plan, const Known& startValue,
+    const Known& endValue, uint8_t join)
+{
+    const auto& segs = plan.segments;
+    if (segs.empty() || segs.back().queue != join) {
+        return false;
+    }
+    std::vector<Known> known(segs.size());
+    std::vector<uint32_t> batchSeg(b.size(), UINT32_MAX);
+    std::array<size_t, QueueSyncPlan::kMaxQueues> lastSeg; // последний сегмент очереди + 1
+    lastSeg.fill(0);
+    Known lastValue{};
+    uint32_t nextBatch = 0;
+    for (size_t s = 0; s < segs.size(); ++s) {
+        const QueueSyncSegment& seg = segs[s];
+        // Бакеты подряд и по порядку, номера на очередь — подряд с начального
+        if (seg.firstBatch != nextBatch || seg.endBatch < seg.firstBatch || seg.endBatch > b.size()) {
+            return false;
+        }
+        const uint64_t expected = lastValue[seg.queue] != 0 ? lastValue[seg.queue] + 1 : startValue[seg.queue];
+        if (seg.value != expected) {
+            return false;
+        }
+        lastValue[seg.queue] = seg.value;
+        for (uint32_t i = seg.firstBatch; i < seg.endBatch; ++i) {
+            if (b[i].queue != seg.queue) {
+                return false;
+            }
+            batchSeg[i] = static_cast<uint32_t>(s);
+        }
+        nextBatch = seg.endBatch;
+
+        Known k = lastSeg[seg.queue] != 0 ? known[lastSeg[seg.queue] - 1] : Known{};
+        for (uint32_t w = seg.waitBegin; w < seg.waitBegin + seg.waitCount; ++w) {
+            const QueueSyncWait& wt = plan.waits[w];
+            auto src = std::find_if(segs.begin(), segs.begin() + s, [&](const QueueSyncSegment& o) {
+                return o.queue == wt.queue && o.value == wt.value;
+            });
+            if (src == segs.begin() + s || !src->signal || k[wt.queue] >= wt.value) {
+                return false; // ждём несуществующее, несигналенное или уже известное
+            }
+            const Known& sk = known[src - segs.begin()];
+            for (size_t q = 0; q < k.size(); ++q) {
+                k[q] = std::max(k[q], sk[q]);
+            }
+        }
+        k[seg.queue] = seg.value;
+        known[s] = k;
+        lastSeg[seg.queue] = s + 1;
+    }
+    if (nextBatch != b.size()) {
+        return false;
+    }
+    for (size_t q = 0; q < endValue.size(); ++q) {
+        const uint64_t expectedEnd = lastValue[q] != 0 ? lastValue[q] + 1 : startValue[q];
+        if (endValue[q] != expectedEnd) {
+            return false;
+        }
+    }
+
+    // Каждый бакет видит всех, кого ждёт
+    for (size_t i = 0; i < b.size(); ++i) {
+        const Known& k = known[batchSeg[i]];
+        for (uint32_t p : b[i].waitsOn) {
+            const QueueSyncSegment& src = segs[batchSeg[p]];
+            if (k[src.queue] < src.value) {
+                return false;
+            }
+        }
+    }
+    // Signal — ровно у тех, кого ждут
+    for (const QueueSyncSegment& seg : segs) {
+        const bool waited = std::any_of(plan.waits.begin(), plan.waits.end(), [&](const QueueSyncWait& w) {
+            return w.queue == seg.queue && w.value == seg.value;
+        });
+        if (seg.signal != waited) {
+            return false;
+        }
+    }
+    // Схождение: последний сегмент (на join) знает последний сегмент каждой очереди
+    for (size_t q = 0; q < lastValue.size(); ++q) {
+        if (known.back()[q] < lastValue[q]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Build(Frame& f, QueueSyncPlan& plan, Known& next, uint8_t join = kDirect) {
+    const Known start = next;
+    const std::span<const QueueSyncBatch> b = f.Batches();
+    plan.Build(b, next, join);
+    return CheckPlan(b, plan, start, next, join);
+}
+
+// direct -> compute -> direct: два Wait'а, ни одного лишнего сегмента на схождение
+static int CaseDirectComputeDirect() {
+    Frame f;
+    f.Add(kDirect);
+    f.Add(kCompute, { 0 });
+    f.Add(kDirect, { 1 });
+    QueueSyncPlan plan;
+    Known next{ 10, 5, 1 };
+    bool ok = Build(f, plan, next);
+    const auto& s = plan.segments;
+    ok = ok && s.size() == 3 && plan.waits.size() == 2 &&
+        s[1].queue == kCompute && s[1].waitCount == 1 && plan.waits[s[1].waitBegin].queue == kDirect &&
+        plan.waits[s[1].waitBegin].value == 10 &&
+        s[2].queue == kDirect && s[2].waitCount == 1 && plan.waits[s[2].waitBegin].queue == kCompute &&
+        plan.waits[s[2].waitBegin].value == 5 && s[0].signal && s[1].signal && !s[2].signal;
+    Report("direct_compute_direct", ok);
+    return !ok;
+}
+
+// Транзитивность: compute ждал copy, direct ждёт обоих — Wait только на compute.
+// И второй Wait той же очереди на уже известное не ставится
+static int CaseTransitive() {
+    Frame f;
+    f.Add(kCopy);
+    f.Add(kCompute, { 0 });
+    f.Add(kDirect, { 0, 1 });
+    f.Add(kCompute);
+    f.Add(kDirect, { 0, 1 }); // всё уже известно direct'у
+    QueueSyncPlan plan;
+    Known next{ 1, 1, 1 };
+    bool ok = Build(f, plan, next);
+    const auto& s = plan.segments;
+    // copy | compute (ждёт copy) | direct (ждёт compute) | compute | direct (без Wait'ов) | join (ждёт compute)
+    ok = ok && s.size() == 6 && s[2].queue == kDirect && s[2].waitCount == 1 &&
+        plan.waits[s[2].waitBegin].queue == kCompute && s[4].queue == kDirect && s[4].waitCount == 0;
+    Report("transitive", ok);
+    return !ok;
+}
+
+// Signal — только там, где ждут: независимые сегменты direct его не получают
+static int CaseSignalOnlyWhenWaited() {
+    Frame f;
+    f.Add(kDirect);
+    f.Add(kCompute);
+    f.Add(kDirect);
+    f.Add(kDirect);
+    QueueSyncPlan plan;
+    Known next{ 1, 1, 1 };
+    bool ok = Build(f, plan, next);
+    const auto& s = plan.segments;
+    // direct | compute | direct | join (пустой хвост direct ждёт compute)
+    ok = ok && s.size() == 4 && !s[0].signal && s[1].signal && !s[2].signal && !s[3].signal &&
+        s[3].firstBatch == s[3].endBatch && s[3].waitCount == 1;
+    Report("signal_only_waited", ok);
+    return !ok;
+}
+
+// Схождение на joinQueue: кадр кончается на compute и copy, direct ждёт обе
+static int CaseJoin() {
+    Frame f;
+    f.Add(kDirect);
+    f.Add(kCopy, { 0 });
+    f.Add(kCompute, { 0 });
+    QueueSyncPlan plan;
+    Known next{ 1, 1, 1 };
+    bool ok = Build(f, plan, next, kDirect);
+    const auto& s = plan.segments;
+    ok = ok && s.back().queue == kDirect && s.back().waitCount == 2 && s.back().firstBatch == 3;
+
+    // join на compute: уже последний сегмент compute знает direct, но не copy
+    QueueSyncPlan plan2;
+    Known next2{ 1, 1, 1 };
+    ok = ok && Build(f, plan2, next2, kCompute) && plan2.segments.back().queue == kCompute &&
+        plan2.segments.back().waitCount == 1 && plan2.waits[plan2.segments.back().waitBegin].queue == kCopy;
+    Report("join", ok);
+    return !ok;
+}
+
+// Номера фенсов: кадр за кадром монотонны на каждой очереди, неиспользуемые очереди не двигаются
+static int CaseMonotonicValues() {
+    Frame f;
+    f.Add(kDirect);
+    f.Add(kCompute, { 0 });
+    f.Add(kDirect, { 1 });
+    f.Add(kCompute, { 2 });
+    QueueSyncPlan plan;
+    Known next{ 100, 7, 3 };
+    bool ok = true;
+    uint64_t lastDirect = 0, lastCompute = 0;
+    for (int frame = 0; frame < 3 && ok; ++frame) {
+        ok = Build(f, plan, next);
+        for (const QueueSyncSegment& seg : plan.segments) {
+            uint64_t& last = seg.queue == kDirect ? lastDirect : lastCompute;
+            ok = ok && seg.queue != kCopy && seg.value > last;
+            last = seg.value;
+        }
+    }
+    ok = ok && next[kCopy] == 3 && next[kDirect] == lastDirect + 1 && next[kCompute] == lastCompute + 1;
+    Report("monotonic_values", ok);
+    return !ok;
+}
+
+// Случайные кадры на трёх очередях: только инварианты + время построения
+static int CaseRandom(std::mt19937_64& rng) {
+    int fails = 0;
+    double worstUs = 0.0;
+    QueueSyncPlan plan;
+    Known next{ 1, 1, 1 };
+    for (int rep = 0; rep < 500; ++rep) {
+        Frame f;
+        const uint32_t n = 1 + static_cast<uint32_t>(rng() % 32);
+        for (uint32_t i = 0; i < n; ++i) {
+            std::vector<uint32_t> w;
+            for (uint32_t k = 0; i != 0 && k < rng() % 4; ++k) {
+                w.push_back(static_cast<uint32_t>(rng() % i));
+            }
+            f.Add(static_cast<uint8_t>(rng() % 3), std::move(w));
+        }
+        const Known start = next;
+        const std::span<const QueueSyncBatch> b = f.Batches();
+        const auto t0 = Clock::now();
+        plan.Build(b, next, kDirect);
+        worstUs = std::max(worstUs, std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        fails += !CheckPlan(b, plan, start, next, kDirect);
+    }
+    std::printf("%-22s reps=500 worst=%.1fus\n", "random", worstUs);
+    Report("random", fails == 0);
+    return fails;
+}
+
+int main() {
+    std::mt19937_64 rng(12345);
+    int fails = 0;
+    fails += CaseDirectComputeDirect();
+    fails += CaseTransitive();
+    fails += CaseSignalOnlyWhenWaited();
+    fails += CaseJoin();
+    fails += CaseMonotonicValues();
+    fails += CaseRandom(rng);
+
+    if (fails != 0) {
+        std::printf("FAIL: %d mismatches\n", fails);
+        return 1;
+    }
+    return 0;
+}
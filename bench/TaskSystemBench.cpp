@@ -0,0 +1,634 @@
+// Бенчмарк TaskSystem без D3D12 — собирается и на Linux:
+//   g++ -std=c++20 -O2 -pthread -I.. TaskSystemBench.cpp ../TaskSystem.cpp -o TaskSystemBench
+//   cl /std:c++20 /O2 /EHsc /I.. TaskSystemBench.cpp ..\TaskSystem.cpp
+// Запуск:
+//   TaskSystemBench [--json out.json] [--only name] [--threads N]
+// --json пишет все метрики одним документом (для сравнения прогонов; "-" — в stdout,
+// тогда текстовый лог уходит в stderr). --only — только случаи, чьё имя начинается с name.
+#include "TaskSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// ---- Счётчик аллокаций: подменяем глобальный new/delete ----
+static std::atomic<uint64_t> g_allocs{ 0 };
+
+void* operator new(std::size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+using Clock = std::chrono::steady_clock;
+
+static double MsSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// ---- Вывод: текстовый лог + JSON-отчёт ----
+static FILE* g_log = stdout;
+
+static void Log(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(g_log, fmt, args);
+    va_end(args);
+}
+
+// Один замер: случай + параметры + метрики (всё числами — так прогоны сравниваются скриптом)
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, double>> params;
+    std::vector<std::pair<std::string, double>> metrics;
+
+    BenchResult& Param(const char* key, double v) { params.emplace_back(key, v); return *this; }
+    BenchResult& Metric(const char* key, double v) { metrics.emplace_back(key, v); return *this; }
+};
+
+static std::vector<BenchResult> g_results;
+
+static BenchResult& AddResult(const char* name) {
+    g_results.push_back({});
+    g_results.back().name = name;
+    return g_results.back();
+}
+
+static void WriteJsonFields(FILE* f, const std::vector<std::pair<std::string, double>>& fields) {
+    std::fputc('{', f);
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        std::fprintf(f, "%s\"%s\": %.9g", i ? ", " : "", fields[i].first.c_str(), fields[i].second);
+    }
+    std::fputc('}', f);
+}
+
+static bool WriteJson(const char* path, std::size_t workers, const TaskSystem::Config& cfg) {
+    const bool toStdout = std::strcmp(path, "-") == 0;
+    FILE* f = toStdout ? stdout : std::fopen(path, "w");
+    if (!f) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::fprintf(f, "{\n  \"suite\": \"TaskSystem\",\n");
+    std::fprintf(f, "  \"hardware_concurrency\": %u,\n  \"workers\": %zu,\n", std::thread::hardware_concurrency(), workers);
+    std::fprintf(f, "  \"config\": {\"spinMicros\": %u, \"yieldCount\": %u, \"pinThreads\": %s},\n",
+        cfg.spinMicros, cfg.yieldCount, cfg.pinThreads ? "true" : "false");
+    std::fprintf(f, "  \"results\": [\n");
+    for (std::size_t i = 0; i < g_results.size(); ++i) {
+        const BenchResult& r = g_results[i];
+        std::fprintf(f, "    {\"name\": \"%s\", \"params\": ", r.name.c_str());
+        WriteJsonFields(f, r.params);
+        std::fprintf(f, ", \"metrics\": ");
+        WriteJsonFields(f, r.metrics);
+        std::fprintf(f, "}%s\n", i + 1 < g_results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    if (!toStdout) {
+        std::fclose(f);
+    }
+    return true;
+}
+
+// Один прогон сценария: "кадр" из Submit'ов и Dispatch'а в группу
+static void RunFrame(TaskSystem& ts, std::atomic<uint64_t>& sink, std::size_t submits, std::size_t dispatchJobs) {
+    TaskGroup frame;
+    for (std::size_t i = 0; i < submits; ++i) {
+        ts.Submit(frame, [&sink, i]() { sink.fetch_add(i, std::memory_order_relaxed); });
+    }
+    ts.Dispatch(frame, dispatchJobs, [&sink](std::size_t i) {
+        sink.fetch_add(i, std::memory_order_relaxed);
+        }, 8);
+
+    // Зависимости: a,b -> c
+    TaskHandle a = ts.Submit(frame, [&sink]() { sink.fetch_add(1, std::memory_order_relaxed); }, {});
+    TaskHandle b = ts.Submit(frame, [&sink]() { sink.fetch_add(1, std::memory_order_relaxed); }, {});
+    TaskHandle c = ts.Submit(frame, [&sink]() { sink.fetch_add(1, std::memory_order_relaxed); }, { a, b });
+    frame.Wait();
+}
+
+static int BenchZeroAlloc(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr std::size_t kSubmits = 512;
+    constexpr std::size_t kDispatchJobs = 4096;
+    constexpr int kWarmupFrames = 200;
+    constexpr int kFrames = 500;
+
+    std::atomic<uint64_t> sink{ 0 };
+
+    // Прогрев: пулы и кольца деков набирают ёмкость
+    for (int f = 0; f < kWarmupFrames; ++f) {
+        RunFrame(ts, sink, kSubmits, kDispatchJobs);
+    }
+
+    const TaskSystem::Stats before = ts.GetStats();
+    const uint64_t allocsBefore = g_allocs.load();
+    const auto t0 = Clock::now();
+
+    for (int f = 0; f < kFrames; ++f) {
+        RunFrame(ts, sink, kSubmits, kDispatchJobs);
+    }
+
+    const double ms = MsSince(t0);
+    const uint64_t allocs = g_allocs.load() - allocsBefore;
+    const TaskSystem::Stats after = ts.GetStats();
+
+    const uint64_t jobs = uint64_t(kFrames) * (kSubmits + kDispatchJobs / 8 + 3);
+    Log("zero_alloc: frames=%d jobs=%llu time=%.2fms heap_allocs=%llu (%.4f per job)\n",
+        kFrames, (unsigned long long)jobs, ms, (unsigned long long)allocs, double(allocs) / double(jobs));
+    Log("  pool blocks: jobs +%llu dispatch +%llu, continuation allocs +%llu, callable heap fallbacks +%llu\n",
+        (unsigned long long)(after.jobBlocks - before.jobBlocks),
+        (unsigned long long)(after.dispatchBlocks - before.dispatchBlocks),
+        (unsigned long long)(after.continuationAllocs - before.continuationAllocs),
+        (unsigned long long)(after.callableHeapFallbacks - before.callableHeapFallbacks));
+
+    AddResult("zero_alloc")
+        .Param("frames", kFrames).Param("jobs", double(jobs))
+        .Metric("time_ms", ms).Metric("heap_allocs", double(allocs))
+        .Metric("allocs_per_job", double(allocs) / double(jobs));
+
+    // Путь постановки сам по себе не аллоцирует; единичные аллокации — это пул, добирающий
+    // блок при новом пике задач "в полёте" (узлы оседают в кэшах разных потоков).
+    // Провал — только если аллокации растут вместе с числом задач.
+    return double(allocs) / double(jobs) < 1e-4 ? 0 : 1;
+}
+
+// Имитация работы на элемент (~itemNs наносекунд)
+static void SpinNs(double itemNs) {
+    const auto t0 = Clock::now();
+    while (std::chrono::duration<double, std::nano>(Clock::now() - t0).count() < itemNs) {
+    }
+}
+
+static int BenchParallelFor(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr std::size_t kGrains[] = { 1, 8, 256, TaskSystem::kAutoGrain };
+    constexpr std::size_t kCounts[] = { 10, 100000 };
+    constexpr double kItemNs = 200.0;
+
+    for (std::size_t n : kCounts) {
+        const int reps = n < 1000 ? 2000 : 10;
+        for (std::size_t grain : kGrains) {
+            ParallelForTuner tuner;
+            std::atomic<uint64_t> sink{ 0 };
+            const auto t0 = Clock::now();
+            for (int r = 0; r < reps; ++r) {
+                ts.ParallelFor(0, n, [&sink, kItemNs](std::size_t i) {
+                    SpinNs(kItemNs);
+                    sink.fetch_add(i, std::memory_order_relaxed);
+                    }, grain, &tuner);
+            }
+            const double ms = MsSince(t0) / reps;
+            if (grain == TaskSystem::kAutoGrain) {
+                Log("parallel_for: n=%zu grain=auto(%zu) %.3fms/iter\n", n, tuner.grain.load(), ms);
+            }
+            else {
+                Log("parallel_for: n=%zu grain=%zu %.3fms/iter\n", n, grain, ms);
+            }
+            AddResult("parallel_for")
+                .Param("n", double(n)).Param("grain", double(grain)) // 0 — auto
+                .Metric("ms_per_iter", ms).Metric("effective_grain", double(grain ? grain : tuner.grain.load()));
+        }
+    }
+    return 0;
+}
+
+// Процессорное время процесса (user+sys), секунды
+static double ProcessCpuSeconds() {
+#if defined(_WIN32)
+    FILETIME c, e, k, u;
+    GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u);
+    auto toSec = [](const FILETIME& f) {
+        return double((uint64_t(f.dwHighDateTime) << 32) | f.dwLowDateTime) * 1e-7;
+    };
+    return toSec(k) + toSec(u);
+#else
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return double(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) + double(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+static double Percentile(std::vector<double>& v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, std::size_t(p * double(v.size())))];
+}
+
+// Задержка submit -> старт: пауза (пул простаивает), затем Dispatch по задаче на воркер.
+// first — когда стартовала первая задача, ramp — когда последняя (все воркеры в деле).
+// Простой между всплесками меряем отдельно: сколько ядер сжигает пул, когда работы нет.
+static int BenchWakeLatency(TaskSystem& ts, const TaskSystem::Config& base) {
+    struct Setting { const char* name; uint32_t spinMicros; uint32_t yieldCount; };
+    constexpr Setting kSettings[] = {
+        { "park",      0,   0 },
+        { "spin10us",  10,  4 },
+        { "spin50us",  50,  16 },
+        { "spin200us", 200, 16 },
+    };
+    constexpr int kGapsUs[] = { 20, 2000 };
+    constexpr int kReps = 300;
+
+    for (const Setting& st : kSettings) {
+        ts.Stop();
+        TaskSystem::Config cfg = base;
+        cfg.spinMicros = st.spinMicros;
+        cfg.yieldCount = st.yieldCount;
+        ts.Start(cfg);
+        const std::size_t workers = ts.WorkerCount();
+
+        for (int gapUs : kGapsUs) {
+            std::vector<double> first, ramp;
+            std::vector<int64_t> startNs(workers);
+            const TaskSystem::Stats before = ts.GetStats();
+
+            for (int r = 0; r < kReps; ++r) {
+                std::this_thread::sleep_for(std::chrono::microseconds(gapUs));
+
+                // Ждём без помощи пулу (Wait() исполнил бы задачи сам и замерил бы себя)
+                std::atomic<std::size_t> done{ 0 };
+                const auto t0 = Clock::now();
+                ts.Dispatch(workers, [&startNs, &done, t0](std::size_t i) {
+                    startNs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+                    SpinNs(20000.0); // держим воркер, чтобы следующую задачу взял другой
+                    done.fetch_add(1, std::memory_order_release);
+                    });
+                while (done.load(std::memory_order_acquire) != workers) {
+                    std::this_thread::yield();
+                }
+
+                first.push_back(double(*std::min_element(startNs.begin(), startNs.end())) * 1e-3);
+                ramp.push_back(double(*std::max_element(startNs.begin(), startNs.end())) * 1e-3);
+            }
+
+            const TaskSystem::Stats after = ts.GetStats();
+            Log("wake_latency: %-9s gap=%4dus first p50=%6.1fus p99=%6.1fus | ramp p50=%6.1fus p99=%6.1fus | spinHits=%llu parks=%llu\n",
+                st.name, gapUs, Percentile(first, 0.5), Percentile(first, 0.99),
+                Percentile(ramp, 0.5), Percentile(ramp, 0.99),
+                (unsigned long long)(after.spinHits - before.spinHits),
+                (unsigned long long)(after.parks - before.parks));
+            AddResult("wake_latency")
+                .Param("spin_us", st.spinMicros).Param("yield_count", st.yieldCount).Param("gap_us", gapUs)
+                .Metric("first_p50_us", Percentile(first, 0.5)).Metric("first_p99_us", Percentile(first, 0.99))
+                .Metric("ramp_p50_us", Percentile(ramp, 0.5)).Metric("ramp_p99_us", Percentile(ramp, 0.99))
+                .Metric("spin_hits", double(after.spinHits - before.spinHits))
+                .Metric("parks", double(after.parks - before.parks));
+        }
+
+        // Цена ожидания: короткие паузы между всплесками (как между пассами кадра) —
+        // здесь воркеры крутятся, а не спят
+        constexpr int kBursts = 200;
+        constexpr int kIdleUs = 100;
+        const double cpu0 = ProcessCpuSeconds();
+        const auto w0 = Clock::now();
+        for (int b = 0; b < kBursts; ++b) {
+            ts.Dispatch(workers, [](std::size_t) {});
+            ts.WaitForAll();
+            std::this_thread::sleep_for(std::chrono::microseconds(kIdleUs));
+        }
+        const double wall = std::chrono::duration<double>(Clock::now() - w0).count();
+        const double burn = (ProcessCpuSeconds() - cpu0) / wall;
+        Log("wake_latency: %-9s idle burn %.2f cores (bursts every ~%dus)\n", st.name, burn, kIdleUs);
+        AddResult("idle_burn")
+            .Param("spin_us", st.spinMicros).Param("yield_count", st.yieldCount).Param("idle_us", kIdleUs)
+            .Metric("cores", burn);
+    }
+
+    ts.Stop();
+    ts.Start(base);
+    return 0;
+}
+
+// Пустые задачи: чистая цена постановки + исполнения.
+// external — Submit с главного потока (очередь инъекций), worker — из задачи (локальный дек)
+static int BenchEmptyThroughput(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr std::size_t kJobs = std::size_t(1) << 20;
+    constexpr int kReps = 5;
+
+    for (int fromWorker = 0; fromWorker < 2; ++fromWorker) {
+        double best = 1e30;
+        for (int r = 0; r < kReps; ++r) {
+            TaskGroup g;
+            const auto t0 = Clock::now();
+            if (fromWorker) {
+                ts.Submit(g, [&ts, &g] {
+                    for (std::size_t i = 0; i < kJobs; ++i) {
+                        ts.Submit(g, [] {});
+                    }
+                    });
+            }
+            else {
+                for (std::size_t i = 0; i < kJobs; ++i) {
+                    ts.Submit(g, [] {});
+                }
+            }
+            g.Wait();
+            best = std::min(best, MsSince(t0));
+        }
+        const double jobsPerSec = double(kJobs) / (best * 1e-3);
+        const char* mode = fromWorker ? "worker" : "external";
+        Log("empty_throughput: %-8s jobs=%zu best=%.2fms %.2fM jobs/s (%.1f ns/job)\n",
+            mode, kJobs, best, jobsPerSec * 1e-6, best * 1e6 / double(kJobs));
+        AddResult(fromWorker ? "empty_throughput_worker" : "empty_throughput_external")
+            .Param("jobs", double(kJobs))
+            .Metric("best_ms", best).Metric("jobs_per_sec", jobsPerSec)
+            .Metric("ns_per_job", best * 1e6 / double(kJobs));
+    }
+    return 0;
+}
+
+// Dispatch веером: от вызова до возврата group.Wait() (полный круг, вызывающий помогает)
+static int BenchDispatchFanout(TaskSystem& ts, const TaskSystem::Config&) {
+    const std::size_t workers = std::max<std::size_t>(1, ts.WorkerCount());
+    const std::size_t kCounts[] = { workers, 64, 1024, 16384 };
+    constexpr int kReps = 500;
+
+    for (std::size_t n : kCounts) {
+        std::vector<double> us;
+        us.reserve(kReps);
+        std::atomic<uint64_t> sink{ 0 };
+        for (int r = 0; r < kReps; ++r) {
+            TaskGroup g;
+            const auto t0 = Clock::now();
+            ts.Dispatch(g, n, [&sink](std::size_t i) { sink.fetch_add(i, std::memory_order_relaxed); });
+            g.Wait();
+            us.push_back(MsSince(t0) * 1e3);
+        }
+        const double p50 = Percentile(us, 0.5), p99 = Percentile(us, 0.99);
+        Log("dispatch_fanout: jobs=%-6zu p50=%8.1fus p99=%8.1fus (%.1f ns/job at p50)\n", n, p50, p99, p50 * 1e3 / double(n));
+        AddResult("dispatch_fanout")
+            .Param("jobs", double(n))
+            .Metric("p50_us", p50).Metric("p99_us", p99).Metric("ns_per_job_p50", p50 * 1e3 / double(n));
+    }
+    return 0;
+}
+
+// Рекурсивное дерево задач: каждый узел с воркера ставит двух детей (локальный дек + кража)
+static void SpawnTree(TaskSystem& ts, TaskGroup& g, int depth) {
+    if (depth == 0) {
+        return;
+    }
+    ts.Submit(g, [&ts, &g, depth] { SpawnTree(ts, g, depth - 1); });
+    ts.Submit(g, [&ts, &g, depth] { SpawnTree(ts, g, depth - 1); });
+}
+
+static int BenchNestedSubmit(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr int kDepths[] = { 10, 16, 20 };
+    for (int depth : kDepths) {
+        const int reps = depth <= 10 ? 200 : (depth <= 16 ? 10 : 3);
+        const double nodes = double((uint64_t(1) << (depth + 1)) - 2);
+        double best = 1e30;
+        for (int r = 0; r < reps; ++r) {
+            TaskGroup g;
+            const auto t0 = Clock::now();
+            ts.Submit(g, [&ts, &g, depth] { SpawnTree(ts, g, depth); });
+            g.Wait();
+            best = std::min(best, MsSince(t0));
+        }
+        const double perSec = nodes / (best * 1e-3);
+        Log("nested_submit: depth=%d tasks=%.0f best=%.3fms %.2fM tasks/s\n", depth, nodes, best, perSec * 1e-6);
+        AddResult("nested_submit")
+            .Param("depth", depth).Param("tasks", nodes)
+            .Metric("best_ms", best).Metric("tasks_per_sec", perSec);
+    }
+    return 0;
+}
+
+// Несколько внешних потоков-продюсеров бьются за очередь инъекций; каждый ждёт свою группу
+static int BenchProducers(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr std::size_t kTotalJobs = std::size_t(1) << 19;
+    constexpr int kReps = 3;
+    const unsigned maxProducers = std::max(2u, std::thread::hardware_concurrency());
+
+    for (unsigned producers = 1; producers <= maxProducers; producers *= 2) {
+        const std::size_t perProducer = kTotalJobs / producers;
+        double best = 1e30;
+        for (int r = 0; r < kReps; ++r) {
+            std::atomic<unsigned> ready{ 0 };
+            std::atomic<bool> go{ false };
+            std::vector<std::thread> threads;
+            threads.reserve(producers);
+            for (unsigned p = 0; p < producers; ++p) {
+                threads.emplace_back([&ts, &ready, &go, perProducer] {
+                    TaskGroup g;
+                    ready.fetch_add(1, std::memory_order_acq_rel);
+                    while (!go.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    for (std::size_t i = 0; i < perProducer; ++i) {
+                        ts.Submit(g, [] {});
+                    }
+                    g.Wait();
+                    });
+            }
+            while (ready.load(std::memory_order_acquire) != producers) {
+                std::this_thread::yield();
+            }
+            const auto t0 = Clock::now();
+            go.store(true, std::memory_order_release);
+            for (std::thread& t : threads) {
+                t.join();
+            }
+            best = std::min(best, MsSince(t0));
+        }
+        const double jobs = double(perProducer * producers);
+        const double perSec = jobs / (best * 1e-3);
+        Log("producers: %2u producers jobs=%.0f best=%.2fms %.2fM jobs/s\n", producers, jobs, best, perSec * 1e-6);
+        AddResult("producers")
+            .Param("producers", producers).Param("jobs", jobs)
+            .Metric("best_ms", best).Metric("jobs_per_sec", perSec);
+    }
+    return 0;
+}
+
+// Круг WaitForAll: на пустом пуле (цена самой проверки) и после одной пустой задачи
+static int BenchWaitForAll(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr int kReps = 2000;
+    for (int withJob = 0; withJob < 2; ++withJob) {
+        std::vector<double> us;
+        us.reserve(kReps);
+        for (int r = 0; r < kReps; ++r) {
+            const auto t0 = Clock::now();
+            if (withJob) {
+                ts.Submit([] {});
+            }
+            ts.WaitForAll();
+            us.push_back(MsSince(t0) * 1e3);
+        }
+        const double p50 = Percentile(us, 0.5), p99 = Percentile(us, 0.99);
+        Log("wait_for_all: %-9s p50=%7.2fus p99=%7.2fus\n", withJob ? "one_job" : "empty", p50, p99);
+        AddResult(withJob ? "wait_for_all_one_job" : "wait_for_all_empty")
+            .Metric("p50_us", p50).Metric("p99_us", p99);
+    }
+    return 0;
+}
+
+// Блокирующий ParallelForRange из фоновой задачи: его подзадачи не должны уйти в фоновую
+// полосу — фоновый слот (при 2 воркерах единственный) занят самой задачей, а ждущий
+// фоновое не берёт. Зависание ловим таймаутом: ждать пул нельзя, висит именно он.
+// Воспроизводится на --threads 2
+static int BenchBackgroundParallelFor(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr int kReps = 200;
+    constexpr std::size_t kItems = 4096;
+    std::atomic<int> finished{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    const auto t0 = Clock::now();
+    for (int r = 0; r < kReps; ++r) {
+        ts.Submit([&ts, &sum, &finished] {
+            ts.ParallelForRange(0, kItems, [&sum](std::size_t b, std::size_t e) {
+                sum.fetch_add(e - b, std::memory_order_relaxed);
+            }, 64);
+            finished.fetch_add(1, std::memory_order_release);
+        }, TaskPriority::Background);
+    }
+    while (finished.load(std::memory_order_acquire) < kReps) {
+        if (MsSince(t0) > 10000.0) {
+            Log("background_parallel_for: HANG (%d/%d done)\n", finished.load(), kReps);
+            std::fflush(g_log);
+            std::_Exit(1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const double ms = MsSince(t0);
+    const bool ok = sum.load() == uint64_t(kReps) * kItems;
+    Log("background_parallel_for: reps=%d total=%.2fms %s\n", kReps, ms, ok ? "" : "MISMATCH");
+    AddResult("background_parallel_for").Metric("total_ms", ms);
+    return ok ? 0 : 1;
+}
+
+// Wait(group) на главном потоке крадёт только работу своей группы (и вложенных в её задачи
+// блокирующих ParallelFor), но не задачи другой группы из деков воркеров — как тик
+// и кадр в Scene::RunFrame
+static int BenchWaitIsolation(TaskSystem& ts, const TaskSystem::Config&) {
+    constexpr int kReps = 50;
+    const std::thread::id mainId = std::this_thread::get_id();
+    std::atomic<bool> inFrameWait{ false };
+    std::atomic<int> foreignOnMain{ 0 };
+    std::atomic<int> nestedOnMain{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    const auto t0 = Clock::now();
+    for (int r = 0; r < kReps; ++r) {
+        TaskGroup tick(TaskPriority::Normal);
+        TaskGroup frame(TaskPriority::FrameCritical);
+        std::atomic<bool> frameStarted{ false };
+        // Задача кадра на воркере кладёт задачи тика в свой дек (их можно украсть) и засыпает:
+        // главному потоку в Wait(frame) помогать нечем, кроме чужого тика
+        ts.Submit(frame, [&] {
+            for (int i = 0; i < 64; ++i) {
+                ts.Submit(tick, [&] {
+                    if (inFrameWait.load(std::memory_order_relaxed) && std::this_thread::get_id() == mainId) {
+                        foreignOnMain.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    SpinNs(20000.0);
+                });
+            }
+            frameStarted.store(true, std::memory_order_release);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ts.ParallelForRange(0, 256, [&](std::size_t b, std::size_t e) {
+                if (std::this_thread::get_id() == mainId) {
+                    nestedOnMain.fetch_add(1, std::memory_order_relaxed);
+                }
+                SpinNs(double(e - b) * 2000.0);
+                sum.fetch_add(e - b, std::memory_order_relaxed);
+            }, 4);
+        });
+        while (!frameStarted.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        inFrameWait.store(true, std::memory_order_relaxed);
+        frame.Wait();
+        inFrameWait.store(false, std::memory_order_relaxed);
+        tick.Wait();
+    }
+    const double ms = MsSince(t0);
+    const bool ok = foreignOnMain.load() == 0 && sum.load() == uint64_t(kReps) * 256;
+    Log("wait_isolation: reps=%d total=%.2fms nested_on_main=%d foreign_on_main=%d %s\n",
+        kReps, ms, nestedOnMain.load(), foreignOnMain.load(), ok ? "" : "MISMATCH");
+    AddResult("wait_isolation").Metric("total_ms", ms).Metric("nested_on_main", nestedOnMain.load());
+    return ok ? 0 : 1;
+}
+
+struct BenchCase {
+    const char* name;
+    int (*run)(TaskSystem&, const TaskSystem::Config&);
+};
+
+int main(int argc, char** argv) {
+    const char* jsonPath = nullptr;
+    const char* only = nullptr;
+    TaskSystem::Config cfg;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            cfg.threadCount = static_cast<unsigned>(std::atoi(argv[++i]));
+        }
+        else {
+            std::fprintf(stderr, "usage: %s [--json out.json|-] [--only name] [--threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (jsonPath && std::strcmp(jsonPath, "-") == 0) {
+        g_log = stderr; // stdout — под JSON
+    }
+
+    auto& ts = TaskSystem::Get();
+    ts.Start(cfg);
+    Log("workers=%zu\n", ts.WorkerCount());
+
+    // zero_alloc — первым: остальные случаи раздувают пулы
+    const BenchCase kCases[] = {
+        { "zero_alloc",       &BenchZeroAlloc },
+        { "empty_throughput", &BenchEmptyThroughput },
+        { "dispatch_fanout",  &BenchDispatchFanout },
+        { "nested_submit",    &BenchNestedSubmit },
+        { "producers",        &BenchProducers },
+        { "wait_for_all",     &BenchWaitForAll },
+        { "parallel_for",     &BenchParallelFor },
+        { "background_parallel_for", &BenchBackgroundParallelFor },
+        { "wait_isolation",   &BenchWaitIsolation },
+        { "wake_latency",     &BenchWakeLatency },
+    };
+
+    int rc = 0;
+    for (const BenchCase& c : kCases) {
+        if (only && std::strncmp(c.name, only, std::strlen(only)) != 0) {
+            continue;
+        }
+        if (c.run(ts, cfg) != 0) {
+            Log("FAIL: %s\n", c.name);
+            rc = 1;
+        }
+    }
+
+    if (jsonPath && !WriteJson(jsonPath, ts.WorkerCount(), cfg)) {
+        rc = 1;
+    }
+    ts.Stop();
+    return rc;
+}
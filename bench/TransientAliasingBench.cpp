@@ -0,0 +1,179 @@
+// Проверка раскладки транзиентов (SolveTransientAliasing) на CPU, без D3D — собирается и на Linux:
+//   g++ -std=c++20 -O2 -I.. TransientAliasingBench.cpp -o TransientAliasingBench
+//   cl /std:c++20 /O2 /EHsc /I.. TransientAliasingBench.cpp
+// Каждый случай сверяет раскладку с ожидаемой, расхождение — код возврата 1.
+#include "TransientAliasing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void Report(const char* name, bool ok) {
+    std::printf("%-22s %s\n", name, ok ? "ok" : "MISMATCH");
+}
+
+static uint64_t AlignUp(uint64_t v, uint64_t a) {
+    return a <= 1 ? v : (v + a - 1) / a * a;
+}
+
+// Инварианты любой раскладки: выравнивание, живущие одновременно не делят память,
+// heapSize — конец самого дальнего, naiveSize — сумма выровненных размеров
+static bool CheckInvariants(std::span<const TransientRequest> req, const TransientLayout& l) {
+    if (l.offsets.size() != req.size()) {
+        return false;
+    }
+    uint64_t end = 0, naive = 0;
+    for (size_t i = 0; i < req.size(); ++i) {
+        if (req[i].alignment > 1 && l.offsets[i] % req[i].alignment != 0) {
+            return false;
+        }
+        end = std::max(end, l.offsets[i] + req[i].size);
+        naive += AlignUp(req[i].size, req[i].alignment);
+        for (size_t j = i + 1; j < req.size(); ++j) {
+            const bool aliveTogether = req[i].firstUse <= req[j].lastUse && req[j].firstUse <= req[i].lastUse;
+            const bool shareMemory = l.offsets[i] < l.offsets[j] + req[j].size && l.offsets[j] < l.offsets[i] + req[i].size;
+            if (aliveTogether && shareMemory) {
+                return false;
+            }
+        }
+    }
+    return l.heapSize == end && l.naiveSize == naive;
+}
+
+// Не пересекающиеся по времени делят смещение, куча — как у одного
+static int CaseDisjointShare() {
+    const TransientRequest req[] = {
+        { 1 << 20, 65536, 0, 1 },
+        { 1 << 20, 65536, 2, 3 },
+    };
+    const TransientLayout l = SolveTransientAliasing(req);
+    const bool ok = CheckInvariants(req, l) && l.offsets[0] == l.offsets[1] && l.heapSize == (1u << 20) &&
+        l.naiveSize == 2u * (1u << 20);
+    Report("disjoint_share", ok);
+    return !ok;
+}
+
+// Пересекающиеся по времени (в том числе касанием: lastUse == firstUse) в памяти не пересекаются
+static int CaseOverlapSeparate() {
+    const TransientRequest req[] = {
+        { 1 << 20, 65536, 0, 2 },
+        { 1 << 20, 65536, 2, 4 }, // общий пасс 2 с первым
+        { 1 << 19, 65536, 1, 1 },
+    };
+    const TransientLayout l = SolveTransientAliasing(req);
+    // Третий жив вместе только с первым — встаёт на место второго
+    const bool ok = CheckInvariants(req, l) && l.offsets[0] != l.offsets[1] && l.offsets[2] == l.offsets[1] &&
+        l.heapSize == 2u * (1u << 20);
+    Report("overlap_separate", ok);
+    return !ok;
+}
+
+// Выравнивание: дыра после маленького невыровненного — не для требующего 64K
+static int CaseAlignment() {
+    const TransientRequest req[] = {
+        { 1000, 1, 0, 5 },
+        { 300, 65536, 0, 5 },
+        { 4 << 20, 4 << 20, 0, 5 }, // MSAA-подобное выравнивание
+    };
+    const TransientLayout l = SolveTransientAliasing(req);
+    const bool ok = CheckInvariants(req, l) && l.offsets[2] == 0 && l.offsets[0] == (4u << 20) &&
+        l.offsets[1] == (4u << 20) + 65536u;
+    Report("alignment", ok);
+    return !ok;
+}
+
+// Настоящие цели кадра (GB0..SSRBlur) в 4K: размеры — как у GetResourceAllocationInfo
+// (64K-страницы), времена жизни — позиции пассов Scene::Render в порядке сабмита
+static int CaseDeferredTargets() {
+    constexpr uint64_t kPage = 65536;
+    constexpr uint64_t kPixels = 3840ull * 2160ull;
+    const uint64_t rgba8 = AlignUp(kPixels * 4, kPage);  // GB0, GB1 (10:10:10:2), GB2 (11:11:10), Depth, SSR, SSRBlur
+    const uint64_t rgba16 = AlignUp(kPixels * 8, kPage); // Light, Scene
+    enum { GB0, GB1, GB2, Depth, Light, Scene, SSR, SSRBlur, Count };
+    int fails = 0;
+
+    // С отражениями: 0 Clear, 1 GBuffer, 2 Lighting, 3 Skybox, 4 SSR, 5 BlurX, 6 BlurY,
+    // 7 Compose, 8 Transparent, 9 Tonemap. Делить память могут только SSRBlur (5..6) и Scene (7..9)
+    {
+        TransientRequest req[Count] = {
+            { rgba8, kPage, 1, 7 },  // GB0: GBuffer .. Compose
+            { rgba8, kPage, 1, 7 },  // GB1: GBuffer .. Compose
+            { rgba8, kPage, 1, 7 },  // GB2
+            { rgba8, kPage, 1, 8 },  // Depth: GBuffer .. Transparent (DSV)
+            { rgba16, kPage, 2, 7 }, // Light: Lighting .. Compose
+            { rgba16, kPage, 7, 9 }, // Scene: Compose .. Tonemap
+            { rgba8, kPage, 4, 7 },  // SSR: SSR .. Compose
+            { rgba8, kPage, 5, 6 },  // SSRBlur: BlurX .. BlurY
+        };
+        const TransientLayout l = SolveTransientAliasing(req);
+        const bool ok = CheckInvariants(req, l) && l.naiveSize == 6 * rgba8 + 2 * rgba16 &&
+            l.heapSize == l.naiveSize - rgba8 && l.offsets[SSRBlur] == l.offsets[Scene];
+        std::printf("%-22s heap=%.1fMB naive=%.1fMB\n", "deferred_reflections",
+            l.heapSize / (1024.0 * 1024.0), l.naiveSize / (1024.0 * 1024.0));
+        Report("deferred_reflections", ok);
+        fails += !ok;
+    }
+
+    // Без отражений SSR и блюры отсечены: SSR/SSRBlur не трогает никто — живут весь кадр,
+    // остальные: 1 GBuffer, 2 Lighting, 3 Skybox, 4 Compose, 5 Transparent, 6 Tonemap — не делят ничего
+    {
+        TransientRequest req[Count] = {
+            { rgba8, kPage, 1, 4 },
+            { rgba8, kPage, 1, 4 },
+            { rgba8, kPage, 1, 4 },
+            { rgba8, kPage, 1, 5 },
+            { rgba16, kPage, 2, 4 },
+            { rgba16, kPage, 4, 6 },
+            { rgba8, kPage, 0, UINT32_MAX },
+            { rgba8, kPage, 0, UINT32_MAX },
+        };
+        const TransientLayout l = SolveTransientAliasing(req);
+        const bool ok = CheckInvariants(req, l) && l.heapSize == l.naiveSize && l.naiveSize == 6 * rgba8 + 2 * rgba16;
+        Report("deferred_no_reflect", ok);
+        fails += !ok;
+    }
+    return fails;
+}
+
+// Случайные наборы: только инварианты + время решения
+static int CaseRandom(std::mt19937_64& rng) {
+    int fails = 0;
+    double worstUs = 0.0;
+    std::vector<TransientRequest> req;
+    for (int rep = 0; rep < 200; ++rep) {
+        req.resize(1 + rng() % 64);
+        for (TransientRequest& r : req) {
+            r.size = 1 + rng() % (8u << 20);
+            r.alignment = uint64_t(1) << (rng() % 23); // 1 .. 4M
+            r.firstUse = static_cast<uint32_t>(rng() % 16);
+            r.lastUse = rng() % 8 == 0 ? UINT32_MAX : r.firstUse + static_cast<uint32_t>(rng() % 8);
+        }
+        const auto t0 = Clock::now();
+        const TransientLayout l = SolveTransientAliasing(req);
+        worstUs = std::max(worstUs, std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+        fails += !CheckInvariants(req, l);
+    }
+    std::printf("%-22s reps=200 worst=%.1fus\n", "random", worstUs);
+    Report("random", fails == 0);
+    return fails;
+}
+
+int main() {
+    std::mt19937_64 rng(12345);
+    int fails = 0;
+    fails += CaseDisjointShare();
+    fails += CaseOverlapSeparate();
+    fails += CaseAlignment();
+    fails += CaseDeferredTargets();
+    fails += CaseRandom(rng);
+
+    if (fails != 0) {
+        std::printf("FAIL: %d mismatches\n", fails);
+        return 1;
+    }
+    return 0;
+}
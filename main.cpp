@@ -21,6 +21,6 @@ int WINAPI WinMain(
 )
 {
     App app;
-    app.Run(hInstance, nShowCmd);
+    app.Run(hInstance, nShowCmd, lpCmdLine);
     return 0;
 }